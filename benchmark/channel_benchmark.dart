@@ -0,0 +1,413 @@
+// Measures the cost which the Dart side of the plug-in adds per event.
+//
+// Drives [ChannelPointerLock] through the test binary messenger with fake native sessions, so no platform code runs.
+// For each scenario, it reports the time spent per event and (if the VM service is available) the bytes and objects
+// allocated per event and the number of garbage collections.
+//
+// Run it with:
+//
+//     flutter test --enable-vmservice benchmark/channel_benchmark.dart
+//
+// Optional settings (via `--dart-define=NAME=VALUE`):
+//
+// - `POINTER_LOCK_BENCH_EVENTS`: events per scenario (default 100000)
+// - `POINTER_LOCK_BENCH_RATE`: events per second, 0 to deliver as fast as possible (default 0)
+// - `POINTER_LOCK_BENCH_BATCH`: comma-separated numbers of samples per native batch (default "1,8,64")
+//
+// Besides the table, the results are printed as one line of JSON, prefixed with `BENCHMARK_RESULT `.
+
+import 'dart:async';
+import 'dart:convert';
+import 'dart:developer' as developer;
+import 'dart:isolate';
+import 'dart:typed_data';
+import 'dart:ui';
+
+import 'package:flutter/foundation.dart';
+import 'package:flutter/services.dart';
+import 'package:flutter_test/flutter_test.dart';
+import 'package:pointer_lock/pointer_lock.dart';
+import 'package:pointer_lock/src/pointer_lock_batch.dart';
+import 'package:pointer_lock/src/pointer_lock_channel.dart';
+import 'package:vm_service/vm_service.dart' as vm;
+import 'package:vm_service/vm_service_io.dart';
+
+const _events = int.fromEnvironment('POINTER_LOCK_BENCH_EVENTS', defaultValue: 100000);
+const _rate = int.fromEnvironment('POINTER_LOCK_BENCH_RATE', defaultValue: 0);
+const _batchSizes = String.fromEnvironment('POINTER_LOCK_BENCH_BATCH', defaultValue: '1,8,64');
+
+const _sessionChannel = 'pointer_lock_session';
+const _codec = StandardMethodCodec();
+
+void main() {
+  TestWidgetsFlutterBinding.ensureInitialized();
+
+  test('channel layer', () async {
+    final profiler = await _Profiler.connect();
+    if (profiler == null) {
+      debugPrint('VM service not available, only measuring time. Pass --enable-vmservice for allocations and GCs.');
+    }
+    final batchSizes = [for (final size in _batchSizes.split(',')) int.parse(size.trim())];
+    final scenarios = [
+      _Scenario.harness(),
+      for (final size in batchSizes) _Scenario.linuxEvents(size),
+      for (final size in batchSizes) _Scenario.linuxBatches(size),
+      _Scenario.macOS(),
+      _Scenario.windowsCapture(),
+      for (final size in batchSizes) _Scenario.windowsClip(size),
+    ];
+    final results = <_Result>[];
+    try {
+      for (final scenario in scenarios) {
+        results.add(await _measure(scenario, profiler));
+      }
+    } finally {
+      debugDefaultTargetPlatformOverride = null;
+      await profiler?.dispose();
+    }
+    _printTable(results);
+    debugPrint('BENCHMARK_RESULT ${jsonEncode({
+          'events': _events,
+          'rate': _rate,
+          'scenarios': [for (final result in results) result.toJson()],
+        })}');
+  }, timeout: Timeout.none);
+}
+
+/// A way of feeding events into [ChannelPointerLock].
+class _Scenario {
+  final String name;
+  final TargetPlatform platform;
+
+  /// How many events one message contains.
+  final int eventsPerMessage;
+
+  /// Starts a session and reports each number of received events to the given callback.
+  final StreamSubscription<Object?> Function(ChannelPointerLock platform, void Function(int count) onEvents) listen;
+
+  /// Delivers one message, the way the engine would.
+  final void Function(ChannelPointerLock platform) push;
+
+  _Scenario({
+    required this.name,
+    required this.platform,
+    required this.eventsPerMessage,
+    required this.listen,
+    required this.push,
+  });
+
+  /// Measures the benchmark loop itself, so its cost can be subtracted from the other scenarios.
+  factory _Scenario.harness() {
+    final controller = StreamController<int>.broadcast();
+    return _Scenario(
+      name: 'harness',
+      platform: TargetPlatform.linux,
+      eventsPerMessage: 1,
+      listen: (platform, onEvents) => controller.stream.listen(onEvents),
+      push: (platform) => controller.add(1),
+    );
+  }
+
+  /// Linux batches decoded into [PointerLockMoveEvent]s.
+  factory _Scenario.linuxEvents(int batchSize) {
+    final message = _codec.encodeSuccessEnvelope(_nativeBatch(batchSize));
+    return _Scenario(
+      name: 'linux/events batch=$batchSize',
+      platform: TargetPlatform.linux,
+      eventsPerMessage: batchSize,
+      listen: (platform, onEvents) => _sessionStream(platform).listen((event) => onEvents(1)),
+      push: (platform) => _pushNative(message),
+    );
+  }
+
+  /// Linux batches delivered as [PointerLockEventBatch]es.
+  factory _Scenario.linuxBatches(int batchSize) {
+    final message = _codec.encodeSuccessEnvelope(_nativeBatch(batchSize));
+    return _Scenario(
+      name: 'linux/batched batch=$batchSize',
+      platform: TargetPlatform.linux,
+      eventsPerMessage: batchSize,
+      listen: (platform, onEvents) => platform
+          .createBatchedSession(
+            windowsMode: PointerLockWindowsMode.capture,
+            cursor: PointerLockCursor.normal,
+            unlockOnPointerUp: false,
+          )
+          .listen((batch) => onEvents(batch.length)),
+      push: (platform) => _pushNative(message),
+    );
+  }
+
+  /// Single `[dx, dy]` deltas sent by the native session.
+  factory _Scenario.macOS() {
+    final message = _codec.encodeSuccessEnvelope(Float64List.fromList([1, -1]));
+    return _Scenario(
+      name: 'macos/deltas',
+      platform: TargetPlatform.macOS,
+      eventsPerMessage: 1,
+      listen: (platform, onEvents) => _sessionStream(platform).listen((event) => onEvents(1)),
+      push: (platform) => _pushNative(message),
+    );
+  }
+
+  /// Single `[dx, dy]` deltas, additionally passing the stream controller which decorates the raw stream.
+  factory _Scenario.windowsCapture() {
+    final message = _codec.encodeSuccessEnvelope(Float64List.fromList([1, -1]));
+    return _Scenario(
+      name: 'windows/capture',
+      platform: TargetPlatform.windows,
+      eventsPerMessage: 1,
+      listen: (platform, onEvents) => _sessionStream(platform).listen((event) => onEvents(1)),
+      push: (platform) => _pushNative(message),
+    );
+  }
+
+  /// Pointer data packets filtered in Dart, each answered by one delta query.
+  factory _Scenario.windowsClip(int packetSize) {
+    final template = [
+      for (var i = 0; i < packetSize; i++)
+        PointerData(change: PointerChange.hover, kind: PointerDeviceKind.mouse, physicalDeltaX: 1),
+    ];
+    return _Scenario(
+      name: 'windows/clip packet=$packetSize',
+      platform: TargetPlatform.windows,
+      eventsPerMessage: packetSize,
+      listen: (platform, onEvents) => platform
+          .createSession(
+            windowsMode: PointerLockWindowsMode.clip,
+            cursor: PointerLockCursor.normal,
+            unlockOnPointerUp: false,
+          )
+          // Each delta covers the whole packet because the benchmark waits for it before sending the next one.
+          .listen((event) => onEvents(packetSize)),
+      // The data list is filtered in place, so each packet needs its own (as coming from the engine).
+      push: (platform) => PlatformDispatcher.instance.onPointerDataPacket!(PointerDataPacket(data: List.of(template))),
+    );
+  }
+}
+
+Stream<PointerLockMoveEvent> _sessionStream(ChannelPointerLock platform) {
+  return platform.createSession(
+    windowsMode: PointerLockWindowsMode.capture,
+    cursor: PointerLockCursor.normal,
+    unlockOnPointerUp: false,
+  );
+}
+
+void _pushNative(ByteData message) {
+  TestDefaultBinaryMessengerBinding.instance.defaultBinaryMessenger
+      .handlePlatformMessage(_sessionChannel, message, (_) {});
+}
+
+/// Encodes a batch the way `EventBatch` in `pointer_lock_events.h` does.
+Float64List _nativeBatch(int count) {
+  final batch = Float64List(nativeBatchHeaderLength + count * NativeBatchColumn.values.length);
+  final ints = Int64List.sublistView(batch);
+  int index(NativeBatchColumn column, int i) => nativeBatchHeaderLength + column.index * count + i;
+  ints[0] = count;
+  for (var i = 0; i < count; i++) {
+    ints[index(NativeBatchColumn.timestamp, i)] = i * 1000;
+    batch[index(NativeBatchColumn.dx, i)] = 1;
+    batch[index(NativeBatchColumn.dy, i)] = -1;
+    batch[index(NativeBatchColumn.filteredDx, i)] = 1;
+    batch[index(NativeBatchColumn.filteredDy, i)] = -1;
+    batch[index(NativeBatchColumn.predictedDx, i)] = 1;
+    batch[index(NativeBatchColumn.predictedDy, i)] = -1;
+    batch[index(NativeBatchColumn.value, i)] = double.nan;
+    batch[index(NativeBatchColumn.cursorX, i)] = double.nan;
+    batch[index(NativeBatchColumn.cursorY, i)] = double.nan;
+    batch[index(NativeBatchColumn.positionX, i)] = double.nan;
+    batch[index(NativeBatchColumn.positionY, i)] = double.nan;
+    batch[index(NativeBatchColumn.physicalDx, i)] = 1;
+    batch[index(NativeBatchColumn.physicalDy, i)] = -1;
+  }
+  return batch;
+}
+
+void _setUpFakePlatform(ChannelPointerLock platform) {
+  final messenger = TestDefaultBinaryMessengerBinding.instance.defaultBinaryMessenger;
+  messenger.setMockMethodCallHandler(platform.methodChannel, (call) async {
+    switch (call.method) {
+      case 'startSession':
+        return <String, Object?>{};
+      case 'lastPointerDelta':
+        return <double>[1, -1];
+      default:
+        return null;
+    }
+  });
+  // Answers `listen` and `cancel` of the event channel
+  messenger.setMockMessageHandler(_sessionChannel, (message) async => _codec.encodeSuccessEnvelope(null));
+}
+
+void _tearDownFakePlatform(ChannelPointerLock platform) {
+  final messenger = TestDefaultBinaryMessengerBinding.instance.defaultBinaryMessenger;
+  messenger.setMockMethodCallHandler(platform.methodChannel, null);
+  messenger.setMockMessageHandler(_sessionChannel, null);
+}
+
+Future<_Result> _measure(_Scenario scenario, _Profiler? profiler) async {
+  debugDefaultTargetPlatformOverride = scenario.platform;
+  final platform = ChannelPointerLock();
+  _setUpFakePlatform(platform);
+  var received = 0;
+  var awaited = 0;
+  Completer<void>? arrival;
+  final subscription = scenario.listen(platform, (count) {
+    received += count;
+    final pending = arrival;
+    if (pending != null && received >= awaited) {
+      arrival = null;
+      pending.complete();
+    }
+  });
+  // Lets asynchronous session setup (e.g. `startSession`) finish
+  await _settle();
+
+  Future<void> deliver() {
+    awaited = received + scenario.eventsPerMessage;
+    final completer = Completer<void>();
+    arrival = completer;
+    scenario.push(platform);
+    return received >= awaited ? Future.value() : completer.future;
+  }
+
+  // Warm up, so the JIT has compiled the hot paths
+  for (var i = 0; i < 1000; i++) {
+    await deliver();
+  }
+  await profiler?.start();
+  final messages = (_events / scenario.eventsPerMessage).ceil();
+  final messageInterval = _rate > 0 ? Duration(microseconds: 1000000 * scenario.eventsPerMessage ~/ _rate) : null;
+  final wallClock = Stopwatch()..start();
+  final busy = Stopwatch();
+  final receivedBefore = received;
+  for (var i = 0; i < messages; i++) {
+    busy.start();
+    await deliver();
+    busy.stop();
+    if (messageInterval != null) {
+      final remaining = messageInterval * (i + 1) - wallClock.elapsed;
+      if (remaining > Duration.zero) {
+        await Future<void>.delayed(remaining);
+      }
+    }
+  }
+  final events = received - receivedBefore;
+  final allocations = await profiler?.stop();
+  await subscription.cancel();
+  await _settle();
+  _tearDownFakePlatform(platform);
+  return _Result(
+    name: scenario.name,
+    events: events,
+    elapsed: busy.elapsed,
+    allocations: allocations,
+  );
+}
+
+Future<void> _settle() async {
+  for (var i = 0; i < 20; i++) {
+    await Future<void>.delayed(Duration.zero);
+  }
+}
+
+class _Allocations {
+  final int bytes;
+  final int instances;
+  final int gcCount;
+
+  _Allocations({required this.bytes, required this.instances, required this.gcCount});
+}
+
+/// Counts allocations and garbage collections of the current isolate via the VM service.
+///
+/// The service client runs in the same isolate, so the GC notifications themselves add a few allocations.
+class _Profiler {
+  final vm.VmService _service;
+  final String _isolateId;
+  var _gcCount = 0;
+
+  _Profiler._(this._service, this._isolateId);
+
+  /// Returns `null` if the VM service isn't enabled.
+  static Future<_Profiler?> connect() async {
+    final uri = (await developer.Service.getInfo()).serverWebSocketUri;
+    // ignore: deprecated_member_use
+    final isolateId = developer.Service.getIsolateID(Isolate.current);
+    if (uri == null || isolateId == null) {
+      return null;
+    }
+    final service = await vmServiceConnectUri(uri.toString());
+    final profiler = _Profiler._(service, isolateId);
+    service.onGCEvent.listen((event) => profiler._gcCount++);
+    await service.streamListen(vm.EventStreams.kGC);
+    return profiler;
+  }
+
+  Future<void> start() async {
+    // Starts from a clean heap, so garbage of previous scenarios doesn't trigger collections in this one
+    await _service.getAllocationProfile(_isolateId, reset: true, gc: true);
+    await _settle();
+    _gcCount = 0;
+  }
+
+  Future<_Allocations> stop() async {
+    final gcCount = _gcCount;
+    final profile = await _service.getAllocationProfile(_isolateId);
+    var bytes = 0;
+    var instances = 0;
+    for (final stats in profile.members ?? const <vm.ClassHeapStats>[]) {
+      bytes += stats.accumulatedSize ?? 0;
+      instances += stats.instancesAccumulated ?? 0;
+    }
+    return _Allocations(bytes: bytes, instances: instances, gcCount: gcCount);
+  }
+
+  Future<void> dispose() => _service.dispose();
+}
+
+class _Result {
+  final String name;
+  final int events;
+  final Duration elapsed;
+  final _Allocations? allocations;
+
+  _Result({required this.name, required this.events, required this.elapsed, required this.allocations});
+
+  double get microsecondsPerEvent => events == 0 ? 0 : elapsed.inMicroseconds / events;
+
+  double? get bytesPerEvent => allocations == null || events == 0 ? null : allocations!.bytes / events;
+
+  double? get instancesPerEvent => allocations == null || events == 0 ? null : allocations!.instances / events;
+
+  Map<String, Object?> toJson() {
+    return {
+      'name': name,
+      'events': events,
+      'usPerEvent': microsecondsPerEvent,
+      'bytesPerEvent': bytesPerEvent,
+      'allocationsPerEvent': instancesPerEvent,
+      'gcCount': allocations?.gcCount,
+    };
+  }
+}
+
+void _printTable(List<_Result> results) {
+  String column(Object? value, int width) {
+    final text = switch (value) {
+      null => '-',
+      double() => value.toStringAsFixed(3),
+      _ => '$value',
+    };
+    return text.padLeft(width);
+  }
+
+  debugPrint('${'scenario'.padRight(28)}${column('events', 10)}${column('us/event', 12)}'
+      '${column('bytes/event', 14)}${column('allocs/event', 14)}${column('GCs', 6)}');
+  for (final result in results) {
+    debugPrint('${result.name.padRight(28)}${column(result.events, 10)}${column(result.microsecondsPerEvent, 12)}'
+        '${column(result.bytesPerEvent, 14)}${column(result.instancesPerEvent, 14)}'
+        '${column(result.allocations?.gcCount, 6)}');
+  }
+}
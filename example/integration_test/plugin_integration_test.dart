@@ -1,24 +1,322 @@
-// This is a basic Flutter integration test.
+// Measures the whole input path on Linux: X server, plug-in, channel and widget rebuild.
 //
-// Since integration tests run in a full Flutter application, they can interact
-// with the host side of a plugin implementation, unlike Dart unit tests.
+// Injects scripted pointer motion via the XTest extension (through dart:ffi), drives a [PointerLockDragArea] and a
+// session created with `pointerLock.createSession()`, and reports for each scenario:
 //
-// For more information about Flutter integration tests, please see
-// https://docs.flutter.dev/cookbook/testing/integration/introduction
+// - injected and delivered motion (in pixels) and the number of injected and delivered events
+// - the rate of delivered events
+// - the latency from injecting a motion until the callback which receives it
+// - build and raster times of the frames rendered meanwhile
+//
+// Needs an X server with XTest and nothing else moving the pointer, e.g. Xvfb:
+//
+//     cd example
+//     xvfb-run -a -s "-screen 0 1920x1080x24" flutter test integration_test/plugin_integration_test.dart -d linux
+//
+// Optional settings (via `--dart-define=NAME=VALUE`):
+//
+// - `POINTER_LOCK_BENCH_MOTIONS`: motions injected per scenario (default 2000)
+// - `POINTER_LOCK_BENCH_RATE`: motions injected per second (default 500)
+// - `POINTER_LOCK_BENCH_STEP`: horizontal pixels per motion (default 3)
+//
+// The results are passed to `IntegrationTestWidgetsFlutterBinding.reportData` (which `flutter drive` writes to
+// `build/integration_response_data.json`) and printed as one line of JSON, prefixed with `BENCHMARK_RESULT `. On
+// other platforms or without XTest, the test is skipped.
 
+import 'dart:async';
+import 'dart:convert';
+import 'dart:ffi';
+import 'dart:io';
+import 'dart:math' as math;
+import 'dart:ui' show FrameTiming;
 
+import 'package:flutter/material.dart';
+import 'package:flutter/scheduler.dart';
 import 'package:flutter_test/flutter_test.dart';
 import 'package:integration_test/integration_test.dart';
-
 import 'package:pointer_lock/pointer_lock.dart';
 
+const _motions = int.fromEnvironment('POINTER_LOCK_BENCH_MOTIONS', defaultValue: 2000);
+const _rate = int.fromEnvironment('POINTER_LOCK_BENCH_RATE', defaultValue: 500);
+const _step = int.fromEnvironment('POINTER_LOCK_BENCH_STEP', defaultValue: 3);
+
+/// How long to wait for the pointer grab and for the last events to arrive.
+const _settleTime = Duration(milliseconds: 300);
+
 void main() {
-  IntegrationTestWidgetsFlutterBinding.ensureInitialized();
-
-  testWidgets('getPlatformVersion test', (WidgetTester tester) async {
-    // final String? version = await plugin.getPlatformVersion();
-    // // The version string depends on the host platform running the test, so
-    // // just assert that some non-empty string is returned.
-    // expect(version?.isNotEmpty, true);
-  });
+  final binding = IntegrationTestWidgetsFlutterBinding.ensureInitialized();
+  final xTest = Platform.isLinux ? _XTest.open() : null;
+
+  testWidgets('input path benchmark', (WidgetTester tester) async {
+    // Render real frames and let the injected pointer events reach the widgets.
+    binding.framePolicy = LiveTestWidgetsFlutterBindingFramePolicy.fullyLive;
+    binding.shouldPropagateDevicePointerEvents = true;
+    await pointerLock.ensureInitialized();
+    final x = xTest!;
+    final results = <String, Object?>{};
+    try {
+      final dragArea = _DragAreaTarget();
+      await tester.pumpWidget(dragArea.build());
+      await _moveToCenter(tester, x, find.byKey(_DragAreaTarget.areaKey), dragArea.hovers);
+      results['dragArea'] = await _measure((recorder) async {
+        dragArea.recorder = recorder;
+        x.pressButton(true);
+        await dragArea.locked.future;
+        await Future<void>.delayed(_settleTime);
+        await recorder.inject(x);
+        x.pressButton(false);
+        await dragArea.unlocked.future;
+      });
+      results['session'] = await _measure((recorder) async {
+        final subscription = pointerLock.createSession().listen((event) {
+          if (event.kind == PointerLockEventKind.move) {
+            recorder.deliver(event.delta);
+          }
+        });
+        await Future<void>.delayed(_settleTime);
+        await recorder.inject(x);
+        await subscription.cancel();
+      });
+    } finally {
+      x.close();
+    }
+    final report = {'motions': _motions, 'rate': _rate, 'step': _step, 'scenarios': results};
+    binding.reportData = report;
+    debugPrint('BENCHMARK_RESULT ${jsonEncode(report)}');
+  }, skip: xTest == null, timeout: Timeout.none);
+}
+
+/// Moves the pointer (not locked yet) to the center of the given widget.
+///
+/// The position of the window on screen is unknown, so the pointer is moved to some position first and the hover
+/// event tells where that is in the window.
+Future<void> _moveToCenter(WidgetTester tester, _XTest x, Finder finder, Stream<Offset> hovers) async {
+  const probe = Offset(100, 100);
+  // The X server works in physical pixels, the hover events in logical ones.
+  final ratio = tester.view.devicePixelRatio;
+  final hover = hovers.first.timeout(const Duration(seconds: 5));
+  x.moveTo(probe);
+  final origin = probe - await hover * ratio;
+  final center = origin + tester.getCenter(finder) * ratio;
+  final arrived = hovers.firstWhere((position) => (origin + position * ratio - center).distance < 1);
+  x.moveTo(center);
+  await arrived.timeout(const Duration(seconds: 5));
+}
+
+/// Runs one scenario and summarizes what the recorder and the frame timings saw meanwhile.
+Future<Map<String, Object?>> _measure(Future<void> Function(_Recorder recorder) run) async {
+  final timings = <FrameTiming>[];
+  void onTimings(List<FrameTiming> batch) => timings.addAll(batch);
+  SchedulerBinding.instance.addTimingsCallback(onTimings);
+  final recorder = _Recorder();
+  try {
+    await run(recorder);
+    await Future<void>.delayed(_settleTime);
+  } finally {
+    SchedulerBinding.instance.removeTimingsCallback(onTimings);
+  }
+  return {
+    ...recorder.toJson(),
+    'frames': timings.length,
+    'buildMicros': _summary([for (final timing in timings) timing.buildDuration.inMicroseconds]),
+    'rasterMicros': _summary([for (final timing in timings) timing.rasterDuration.inMicroseconds]),
+  };
+}
+
+/// Injects the scripted motion and matches the delivered deltas with it.
+///
+/// Each motion moves right by [_step] pixels (and up or down by one pixel, alternately), so the horizontal movement
+/// delivered so far tells which motions have arrived, even if several of them have been merged into one event.
+class _Recorder {
+  final _clock = Stopwatch()..start();
+  // Injection times and the horizontal movement injected until then, oldest first, of motions not delivered yet
+  final _pendingTimes = <int>[];
+  final _pendingTotals = <int>[];
+  var _injected = 0;
+  var _injectedX = 0;
+  var _injectedY = 0;
+  var _delivered = 0;
+  var _deliveredX = 0.0;
+  var _deliveredY = 0.0;
+  int? _firstDeliveryMicros;
+  int? _lastDeliveryMicros;
+  final _latencies = <int>[];
+
+  /// Injects the motions at [_rate], catching up if the timer fires late.
+  Future<void> inject(_XTest x) async {
+    final interval = 1000000 ~/ _rate;
+    final start = _clock.elapsedMicroseconds;
+    while (_injected < _motions) {
+      final due = math.min(_motions, (_clock.elapsedMicroseconds - start) ~/ interval + 1);
+      while (_injected < due) {
+        final dy = _injected.isEven ? 1 : -1;
+        x.moveBy(_step, dy);
+        _injected++;
+        _injectedX += _step;
+        _injectedY += dy;
+        _pendingTimes.add(_clock.elapsedMicroseconds);
+        _pendingTotals.add(_injectedX);
+      }
+      await Future<void>.delayed(Duration(microseconds: interval));
+    }
+  }
+
+  void deliver(Offset delta) {
+    final now = _clock.elapsedMicroseconds;
+    _firstDeliveryMicros ??= now;
+    _lastDeliveryMicros = now;
+    _delivered++;
+    _deliveredX += delta.dx;
+    _deliveredY += delta.dy;
+    // The latest motion contained in this event determines the latency.
+    int? injectedAt;
+    var count = 0;
+    while (count < _pendingTotals.length && _pendingTotals[count] <= _deliveredX + 0.5) {
+      injectedAt = _pendingTimes[count];
+      count++;
+    }
+    _pendingTimes.removeRange(0, count);
+    _pendingTotals.removeRange(0, count);
+    if (injectedAt != null) {
+      _latencies.add(now - injectedAt);
+    }
+  }
+
+  Map<String, Object?> toJson() {
+    final deliveryMicros = (_lastDeliveryMicros ?? 0) - (_firstDeliveryMicros ?? 0);
+    return {
+      'injectedEvents': _injected,
+      'deliveredEvents': _delivered,
+      'injectedX': _injectedX,
+      'injectedY': _injectedY,
+      'deliveredX': _deliveredX,
+      'deliveredY': _deliveredY,
+      'deliveredEventsPerSecond': deliveryMicros > 0 ? (_delivered - 1) * 1e6 / deliveryMicros : null,
+      'latencyMicros': _summary(_latencies),
+    };
+  }
+}
+
+/// The drag area under test. It rebuilds a child each frame from [PointerLockDragArea.dragOffset], like a typical
+/// viewport, and passes each move to the current recorder.
+class _DragAreaTarget {
+  static const areaKey = Key('dragArea');
+
+  final _hovers = StreamController<Offset>.broadcast();
+  final _dragOffset = ValueNotifier(Offset.zero);
+  var locked = Completer<void>();
+  var unlocked = Completer<void>();
+  _Recorder? recorder;
+
+  Stream<Offset> get hovers => _hovers.stream;
+
+  Widget build() {
+    return MaterialApp(
+      home: Listener(
+        onPointerHover: (event) => _hovers.add(event.position),
+        child: Center(
+          child: PointerLockDragArea(
+            key: areaKey,
+            dragOffset: _dragOffset,
+            onLock: (details) => locked.complete(),
+            onMove: (details) => recorder?.deliver(details.move.delta),
+            onUnlock: (details) => unlocked.complete(),
+            child: SizedBox(
+              width: 400,
+              height: 400,
+              child: ValueListenableBuilder<Offset>(
+                valueListenable: _dragOffset,
+                builder: (context, offset, child) => ColoredBox(
+                  color: Colors.grey,
+                  child: Center(child: Text('${offset.dx.toStringAsFixed(0)}, ${offset.dy.toStringAsFixed(0)}')),
+                ),
+              ),
+            ),
+          ),
+        ),
+      ),
+    );
+  }
+}
+
+Map<String, Object?>? _summary(List<int> values) {
+  if (values.isEmpty) {
+    return null;
+  }
+  final sorted = [...values]..sort();
+  int percentile(double p) => sorted[((sorted.length - 1) * p).round()];
+  return {
+    'count': sorted.length,
+    'mean': sorted.reduce((a, b) => a + b) / sorted.length,
+    'p50': percentile(0.5),
+    'p90': percentile(0.9),
+    'p99': percentile(0.99),
+    'max': sorted.last,
+  };
+}
+
+typedef _XOpenDisplayNative = Pointer<Void> Function(Pointer<Char> name);
+typedef _XOpenDisplay = Pointer<Void> Function(Pointer<Char> name);
+typedef _XDisplayFunctionNative = Int Function(Pointer<Void> display);
+typedef _XDisplayFunction = int Function(Pointer<Void> display);
+typedef _XTestFakeMotionEventNative = Int Function(Pointer<Void> display, Int screen, Int x, Int y, UnsignedLong delay);
+typedef _XTestFakeMotionEvent = int Function(Pointer<Void> display, int screen, int x, int y, int delay);
+typedef _XTestFakeRelativeMotionEventNative = Int Function(Pointer<Void> display, Int x, Int y, UnsignedLong delay);
+typedef _XTestFakeRelativeMotionEvent = int Function(Pointer<Void> display, int x, int y, int delay);
+typedef _XTestFakeButtonEventNative = Int Function(
+    Pointer<Void> display, UnsignedInt button, Int isPress, UnsignedLong delay);
+typedef _XTestFakeButtonEvent = int Function(Pointer<Void> display, int button, int isPress, int delay);
+
+/// Injects pointer input into the X server via the XTest extension, on a connection of its own.
+class _XTest {
+  final Pointer<Void> _display;
+  final _XDisplayFunction _flush;
+  final _XDisplayFunction _closeDisplay;
+  final _XTestFakeMotionEvent _fakeMotion;
+  final _XTestFakeRelativeMotionEvent _fakeRelativeMotion;
+  final _XTestFakeButtonEvent _fakeButton;
+
+  _XTest._(this._display, DynamicLibrary x11, DynamicLibrary xTest)
+      : _flush = x11.lookupFunction<_XDisplayFunctionNative, _XDisplayFunction>('XFlush'),
+        _closeDisplay = x11.lookupFunction<_XDisplayFunctionNative, _XDisplayFunction>('XCloseDisplay'),
+        _fakeMotion = xTest.lookupFunction<_XTestFakeMotionEventNative, _XTestFakeMotionEvent>('XTestFakeMotionEvent'),
+        _fakeRelativeMotion = xTest.lookupFunction<_XTestFakeRelativeMotionEventNative, _XTestFakeRelativeMotionEvent>(
+            'XTestFakeRelativeMotionEvent'),
+        _fakeButton = xTest.lookupFunction<_XTestFakeButtonEventNative, _XTestFakeButtonEvent>('XTestFakeButtonEvent');
+
+  /// Returns `null` if there's no X server or the libraries are missing (e.g. on Wayland without Xwayland).
+  static _XTest? open() {
+    if (Platform.environment['DISPLAY'] == null) {
+      return null;
+    }
+    try {
+      final x11 = DynamicLibrary.open('libX11.so.6');
+      final xTest = DynamicLibrary.open('libXtst.so.6');
+      final display = x11.lookupFunction<_XOpenDisplayNative, _XOpenDisplay>('XOpenDisplay')(nullptr);
+      return display == nullptr ? null : _XTest._(display, x11, xTest);
+    } on ArgumentError {
+      return null;
+    }
+  }
+
+  /// Moves the pointer to the given position on screen (in pixels of the X server).
+  void moveTo(Offset position) {
+    _fakeMotion(_display, -1, position.dx.round(), position.dy.round(), 0);
+    _flush(_display);
+  }
+
+  void moveBy(int dx, int dy) {
+    _fakeRelativeMotion(_display, dx, dy, 0);
+    _flush(_display);
+  }
+
+  /// Presses or releases the primary button.
+  void pressButton(bool press) {
+    _fakeButton(_display, 1, press ? 1 : 0, 0);
+    _flush(_display);
+  }
+
+  void close() {
+    _closeDisplay(_display);
+  }
 }
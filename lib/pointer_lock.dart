@@ -1,2 +1,5 @@
-export 'src/pointer_lock.dart' show pointerLock, PointerLockWindowsMode, PointerLockCursor, PointerLockMoveEvent;
-export 'src/pointer_lock_drag_area.dart';
\ No newline at end of file
+export 'src/pointer_lock.dart' show pointerLock, PointerLockWindowsMode, PointerLockCursor, PointerLockMoveEvent, PointerLockEventKind, PointerLockModifiers, PointerLockDevice, PointerLockMotionHistory;
+export 'src/pointer_lock_batch.dart' show PointerLockEventBatch;
+export 'src/pointer_lock_drag_area.dart';
+export 'src/pointer_lock_options.dart';
+export 'src/pointer_lock_shared_session.dart' show PointerLockSharedSession, PointerLockDeliveryPolicy;
@@ -1,8 +1,12 @@
+import 'dart:typed_data';
 import 'dart:ui';
 
 import 'package:flutter/foundation.dart';
 
+import 'pointer_lock_batch.dart';
+import 'pointer_lock_options.dart';
 import 'pointer_lock_platform_interface.dart';
+import 'pointer_lock_shared_session.dart';
 
 /// The entry point for everything related to pointer locking
 const pointerLock = PointerLock();
@@ -32,9 +36,7 @@ class PointerLock {
   bool reportsPointerUpDownEventsReliably({
     required PointerLockWindowsMode windowsMode,
   }) {
-    if (defaultTargetPlatform == TargetPlatform.linux ||
-        defaultTargetPlatform == TargetPlatform.windows &&
-            windowsMode == PointerLockWindowsMode.capture) {
+    if (defaultTargetPlatform == TargetPlatform.windows && windowsMode == PointerLockWindowsMode.capture) {
       return false;
     }
     return true;
@@ -50,15 +52,48 @@ class PointerLock {
   /// If you set `unlockOnPointerUp` to `true`, the stream will end naturally when any pointer button is released.
   /// `onDone` is triggered and the pointer unlocks. Pointer up and down events will not be emitted while the
   /// pointer is locked.
+  ///
+  /// Pass a [transform] to let the platform scale, accelerate and remap the deltas natively (see
+  /// [PointerLockTransform] for platform support).
+  ///
+  /// Pass a [filter] to receive smoothed deltas in [PointerLockMoveEvent.filteredDelta]. Set [velocityWindow] to
+  /// the number of recent samples from which [PointerLockMoveEvent.velocity] and
+  /// [PointerLockMoveEvent.acceleration] should be estimated (zero disables the estimation). Both are computed
+  /// natively, at the moment only on Linux.
+  ///
+  /// Pass a [prediction] to receive [PointerLockMoveEvent.predictedDelta] (at the moment only on Linux).
+  ///
+  /// Pass a [valueMode] to receive a bounded value in [PointerLockMoveEvent.value] instead of processing each delta.
+  ///
+  /// Pass a [virtualCursor] to let the session move it by the deltas. The session continues from the cursor's
+  /// current position, so the same cursor can be passed to consecutive sessions.
+  ///
+  /// By default, the stream only contains move events. Set [includeButtonAndScrollEvents] to receive button and
+  /// scroll events in the same stream as well, in the order in which they happened (at the moment only on Linux, see
+  /// [PointerLockMoveEvent.kind]).
   Stream<PointerLockMoveEvent> createSession({
     PointerLockWindowsMode windowsMode = PointerLockWindowsMode.capture,
     PointerLockCursor cursor = PointerLockCursor.hidden,
     bool unlockOnPointerUp = false,
+    PointerLockTransform? transform,
+    PointerLockFilter? filter,
+    int velocityWindow = 0,
+    PointerLockPrediction? prediction,
+    PointerLockValueMode? valueMode,
+    PointerLockVirtualCursor? virtualCursor,
+    bool includeButtonAndScrollEvents = false,
   }) {
     return PointerLockPlatform.instance.createSession(
       windowsMode: windowsMode,
       cursor: cursor,
       unlockOnPointerUp: unlockOnPointerUp,
+      transform: transform,
+      filter: filter,
+      velocityWindow: velocityWindow,
+      prediction: prediction,
+      valueMode: valueMode,
+      virtualCursor: virtualCursor,
+      includeButtonAndScrollEvents: includeButtonAndScrollEvents,
     );
   }
 
@@ -93,19 +128,354 @@ class PointerLock {
     return PointerLockPlatform.instance.showPointer();
   }
 
+  /// Like [createSession], but delivers the events in batches, stored column by column in typed-data lists.
+  ///
+  /// Meant for consumers of high-rate input which process many events at once. On Linux, the batch columns are views
+  /// on the data sent by the platform, so no object is allocated per event. On other platforms, the events received
+  /// within one turn of the event loop are grouped into one batch. Batch objects and their storage are recycled, see
+  /// [PointerLockEventBatch].
+  ///
+  /// Not supported on web when compiled to JavaScript, which lacks `Int64List`.
+  Stream<PointerLockEventBatch> createBatchedSession({
+    PointerLockWindowsMode windowsMode = PointerLockWindowsMode.capture,
+    PointerLockCursor cursor = PointerLockCursor.hidden,
+    bool unlockOnPointerUp = false,
+    PointerLockTransform? transform,
+  }) {
+    return PointerLockPlatform.instance.createBatchedSession(
+      windowsMode: windowsMode,
+      cursor: cursor,
+      unlockOnPointerUp: unlockOnPointerUp,
+      transform: transform,
+    );
+  }
+
+  /// Confines the pointer to the given rectangle (in logical pixels of the view) instead of locking it.
+  ///
+  /// Unlike with [createSession], the pointer keeps moving (and Flutter keeps receiving its motion), it just can't
+  /// leave the rectangle. Move events carry the pointer [PointerLockMoveEvent.position] in addition to the delta. Meant
+  /// for tools like scrubbers or box selection. To confine the pointer to a widget, pass its bounds in global
+  /// coordinates, e.g. `renderBox.localToGlobal(Offset.zero) & renderBox.size`.
+  ///
+  /// The pointer is released when the subscription is cancelled (or on pointer up if [unlockOnPointerUp] is `true`).
+  /// At the moment, this is only supported on Linux with X11. Elsewhere, the stream reports an [UnsupportedError].
+  Stream<PointerLockMoveEvent> createConfinedSession({
+    required Rect rect,
+    PointerLockCursor cursor = PointerLockCursor.normal,
+    bool unlockOnPointerUp = false,
+    PointerLockTransform? transform,
+  }) {
+    return PointerLockPlatform.instance.createConfinedSession(
+      rect: rect,
+      cursor: cursor,
+      unlockOnPointerUp: unlockOnPointerUp,
+      transform: transform,
+    );
+  }
+
+  /// Like [createSession], but lets several subscribers receive the events of one session, each with its own
+  /// [PointerLockDeliveryPolicy] (see [PointerLockSharedSession]).
+  ///
+  /// The pointer stays locked as long as at least one subscription is listened to. Meanwhile, the shared session is
+  /// the only one: listening to another session (e.g. from [createSession]) reports a [StateError], so components
+  /// which need the same session should subscribe to it instead. The same applies the other way round.
+  PointerLockSharedSession createSharedSession({
+    PointerLockWindowsMode windowsMode = PointerLockWindowsMode.capture,
+    PointerLockCursor cursor = PointerLockCursor.hidden,
+    bool unlockOnPointerUp = false,
+    PointerLockTransform? transform,
+    PointerLockFilter? filter,
+    int velocityWindow = 0,
+    PointerLockPrediction? prediction,
+  }) {
+    return PointerLockPlatform.instance.createSharedSession(
+      windowsMode: windowsMode,
+      cursor: cursor,
+      unlockOnPointerUp: unlockOnPointerUp,
+      transform: transform,
+      filter: filter,
+      velocityWindow: velocityWindow,
+      prediction: prediction,
+    );
+  }
+
+  /// Changes parameters of the active session (created via [createSession] or [createSharedSession]) without
+  /// unlocking the pointer, e.g. to switch to a finer [transform] in the middle of a drag.
+  ///
+  /// Parameters which are `null` keep their values. If the session has a value mode already, passing a [valueMode]
+  /// keeps the current value and ignores [PointerLockValueMode.start]. The filter and the transform keep their state,
+  /// so the movement continues seamlessly. To change how a subscription of a shared session receives the events, see
+  /// [PointerLockSharedSession.updateSubscription].
+  ///
+  /// At the moment, this is only supported on Linux. Elsewhere, the returned future completes with an
+  /// [UnsupportedError].
+  Future<void> updateSession({
+    bool? unlockOnPointerUp,
+    PointerLockTransform? transform,
+    PointerLockFilter? filter,
+    PointerLockValueMode? valueMode,
+  }) {
+    return PointerLockPlatform.instance.updateSession(
+      unlockOnPointerUp: unlockOnPointerUp,
+      transform: transform,
+      filter: filter,
+      valueMode: valueMode,
+    );
+  }
+
   /// A utility function that returns the position of the pointer in screen coordinates.
   Future<Offset> pointerPositionOnScreen() {
     return PointerLockPlatform.instance.pointerPositionOnScreen();
   }
+
+  /// Samples the position of the pointer in screen coordinates once per frame while it changes.
+  ///
+  /// Meant for tracking the pointer while it's not locked, also outside of the window. Positions the pointer passes
+  /// between two frames are not reported, so use a session if every movement matters. On Linux with X11, the
+  /// platform samples only after the pointer moved. Other platforms poll [pointerPositionOnScreen] about once per
+  /// frame.
+  /// Cancel the subscription to stop tracking.
+  Stream<Offset> pointerPositionStream() {
+    return PointerLockPlatform.instance.pointerPositionStream();
+  }
+
+  /// Returns the physical pointing devices (mice, touchpads, trackballs, ...) known to the platform.
+  ///
+  /// Their IDs match [PointerLockMoveEvent.deviceId], so motion of several devices used at the same time can be
+  /// told apart. At the moment, this is only supported on Linux. Other platforms return an empty list.
+  Future<List<PointerLockDevice>> pointingDevices() {
+    return PointerLockPlatform.instance.pointingDevices();
+  }
+
+  /// Returns the move samples of the current or most recent session which happened within the given [window]
+  /// before now.
+  ///
+  /// The platform keeps the latest samples (about a second's worth) in a bounded buffer and only transfers them when
+  /// asked, which is useful for gestures such as flicks that need to look back at decision time. At the moment, this
+  /// is only supported on Linux. Other platforms return an empty history.
+  Future<PointerLockMotionHistory> motionHistory({Duration window = const Duration(milliseconds: 300)}) {
+    return PointerLockPlatform.instance.motionHistory(window: window);
+  }
 }
 
 /// This event is emitted whenever you move the pointer while it's locked.
+///
+/// Platforms which read the input natively while the pointer is locked (at the moment Linux) can also report button
+/// and scroll events in the same stream, distinguished by [kind]. They are reported in the order in which they
+/// happened. [PointerLock.createSession] only does so if asked to (see its `includeButtonAndScrollEvents`), the
+/// streams of batched, confined and shared sessions always do.
 class PointerLockMoveEvent {
+  /// What kind of event this is. For platforms other than Linux, this is always [PointerLockEventKind.move].
+  final PointerLockEventKind kind;
+
   /// The amount the pointer has been dragged in the coordinate space of the event
   /// receiver since the previous update.
+  ///
+  /// On Linux, this is in logical pixels, see [physicalDelta].
+  ///
+  /// For [PointerLockEventKind.scroll] events, this is the amount scrolled instead, measured in notches of a
+  /// classic scroll wheel. High-resolution wheels and touchpads report fractional values.
   final Offset delta;
 
-  PointerLockMoveEvent({required this.delta});
+  /// The button that went down or up, for [PointerLockEventKind.buttonDown] and [PointerLockEventKind.buttonUp]
+  /// events (e.g. `kPrimaryButton`). Zero for other events.
+  final int button;
+
+  /// The buttons that were pressed when the event happened, as combination of button constants such as
+  /// `kPrimaryButton`. Always zero on platforms that don't read the input natively (see [kind]).
+  final int buttons;
+
+  /// The modifier keys that were pressed when the event happened.
+  ///
+  /// This is sampled together with the event itself, so it's accurate even for a modifier pressed right after
+  /// a quick movement. Always [PointerLockModifiers.none] on platforms that don't read the input natively.
+  final PointerLockModifiers modifiers;
+
+  /// The ID of the physical device which produced the event (see [PointerLock.pointingDevices]).
+  ///
+  /// Zero on platforms that don't read the input natively (see [kind]).
+  final int deviceId;
+
+  /// The time at which the event happened, measured on the monotonic clock of the platform.
+  ///
+  /// Only comparable with timestamps of other events. `null` if the platform doesn't report timestamps. On Linux,
+  /// this is the time at which the display server saw the input (in millisecond precision), not when the event was
+  /// delivered, so velocities computed from it aren't affected by batching or delays.
+  final Duration? timestamp;
+
+  /// The [delta] after smoothing by the session's [PointerLockFilter].
+  ///
+  /// Equals [delta] if the session doesn't filter. Only meaningful for [PointerLockEventKind.move] events. Once the
+  /// pointer rests for a frame, a filtering session delivers a move event with a zero [delta] and the remaining lag as
+  /// filtered delta.
+  final Offset filteredDelta;
+
+  /// The estimated pointer velocity in logical pixels per second.
+  ///
+  /// Zero unless the session estimates velocity (see `velocityWindow` in [PointerLock.createSession]). Only
+  /// meaningful for [PointerLockEventKind.move] events.
+  final Offset velocity;
+
+  /// The estimated pointer acceleration in logical pixels per second squared, see [velocity].
+  final Offset acceleration;
+
+  /// The [delta] plus the change of the predicted movement until the next frame is presented (see
+  /// [PointerLockPrediction]).
+  ///
+  /// Accumulating the predicted deltas yields the predicted pointer position. Once the pointer rests for a frame, the
+  /// session delivers a move event with a zero [delta] which takes the prediction back, so the predicted deltas add up
+  /// to the same total as the deltas (see [filteredDelta]). Equals [delta] if the session doesn't predict.
+  final Offset predictedDelta;
+
+  /// How reliable the prediction is, from 0 (no prediction) to 1.
+  final double predictionConfidence;
+
+  /// The current value if the session has been created with a [PointerLockValueMode], otherwise `null`.
+  ///
+  /// In value mode, move events are only delivered if the value changes. Their [delta] then only covers the
+  /// latest pointer sample, not the whole movement since the previous event.
+  final double? value;
+
+  /// The position of the session's [PointerLockVirtualCursor] after this event, `null` if the session doesn't have
+  /// one.
+  final Offset? cursorPosition;
+
+  /// The pointer position in logical pixels of the view after this event, `null` unless the session has been created
+  /// via [PointerLock.createConfinedSession].
+  final Offset? position;
+
+  /// The pointer's motion in physical pixels of the monitor on which the session started, `null` if the platform
+  /// doesn't report it (at the moment, only Linux does).
+  ///
+  /// Unlike [delta], it's taken before the session's [PointerLockTransform], so it doesn't include the gain, the
+  /// acceleration curve or the axis mapping. Moves which the transform drops (e.g. when quantizing) aren't
+  /// delivered, so their physical motion is missing. The platform keeps track of the monitor's scale factor. Only
+  /// reported for [PointerLockEventKind.move] events.
+  final Offset? physicalDelta;
+
+  PointerLockMoveEvent({
+    required this.delta,
+    this.kind = PointerLockEventKind.move,
+    this.button = 0,
+    this.buttons = 0,
+    this.modifiers = PointerLockModifiers.none,
+    this.deviceId = 0,
+    this.timestamp,
+    Offset? filteredDelta,
+    this.velocity = Offset.zero,
+    this.acceleration = Offset.zero,
+    Offset? predictedDelta,
+    this.predictionConfidence = 0,
+    this.value,
+    this.cursorPosition,
+    this.position,
+    this.physicalDelta,
+  })  : filteredDelta = filteredDelta ?? delta,
+        predictedDelta = predictedDelta ?? delta;
+}
+
+/// Recent move samples as returned by [PointerLock.motionHistory], oldest first.
+///
+/// The samples are stored column by column in one packed list. The column getters are views on it, not copies.
+class PointerLockMotionHistory {
+  /// An empty history.
+  static final empty = PointerLockMotionHistory.fromPacked(Float64List.fromList([0]));
+
+  /// The time of each sample in microseconds of the monotonic clock (see [PointerLockMoveEvent.timestamp]).
+  final Float64List timestamps;
+
+  /// The horizontal delta of each sample.
+  final Float64List dx;
+
+  /// The vertical delta of each sample.
+  final Float64List dy;
+
+  /// Wraps data packed as `[count, timestamps..., dx..., dy...]`.
+  factory PointerLockMotionHistory.fromPacked(Float64List data) {
+    final count = data.isEmpty ? 0 : data[0].toInt();
+    if (data.length < 1 + 3 * count) {
+      return empty;
+    }
+    return PointerLockMotionHistory._(
+      timestamps: Float64List.sublistView(data, 1, 1 + count),
+      dx: Float64List.sublistView(data, 1 + count, 1 + 2 * count),
+      dy: Float64List.sublistView(data, 1 + 2 * count, 1 + 3 * count),
+    );
+  }
+
+  PointerLockMotionHistory._({required this.timestamps, required this.dx, required this.dy});
+
+  /// The number of samples.
+  int get length => timestamps.length;
+}
+
+/// A physical pointing device as reported by [PointerLock.pointingDevices].
+class PointerLockDevice {
+  /// The ID used in [PointerLockMoveEvent.deviceId].
+  final int id;
+
+  /// The human-readable name of the device.
+  final String name;
+
+  /// The kind of device, e.g. "mouse", "touchpad", "trackpoint", "pen", "touchscreen" or "other".
+  final String source;
+
+  /// The USB vendor ID, empty if unknown.
+  final String vendorId;
+
+  /// The USB product ID, empty if unknown.
+  final String productId;
+
+  PointerLockDevice({
+    required this.id,
+    required this.name,
+    required this.source,
+    required this.vendorId,
+    required this.productId,
+  });
+}
+
+/// The modifier keys pressed at the time of a [PointerLockMoveEvent].
+class PointerLockModifiers {
+  static const _shiftBit = 1 << 0;
+  static const _controlBit = 1 << 1;
+  static const _altBit = 1 << 2;
+  static const _metaBit = 1 << 3;
+
+  /// No modifier key pressed.
+  static const none = PointerLockModifiers.fromBits(0);
+
+  /// The raw bits as delivered by the platform (see `Modifier` in `pointer_lock_events.h`).
+  final int bits;
+
+  const PointerLockModifiers.fromBits(this.bits);
+
+  /// Whether Shift was pressed.
+  bool get shift => bits & _shiftBit != 0;
+
+  /// Whether Control was pressed.
+  bool get control => bits & _controlBit != 0;
+
+  /// Whether Alt was pressed.
+  bool get alt => bits & _altBit != 0;
+
+  /// Whether Super (the "Windows" key) or Meta was pressed.
+  bool get meta => bits & _metaBit != 0;
+}
+
+/// The kinds of [PointerLockMoveEvent]s.
+enum PointerLockEventKind {
+  /// The pointer moved.
+  move,
+
+  /// A pointer button was pressed.
+  buttonDown,
+
+  /// A pointer button was released.
+  buttonUp,
+
+  /// The scroll wheel (or an equivalent) was used.
+  scroll,
 }
 
 /// A selection of cursors that can be displayed while the pointer is locked.
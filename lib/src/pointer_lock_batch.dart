@@ -0,0 +1,366 @@
+import 'dart:async';
+import 'dart:typed_data';
+
+import 'pointer_lock.dart';
+import 'pointer_lock_shared_session.dart';
+
+/// Columns of a batch encoded by `EventBatch` in `pointer_lock_events.h`. Must be kept in sync.
+///
+/// The columns are preceded by a header of [nativeBatchHeaderLength] values: the number of events, the ID of the
+/// subscription which receives the batch (see [PointerLockSharedSession]) and a mask with bit `1 << column.index`
+/// set for each column contained in the batch. Columns of features the session doesn't use are left out (see
+/// [NativeBatchLayout]). Integer columns (and the header) are stored as int64 bit patterns in the double slots, so
+/// they can be viewed as [Int64List] without converting each value.
+enum NativeBatchColumn {
+  kind,
+  dx,
+  dy,
+  timestamp,
+  button,
+  buttons,
+  modifiers,
+  device,
+  filteredDx,
+  filteredDy,
+  velocityX,
+  velocityY,
+  accelerationX,
+  accelerationY,
+  predictedDx,
+  predictedDy,
+  predictionConfidence,
+  value,
+  cursorX,
+  cursorY,
+  positionX,
+  positionY,
+  physicalDx,
+  physicalDy,
+}
+
+const nativeBatchHeaderLength = 3;
+
+/// Where the columns of a native batch are.
+class NativeBatchLayout {
+  /// The columns contained in every batch (`kBaseColumns` in `pointer_lock_events.h`).
+  static const baseColumns = [
+    NativeBatchColumn.kind,
+    NativeBatchColumn.dx,
+    NativeBatchColumn.dy,
+    NativeBatchColumn.timestamp,
+    NativeBatchColumn.button,
+    NativeBatchColumn.buttons,
+    NativeBatchColumn.modifiers,
+    NativeBatchColumn.device,
+    NativeBatchColumn.physicalDx,
+    NativeBatchColumn.physicalDy,
+  ];
+
+  /// The batch.
+  final Float64List values;
+
+  /// The batch, viewed as integers.
+  final Int64List ints;
+
+  /// The number of events in the batch.
+  final int count;
+
+  /// The index at which each column starts, -1 for columns not contained in the batch.
+  final List<int> _starts;
+
+  NativeBatchLayout._(this.values, this.ints, this.count, this._starts);
+
+  /// Locates the columns of the given batch. Returns `null` if the batch is malformed.
+  static NativeBatchLayout? of(Float64List batch) {
+    if (batch.length < nativeBatchHeaderLength) {
+      return null;
+    }
+    final ints = Int64List.sublistView(batch);
+    final count = ints[0];
+    final mask = ints[2];
+    if (count < 0) {
+      return null;
+    }
+    final starts = List<int>.filled(NativeBatchColumn.values.length, -1);
+    var next = nativeBatchHeaderLength;
+    for (final column in NativeBatchColumn.values) {
+      if (mask & (1 << column.index) != 0) {
+        starts[column.index] = next;
+        next += count;
+      }
+    }
+    if (batch.length < next || baseColumns.any((column) => starts[column.index] < 0)) {
+      return null;
+    }
+    return NativeBatchLayout._(batch, ints, count, starts);
+  }
+
+  /// Whether the batch contains the given column.
+  bool contains(NativeBatchColumn column) => _starts[column.index] >= 0;
+
+  /// The value of the event at the given index in a column of doubles, which must be contained in the batch.
+  double value(NativeBatchColumn column, int index) => values[_starts[column.index] + index];
+
+  /// The value of the event at the given index in a column of integers, which must be contained in the batch.
+  int intValue(NativeBatchColumn column, int index) => ints[_starts[column.index] + index];
+
+  /// A view on a column of doubles, which must be contained in the batch.
+  Float64List floatColumn(NativeBatchColumn column) {
+    final start = _starts[column.index];
+    return Float64List.sublistView(values, start, start + count);
+  }
+
+  /// A view on a column of integers, which must be contained in the batch.
+  Int64List intColumn(NativeBatchColumn column) {
+    final start = _starts[column.index];
+    return Int64List.sublistView(ints, start, start + count);
+  }
+
+  /// Whether the kind of the event at the given index is one of [PointerLockEventKind.values]. A newer native side
+  /// could send kinds this version doesn't know.
+  bool hasKnownKind(int index) {
+    final kind = intValue(NativeBatchColumn.kind, index);
+    return kind >= 0 && kind < PointerLockEventKind.values.length;
+  }
+}
+
+/// Events delivered by [PointerLock.createBatchedSession], stored column by column in typed-data lists.
+///
+/// Index `i` of each column belongs to the same event. A batch is only valid during the listener call that
+/// delivers it. Afterwards, the session recycles it for later batches, so copy whatever you want to keep.
+class PointerLockEventBatch {
+  static final _emptyFloats = Float64List(0);
+  static final _emptyInts = Int64List(0);
+
+  // Number of columns of batches which are assembled in Dart: kind, timestamp, button, buttons, modifiers and device
+  // ID, then dx and dy.
+  static const _intColumns = 6;
+  static const _floatColumns = 2;
+
+  int _length = 0;
+  Int64List _kinds = _emptyInts;
+  Float64List _dx = _emptyFloats;
+  Float64List _dy = _emptyFloats;
+  Int64List _timestamps = _emptyInts;
+  Int64List _button = _emptyInts;
+  Int64List _buttons = _emptyInts;
+  Int64List _modifiers = _emptyInts;
+  Int64List _deviceIds = _emptyInts;
+
+  // Storage for batches which are assembled in Dart, grown as needed and reused.
+  int _capacity = 0;
+  Int64List _ints = _emptyInts;
+  Float64List _floats = _emptyFloats;
+
+  PointerLockEventBatch._();
+
+  /// The number of events in this batch.
+  int get length => _length;
+
+  /// The kind of each event, as index of [PointerLockEventKind.values] (see [kindAt]).
+  Int64List get kinds => _kinds;
+
+  /// The horizontal delta of each event (see [PointerLockMoveEvent.delta]).
+  Float64List get dx => _dx;
+
+  /// The vertical delta of each event (see [PointerLockMoveEvent.delta]).
+  Float64List get dy => _dy;
+
+  /// The time of each event in microseconds of the platform's monotonic clock, zero if unknown (see
+  /// [PointerLockMoveEvent.timestamp]).
+  Int64List get timestamps => _timestamps;
+
+  /// The button that went down or up (see [PointerLockMoveEvent.button]).
+  Int64List get button => _button;
+
+  /// The buttons pressed during each event, as combination of Flutter's button constants (see
+  /// [PointerLockMoveEvent.buttons]).
+  Int64List get buttons => _buttons;
+
+  /// The modifier bits of each event (see [PointerLockModifiers.fromBits]).
+  Int64List get modifiers => _modifiers;
+
+  /// The ID of the device which produced each event (see [PointerLockMoveEvent.deviceId]).
+  Int64List get deviceIds => _deviceIds;
+
+  /// The kind of the event at the given index.
+  PointerLockEventKind kindAt(int index) => PointerLockEventKind.values[_kinds[index]];
+
+  /// Points the columns to the matching slices of a native batch. Returns `false` if the batch is malformed or
+  /// contains events of unknown kinds (which [kindAt] couldn't represent).
+  bool _wrapNative(Float64List batch) {
+    final layout = NativeBatchLayout.of(batch);
+    if (layout == null) {
+      return false;
+    }
+    for (var i = 0; i < layout.count; i++) {
+      if (!layout.hasKnownKind(i)) {
+        return false;
+      }
+    }
+    _length = layout.count;
+    _kinds = layout.intColumn(NativeBatchColumn.kind);
+    _dx = layout.floatColumn(NativeBatchColumn.dx);
+    _dy = layout.floatColumn(NativeBatchColumn.dy);
+    _timestamps = layout.intColumn(NativeBatchColumn.timestamp);
+    _button = layout.intColumn(NativeBatchColumn.button);
+    _buttons = layout.intColumn(NativeBatchColumn.buttons);
+    _modifiers = layout.intColumn(NativeBatchColumn.modifiers);
+    _deviceIds = layout.intColumn(NativeBatchColumn.device);
+    return true;
+  }
+
+  /// Appends an event to a batch assembled in Dart.
+  void _add(PointerLockMoveEvent event) {
+    if (_length == _capacity) {
+      _grow();
+    }
+    final i = _length;
+    final c = _capacity;
+    _ints[i] = event.kind.index;
+    _ints[c + i] = event.timestamp?.inMicroseconds ?? 0;
+    _ints[2 * c + i] = event.button;
+    _ints[3 * c + i] = event.buttons;
+    _ints[4 * c + i] = event.modifiers.bits;
+    _ints[5 * c + i] = event.deviceId;
+    _floats[i] = event.delta.dx;
+    _floats[c + i] = event.delta.dy;
+    _length++;
+  }
+
+  /// Points the columns to the events added via [_add].
+  void _sealAssembled() {
+    final c = _capacity;
+    final n = _length;
+    _kinds = Int64List.sublistView(_ints, 0, n);
+    _timestamps = Int64List.sublistView(_ints, c, c + n);
+    _button = Int64List.sublistView(_ints, 2 * c, 2 * c + n);
+    _buttons = Int64List.sublistView(_ints, 3 * c, 3 * c + n);
+    _modifiers = Int64List.sublistView(_ints, 4 * c, 4 * c + n);
+    _deviceIds = Int64List.sublistView(_ints, 5 * c, 5 * c + n);
+    _dx = Float64List.sublistView(_floats, 0, n);
+    _dy = Float64List.sublistView(_floats, c, c + n);
+  }
+
+  void _grow() {
+    final oldCapacity = _capacity;
+    final newCapacity = oldCapacity == 0 ? 16 : oldCapacity * 2;
+    final ints = Int64List(_intColumns * newCapacity);
+    final floats = Float64List(_floatColumns * newCapacity);
+    for (var column = 0; column < _intColumns; column++) {
+      ints.setRange(column * newCapacity, column * newCapacity + _length, _ints, column * oldCapacity);
+    }
+    for (var column = 0; column < _floatColumns; column++) {
+      floats.setRange(column * newCapacity, column * newCapacity + _length, _floats, column * oldCapacity);
+    }
+    _capacity = newCapacity;
+    _ints = ints;
+    _floats = floats;
+  }
+
+  void _clear() {
+    _length = 0;
+  }
+}
+
+/// Recycles [PointerLockEventBatch] objects and their storage.
+class _BatchPool {
+  final _free = <PointerLockEventBatch>[];
+
+  PointerLockEventBatch acquire() {
+    final batch = _free.isEmpty ? PointerLockEventBatch._() : _free.removeLast();
+    batch._clear();
+    return batch;
+  }
+
+  void release(PointerLockEventBatch batch) {
+    _free.add(batch);
+  }
+}
+
+/// Delivers pooled batches synchronously, recycling each batch as soon as the listener has returned.
+class _BatchSink {
+  final _pool = _BatchPool();
+  final StreamController<PointerLockEventBatch> controller;
+
+  _BatchSink(this.controller);
+
+  void deliver(PointerLockEventBatch batch) {
+    // If the subscription is paused, the controller keeps the batch until it resumes, so it can't be recycled.
+    final recycle = controller.hasListener && !controller.isPaused;
+    controller.add(batch);
+    if (recycle) {
+      _pool.release(batch);
+    }
+  }
+}
+
+/// Turns a stream of encoded native batches into a stream of [PointerLockEventBatch]es without copying the columns.
+Stream<PointerLockEventBatch> batchNativeStream(Stream<dynamic> nativeStream) {
+  late final _BatchSink sink;
+  StreamSubscription<dynamic>? subscription;
+  final controller = StreamController<PointerLockEventBatch>(
+    sync: true,
+    onListen: () {
+      subscription = nativeStream.listen(
+        (payload) {
+          if (payload is! Float64List) {
+            return;
+          }
+          final batch = sink._pool.acquire();
+          if (batch._wrapNative(payload)) {
+            sink.deliver(batch);
+          }
+        },
+        onError: (Object error) => sink.controller.addError(error),
+        onDone: () => sink.controller.close(),
+      );
+    },
+    onCancel: () => subscription?.cancel(),
+  );
+  sink = _BatchSink(controller);
+  return controller.stream;
+}
+
+/// Groups the events of a stream into [PointerLockEventBatch]es, one per turn of the event loop.
+///
+/// For platforms that deliver events one by one. The batches and their storage are recycled.
+Stream<PointerLockEventBatch> batchEventStream(Stream<PointerLockMoveEvent> eventStream) {
+  late final _BatchSink sink;
+  StreamSubscription<PointerLockMoveEvent>? subscription;
+  PointerLockEventBatch? pending;
+  void flush() {
+    final batch = pending;
+    pending = null;
+    if (batch == null || sink.controller.isClosed) {
+      return;
+    }
+    batch._sealAssembled();
+    sink.deliver(batch);
+  }
+
+  final controller = StreamController<PointerLockEventBatch>(
+    sync: true,
+    onListen: () {
+      subscription = eventStream.listen(
+        (event) {
+          var batch = pending;
+          if (batch == null) {
+            batch = sink._pool.acquire();
+            pending = batch;
+            scheduleMicrotask(flush);
+          }
+          batch._add(event);
+        },
+        onError: (Object error) => sink.controller.addError(error),
+        onDone: () {
+          flush();
+          sink.controller.close();
+        },
+      );
+    },
+    onCancel: () => subscription?.cancel(),
+  );
+  sink = _BatchSink(controller);
+  return controller.stream;
+}
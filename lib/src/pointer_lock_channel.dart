@@ -1,10 +1,15 @@
 import 'dart:async';
+import 'dart:typed_data';
 import 'dart:ui';
 
 import 'package:flutter/foundation.dart';
 import 'package:flutter/services.dart';
 import 'pointer_lock.dart';
+import 'pointer_lock_batch.dart';
+import 'pointer_lock_options.dart';
 import 'pointer_lock_platform_interface.dart';
+import 'pointer_lock_shared_session.dart';
+import 'pointer_lock_value_mapper.dart';
 
 /// An implementation of [PointerLockPlatform] that uses channels.
 class ChannelPointerLock extends PointerLockPlatform {
@@ -16,8 +21,16 @@ class ChannelPointerLock extends PointerLockPlatform {
   @visibleForTesting
   final sessionEventChannel = const EventChannel('pointer_lock_session');
 
+  /// The event channel used for streaming the pointer position (only on Linux).
+  @visibleForTesting
+  final positionEventChannel = const EventChannel('pointer_lock_position');
+
   var _initialized = false;
 
+  // Whether a stream of [sessionEventChannel] is listened to. The channel has one handler per engine, so listening
+  // to a second stream would silently take over the events of the first one.
+  var _sessionEventsListened = false;
+
   @override
   Future<void> ensureInitialized() async {
     if (_initialized) {
@@ -32,12 +45,177 @@ class ChannelPointerLock extends PointerLockPlatform {
     required PointerLockWindowsMode windowsMode,
     required PointerLockCursor cursor,
     required bool unlockOnPointerUp,
+    PointerLockTransform? transform,
+    PointerLockFilter? filter,
+    int velocityWindow = 0,
+    PointerLockPrediction? prediction,
+    PointerLockValueMode? valueMode,
+    PointerLockVirtualCursor? virtualCursor,
+    bool includeButtonAndScrollEvents = false,
+  }) {
+    if ((valueMode != null || virtualCursor != null) && defaultTargetPlatform != TargetPlatform.linux) {
+      // Only the Linux session maps values and moves the virtual cursor natively, so we do it here on other platforms.
+      var stream = createSession(
+        windowsMode: windowsMode,
+        cursor: cursor,
+        unlockOnPointerUp: unlockOnPointerUp,
+        transform: transform,
+        filter: filter,
+        velocityWindow: velocityWindow,
+        prediction: prediction,
+      );
+      if (virtualCursor != null) {
+        stream = stream.map(VirtualCursorIntegrator(virtualCursor).map);
+      }
+      if (valueMode != null) {
+        stream = stream.expand(ValueMapper(valueMode).map);
+      }
+      return stream;
+    }
+    if (defaultTargetPlatform == TargetPlatform.windows) {
+      switch (windowsMode) {
+        case PointerLockWindowsMode.capture:
+          // Capture mode needs to be controlled from the native code because the Flutter Engine doesn't receive mouse
+          // events anymore while we are capturing them. The native code also hides and shows the cursor, so the
+          // session starts with one message.
+          return _createRawStreamNative(
+            arguments: _sessionArguments(
+              windowsMode: windowsMode,
+              cursor: cursor,
+              unlockOnPointerUp: unlockOnPointerUp,
+            ),
+          );
+        case PointerLockWindowsMode.clip:
+          // In clip mode, the Flutter Engine still receives mouse events, so we can control the stream from Dart.
+          return _createRawStreamDart(
+            windowsMode: windowsMode,
+            cursor: cursor,
+            unlockOnPointerUp: unlockOnPointerUp,
+          );
+      }
+    } else if (defaultTargetPlatform == TargetPlatform.macOS ||
+        defaultTargetPlatform == TargetPlatform.linux) {
+      // On macOS, we need to put the native code in control, otherwise we would only receive deltas while a mouse
+      // button is pressed. If the mouse button is not pressed, macOS generates mouse-move events instead of mouse-drag
+      // events. The Flutter Engine forwards mouse-move events to Dart only if the pointer coordinates change. But
+      // when doing locking the pointer via CGAssociateMouseAndMouseCursorPosition(0), the absolute coordinates don't
+      // change anymore.
+      //
+      // On Linux, the native code reads the grabbed GDK events directly and warps the pointer back synchronously.
+      // It can also report button and scroll events in the same stream, so we don't need to intercept all pointer
+      // data packets of the app.
+      //
+      // The native code also takes care of hiding and showing the cursor, so the session starts with one message.
+      return _createRawStreamNative(
+        arguments: _sessionArguments(
+          windowsMode: windowsMode,
+          cursor: cursor,
+          unlockOnPointerUp: unlockOnPointerUp,
+          transform: transform,
+          filter: filter,
+          velocityWindow: velocityWindow,
+          prediction: prediction,
+          valueMode: valueMode,
+          virtualCursor: virtualCursor,
+          buttonAndScrollEvents: includeButtonAndScrollEvents,
+        ),
+        virtualCursor: virtualCursor,
+      );
+    } else {
+      return _createRawStreamDart(
+        windowsMode: windowsMode,
+        cursor: cursor,
+        unlockOnPointerUp: unlockOnPointerUp,
+      );
+    }
+  }
+
+  @override
+  Stream<PointerLockEventBatch> createBatchedSession({
+    required PointerLockWindowsMode windowsMode,
+    required PointerLockCursor cursor,
+    required bool unlockOnPointerUp,
+    PointerLockTransform? transform,
   }) {
-    return _decorateRawStream(
+    if (defaultTargetPlatform != TargetPlatform.linux) {
+      return super.createBatchedSession(
+        windowsMode: windowsMode,
+        cursor: cursor,
+        unlockOnPointerUp: unlockOnPointerUp,
+        transform: transform,
+      );
+    }
+    // The Linux session sends batches already, so their columns can be used directly.
+    final arguments = _sessionArguments(
+      windowsMode: windowsMode,
       cursor: cursor,
-      rawStream: _createRawStream(
+      unlockOnPointerUp: unlockOnPointerUp,
+      transform: transform,
+    );
+    return batchNativeStream(_receiveSessionEvents(arguments));
+  }
+
+  @override
+  Stream<PointerLockMoveEvent> createConfinedSession({
+    required Rect rect,
+    required PointerLockCursor cursor,
+    required bool unlockOnPointerUp,
+    PointerLockTransform? transform,
+  }) {
+    if (defaultTargetPlatform != TargetPlatform.linux) {
+      return super.createConfinedSession(
+        rect: rect,
+        cursor: cursor,
+        unlockOnPointerUp: unlockOnPointerUp,
+        transform: transform,
+      );
+    }
+    // The Linux session confines the pointer to an invisible child window instead of warping it back.
+    return _createRawStreamNative(
+      arguments: {
+        ..._sessionArguments(
+          windowsMode: PointerLockWindowsMode.capture,
+          cursor: cursor,
+          unlockOnPointerUp: unlockOnPointerUp,
+          transform: transform,
+        ),
+        'confine': {'left': rect.left, 'top': rect.top, 'right': rect.right, 'bottom': rect.bottom},
+      },
+    );
+  }
+
+  @override
+  PointerLockSharedSession createSharedSession({
+    required PointerLockWindowsMode windowsMode,
+    required PointerLockCursor cursor,
+    required bool unlockOnPointerUp,
+    PointerLockTransform? transform,
+    PointerLockFilter? filter,
+    int velocityWindow = 0,
+    PointerLockPrediction? prediction,
+  }) {
+    if (defaultTargetPlatform != TargetPlatform.linux) {
+      return super.createSharedSession(
         windowsMode: windowsMode,
+        cursor: cursor,
         unlockOnPointerUp: unlockOnPointerUp,
+        transform: transform,
+        filter: filter,
+        velocityWindow: velocityWindow,
+        prediction: prediction,
+      );
+    }
+    // The Linux session fans out and coalesces natively, tagging each batch with the receiving subscription.
+    return _ChannelSharedSession(
+      this,
+      _sessionArguments(
+        windowsMode: windowsMode,
+        cursor: cursor,
+        unlockOnPointerUp: unlockOnPointerUp,
+        transform: transform,
+        filter: filter,
+        velocityWindow: velocityWindow,
+        prediction: prediction,
       ),
     );
   }
@@ -59,49 +237,116 @@ class ChannelPointerLock extends PointerLockPlatform {
     return _convertListToOffset(list);
   }
 
-  /// Decorates the given raw stream with hide/show cursor logic.
-  Stream<PointerLockMoveEvent> _decorateRawStream({
-    required PointerLockCursor cursor,
-    required Stream<PointerLockMoveEvent> rawStream,
+  @override
+  Stream<Offset> pointerPositionStream() {
+    if (defaultTargetPlatform != TargetPlatform.linux) {
+      return super.pointerPositionStream();
+    }
+    // Events are [x, y, timestamp, motion count]
+    return positionEventChannel.receiveBroadcastStream().map((event) => _convertListToOffset(event as List<double>));
+  }
+
+  @override
+  Future<List<PointerLockDevice>> pointingDevices() async {
+    if (defaultTargetPlatform != TargetPlatform.linux) {
+      return const [];
+    }
+    final list = await methodChannel.invokeListMethod<Map<Object?, Object?>>('pointingDevices');
+    return [
+      for (final device in list ?? const <Map<Object?, Object?>>[])
+        PointerLockDevice(
+          id: device['id'] as int,
+          name: device['name'] as String,
+          source: device['source'] as String,
+          vendorId: device['vendorId'] as String,
+          productId: device['productId'] as String,
+        ),
+    ];
+  }
+
+  @override
+  Future<void> updateSession({
+    bool? unlockOnPointerUp,
+    PointerLockTransform? transform,
+    PointerLockFilter? filter,
+    PointerLockValueMode? valueMode,
   }) {
-    final controller = StreamController<PointerLockMoveEvent>();
-    StreamSubscription<PointerLockMoveEvent>? rawStreamSubscription;
-    controller.onListen = () async {
-      if (cursor == PointerLockCursor.hidden) {
-        await _hidePointer();
-      }
-      // Reacting to onDone is not necessary because the raw stream is infinite
-      rawStreamSubscription = rawStream.listen(
-        controller.add,
-        cancelOnError: false,
-        onError: (Object error) => controller.addError(error),
-        // This will only be called if the raw stream was created with unlockOnPointerUp (automatic unlocking)
-        onDone: () => controller.close(),
+    if (defaultTargetPlatform != TargetPlatform.linux) {
+      return super.updateSession(
+        unlockOnPointerUp: unlockOnPointerUp,
+        transform: transform,
+        filter: filter,
+        valueMode: valueMode,
       );
-    };
-    controller.onCancel = () async {
-      await rawStreamSubscription?.cancel();
-    };
-    controller.done.whenComplete(() async {
-      if (cursor == PointerLockCursor.hidden) {
-        await _showPointer();
-      }
+    }
+    // The native session applies everything between two input events, so no event sees a half-applied update.
+    return methodChannel.invokeMethod<void>('updateSession', {
+      if (unlockOnPointerUp != null) 'unlockOnPointerUp': unlockOnPointerUp,
+      if (transform != null) 'transform': transform.toMap(),
+      if (filter != null) 'filter': filter.toMap(),
+      if (valueMode != null) 'valueMode': valueMode.toMap(),
     });
-    return controller.stream;
+  }
+
+  @override
+  Future<PointerLockMotionHistory> motionHistory({required Duration window}) async {
+    if (defaultTargetPlatform != TargetPlatform.linux) {
+      return PointerLockMotionHistory.empty;
+    }
+    final data = await methodChannel.invokeMethod<Float64List>('motionHistory', {'windowUs': window.inMicroseconds});
+    return data == null ? PointerLockMotionHistory.empty : PointerLockMotionHistory.fromPacked(data);
   }
 
   /// Creates a Stream via Dart by tapping into the pointer events that are emitted by Flutter anyway.
   ///
   /// Also calls necessary platform methods for locking and unlocking the pointer.
   Stream<PointerLockMoveEvent> _createRawStreamDart({
+    required PointerLockWindowsMode windowsMode,
+    required PointerLockCursor cursor,
     required bool unlockOnPointerUp,
   }) {
     final previousCallback = PlatformDispatcher.instance.onPointerDataPacket!;
     final controller = StreamController<PointerLockMoveEvent>();
+    // Stays null if starting the session failed, in which case there's nothing to end.
+    bool? singleRoundTrip;
     controller.onListen = () async {
-      await _subscribeToRawInputData();
-      await _lockPointer();
-      PlatformDispatcher.instance.onPointerDataPacket = (packet) async {
+      try {
+        singleRoundTrip = await _startSession(
+          windowsMode: windowsMode,
+          cursor: cursor,
+          unlockOnPointerUp: unlockOnPointerUp,
+        );
+      } catch (error) {
+        controller.addError(error);
+        await controller.close();
+        return;
+      }
+      // Deltas are queried separately from packet forwarding, so that forwarded packets (e.g. clicks and scrolls)
+      // never wait for a method-channel round trip. At most one query is in flight. Motion arriving in the meantime
+      // is picked up by exactly one follow-up query. Nothing gets lost because the native side reports the delta
+      // accumulated since the previous query.
+      var deltaQueryInFlight = false;
+      var deltaQueryPending = false;
+      Future<void> queryDeltas() async {
+        deltaQueryInFlight = true;
+        try {
+          while (deltaQueryPending && !controller.isClosed) {
+            deltaQueryPending = false;
+            final delta = await _lastPointerDelta();
+            if (!controller.isClosed) {
+              controller.add(PointerLockMoveEvent(delta: delta));
+            }
+          }
+        } catch (error) {
+          if (!controller.isClosed) {
+            controller.addError(error);
+          }
+        } finally {
+          deltaQueryInFlight = false;
+        }
+      }
+
+      PlatformDispatcher.instance.onPointerDataPacket = (packet) {
         var unlock = false;
         var containsMotionEvents = false;
         // Inspect events in packet, maybe filtering out some of them so that they are not forwarded to the
@@ -144,72 +389,140 @@ class ChannelPointerLock extends PointerLockPlatform {
               return true;
           }
         });
+        // Forward right away and synchronously. This keeps the order of forwarded packets intact.
+        previousCallback(packet);
         // Maybe unlock
         if (unlock) {
-          // It's important to await here, otherwise it could happen that order of
-          // forwarded packets changes (this forwarded package overtaking a previous
-          // forwarded package). The method channel should nicely serialize everything.
-          await controller.close();
+          controller.close();
+          return;
         }
-        // Maybe emit move event
+        // Maybe emit move event (asynchronously)
         if (containsMotionEvents) {
-          final delta = await _lastPointerDelta();
-          if (!controller.isClosed) {
-            final event = PointerLockMoveEvent(delta: delta);
-            controller.add(event);
+          deltaQueryPending = true;
+          if (!deltaQueryInFlight) {
+            queryDeltas();
           }
         }
-        previousCallback(packet);
       };
     };
     controller.done.whenComplete(() async {
       PlatformDispatcher.instance.onPointerDataPacket = previousCallback;
-      await _unlockPointer();
+      final startedWithSingleRoundTrip = singleRoundTrip;
+      if (startedWithSingleRoundTrip != null) {
+        await _endSession(cursor: cursor, singleRoundTrip: startedWithSingleRoundTrip);
+      }
     });
     return controller.stream;
   }
 
-  Stream<PointerLockMoveEvent> _createRawStream({
-    required PointerLockWindowsMode windowsMode,
-    required bool unlockOnPointerUp,
+  /// Creates a Stream that is driven by the native code.
+  ///
+  /// The given arguments are passed to the native stream handler when listening.
+  Stream<PointerLockMoveEvent> _createRawStreamNative({
+    required Object arguments,
+    PointerLockVirtualCursor? virtualCursor,
   }) {
-    if (defaultTargetPlatform == TargetPlatform.windows) {
-      switch (windowsMode) {
-        case PointerLockWindowsMode.capture:
-          // Capture mode needs to be controlled from the native code because the Flutter Engine doesn't receive mouse
-          // events anymore while we are capturing them.
-          return _createRawStreamNative(unlockOnPointerUp: unlockOnPointerUp);
-        case PointerLockWindowsMode.clip:
-          // In clip mode, the Flutter Engine still receives mouse events, so we can control the stream from Dart.
-          return _createRawStreamDart(unlockOnPointerUp: unlockOnPointerUp);
-      }
-    } else if (defaultTargetPlatform == TargetPlatform.macOS) {
-      // On macOS, we need to put the native code in control, otherwise we would only receive deltas while a mouse
-      // button is pressed. If the mouse button is not pressed, macOS generates mouse-move events instead of mouse-drag
-      // events. The Flutter Engine forwards mouse-move events to Dart only if the pointer coordinates change. But
-      // when doing locking the pointer via CGAssociateMouseAndMouseCursorPosition(0), the absolute coordinates don't
-      // change anymore.
-      return _createRawStreamNative(unlockOnPointerUp: unlockOnPointerUp);
-    } else {
-      // On Linux, we are fine with Dart-controlled streams.
-      return _createRawStreamDart(unlockOnPointerUp: unlockOnPointerUp);
+    final batches = _receiveSessionEvents(arguments);
+    if (virtualCursor == null) {
+      return batches.expand(_decodeNativeEvent);
     }
+    return batches.expand((batch) {
+      final events = _decodeNativeEvent(batch).toList();
+      // Updating the position once per batch is enough for readers that sample it once per frame.
+      final position = events.lastOrNull?.cursorPosition;
+      if (position != null) {
+        virtualCursor.position.value = position;
+      }
+      return events;
+    });
   }
 
-  /// Creates a Stream that is driven by the native code.
-  Stream<PointerLockMoveEvent> _createRawStreamNative({
+  /// Returns the events of a native session started with the given arguments once the stream is listened to.
+  ///
+  /// Only one native session (including a shared one) can be listened to at a time. Listening to another one reports
+  /// a [StateError] and closes the stream, without affecting the active session.
+  Stream<dynamic> _receiveSessionEvents(Object arguments) {
+    StreamSubscription<dynamic>? upstream;
+    late final StreamController<dynamic> controller;
+    controller = StreamController<dynamic>.broadcast(
+      onListen: () {
+        if (_sessionEventsListened) {
+          controller.addError(
+            StateError(
+              'Another pointer lock session is active. Cancel it first, or subscribe to its shared session '
+              '(see PointerLock.createSharedSession).',
+            ),
+          );
+          controller.close();
+          return;
+        }
+        _sessionEventsListened = true;
+        upstream = sessionEventChannel.receiveBroadcastStream(arguments).listen(
+          controller.add,
+          onError: controller.addError,
+          onDone: () {
+            upstream = null;
+            _sessionEventsListened = false;
+            controller.close();
+          },
+        );
+      },
+      onCancel: () {
+        final subscription = upstream;
+        if (subscription == null) {
+          return null;
+        }
+        upstream = null;
+        _sessionEventsListened = false;
+        return subscription.cancel();
+      },
+    );
+    return controller.stream;
+  }
+
+  /// Starts a session by hiding the cursor (if desired) and locking the pointer in one platform round trip.
+  ///
+  /// Falls back to separate method calls if the platform implementation doesn't support `startSession` yet.
+  /// Returns whether the single round trip was possible.
+  Future<bool> _startSession({
+    required PointerLockWindowsMode windowsMode,
+    required PointerLockCursor cursor,
     required bool unlockOnPointerUp,
-  }) {
-    Offset convertEventToOffset(dynamic event) {
-      if (event == null || event is! Float64List || event.length < 2) {
-        return Offset.zero;
+  }) async {
+    try {
+      await methodChannel.invokeMethod<void>(
+        'startSession',
+        _sessionArguments(
+          windowsMode: windowsMode,
+          cursor: cursor,
+          unlockOnPointerUp: unlockOnPointerUp,
+        ),
+      );
+      return true;
+    } on MissingPluginException {
+      if (cursor == PointerLockCursor.hidden) {
+        await _hidePointer();
       }
-      return Offset(event[0], event[1]);
+      await _subscribeToRawInputData();
+      await _lockPointer();
+      return false;
     }
+  }
 
-    return sessionEventChannel
-        .receiveBroadcastStream(unlockOnPointerUp)
-        .map((evt) => PointerLockMoveEvent(delta: convertEventToOffset(evt)));
+  /// Ends a session started with [_startSession], unlocking the pointer and showing the cursor again (if it was
+  /// hidden by the session).
+  Future<void> _endSession({
+    required PointerLockCursor cursor,
+    required bool singleRoundTrip,
+  }) async {
+    if (singleRoundTrip) {
+      await methodChannel.invokeMethod<void>('endSession');
+      return;
+    }
+    await _unlockPointer();
+    if (cursor == PointerLockCursor.hidden) {
+      await _showPointer();
+    }
   }
 
   Future<void> _lockPointer() {
@@ -242,6 +555,213 @@ class ChannelPointerLock extends PointerLockPlatform {
   }
 }
 
+/// A session shared by subscriptions whose events are coalesced by the native session.
+///
+/// The first subscription starts the native session by listening to the session event channel. Further
+/// subscriptions are added to the running session via method calls. All of them receive their batches via the same
+/// event channel, told apart by the subscription ID in the batch header.
+class _ChannelSharedSession implements PointerLockSharedSession {
+  static var _nextSubscriptionId = 1;
+
+  final ChannelPointerLock _platform;
+  final Map<String, Object?> _arguments;
+  final _subscribers = <int, StreamController<PointerLockMoveEvent>>{};
+  // The arguments of each subscription by its stream, updated by updateSubscription
+  final _subscriptions = Expando<Map<String, Object?>>();
+  StreamSubscription<dynamic>? _upstream;
+
+  _ChannelSharedSession(this._platform, this._arguments);
+
+  @override
+  Stream<PointerLockMoveEvent> subscribe({PointerLockDeliveryPolicy policy = PointerLockDeliveryPolicy.everySample}) {
+    final id = _nextSubscriptionId++;
+    final subscription = <String, Object?>{'subscriptionId': id, 'deliveryPolicy': policy.name};
+    late final StreamController<PointerLockMoveEvent> controller;
+    controller = StreamController<PointerLockMoveEvent>(
+      onListen: () {
+        _subscribers[id] = controller;
+        if (_upstream != null) {
+          _platform.methodChannel
+              .invokeMethod<void>('addSubscription', subscription)
+              .catchError((Object error) => controller.addError(error));
+          return;
+        }
+        _upstream = _platform._receiveSessionEvents({..._arguments, ...subscription}).listen(
+          _dispatch,
+          onError: (Object error) {
+            for (final subscriber in _subscribers.values) {
+              subscriber.addError(error);
+            }
+          },
+          onDone: _closeAll,
+        );
+      },
+      onCancel: () {
+        _subscribers.remove(id);
+        if (_subscribers.isNotEmpty) {
+          return _platform.methodChannel.invokeMethod<void>('removeSubscription', {'subscriptionId': id});
+        }
+        final upstream = _upstream;
+        _upstream = null;
+        return upstream?.cancel();
+      },
+    );
+    _subscriptions[controller.stream] = subscription;
+    return controller.stream;
+  }
+
+  @override
+  Future<void> updateSubscription(Stream<PointerLockMoveEvent> subscription, PointerLockDeliveryPolicy policy) async {
+    final arguments = _subscriptions[subscription];
+    if (arguments == null) {
+      throw ArgumentError.value(subscription, 'subscription', 'Not a subscription of this session');
+    }
+    // Subscriptions which haven't been listened to yet pass the policy when they are added to the session.
+    arguments['deliveryPolicy'] = policy.name;
+    final id = arguments['subscriptionId'];
+    if (_subscribers.containsKey(id)) {
+      await _platform.methodChannel
+          .invokeMethod<void>('updateSession', {'subscriptionId': id, 'deliveryPolicy': policy.name});
+    }
+  }
+
+  void _dispatch(dynamic payload) {
+    if (payload is! Float64List || payload.length < nativeBatchHeaderLength) {
+      return;
+    }
+    final subscriber = _subscribers[Int64List.sublistView(payload)[1]];
+    if (subscriber == null) {
+      // Samples for a subscription which has just been cancelled
+      return;
+    }
+    for (final event in _decodeNativeBatch(payload)) {
+      subscriber.add(event);
+    }
+  }
+
+  void _closeAll() {
+    _upstream = null;
+    final subscribers = [..._subscribers.values];
+    _subscribers.clear();
+    for (final subscriber in subscribers) {
+      subscriber.close();
+    }
+  }
+}
+
+/// Decodes an event sent by a native session stream handler.
+///
+/// Linux sends batches of events (see `pointer_lock_events.h`), other platforms send single deltas as `[dx, dy]`.
+Iterable<PointerLockMoveEvent> _decodeNativeEvent(dynamic event) {
+  if (event is! Float64List || event.length < 2) {
+    return [PointerLockMoveEvent(delta: Offset.zero)];
+  }
+  if (event.length == 2) {
+    return [PointerLockMoveEvent(delta: Offset(event[0], event[1]))];
+  }
+  return _decodeNativeBatch(event);
+}
+
+/// Decodes the events of a native batch, skipping events of kinds this version doesn't know.
+Iterable<PointerLockMoveEvent> _decodeNativeBatch(Float64List batch) sync* {
+  final layout = NativeBatchLayout.of(batch);
+  if (layout == null) {
+    return;
+  }
+  for (var i = 0; i < layout.count; i++) {
+    if (layout.hasKnownKind(i)) {
+      yield _NativeMoveEvent(layout, i);
+    }
+  }
+}
+
+/// An event of a native batch. Only the columns contained in every batch are decoded right away. The others are read
+/// from the batch when accessed, so listeners which don't use a feature don't pay for decoding it.
+class _NativeMoveEvent extends PointerLockMoveEvent {
+  final NativeBatchLayout _layout;
+  final int _index;
+
+  _NativeMoveEvent(this._layout, this._index)
+      : super(
+          kind: PointerLockEventKind.values[_layout.intValue(NativeBatchColumn.kind, _index)],
+          delta: Offset(_layout.value(NativeBatchColumn.dx, _index), _layout.value(NativeBatchColumn.dy, _index)),
+          button: _layout.intValue(NativeBatchColumn.button, _index),
+          buttons: _layout.intValue(NativeBatchColumn.buttons, _index),
+          modifiers: PointerLockModifiers.fromBits(_layout.intValue(NativeBatchColumn.modifiers, _index)),
+          deviceId: _layout.intValue(NativeBatchColumn.device, _index),
+          timestamp: Duration(microseconds: _layout.intValue(NativeBatchColumn.timestamp, _index)),
+        );
+
+  @override
+  Offset get filteredDelta => _offset(NativeBatchColumn.filteredDx, NativeBatchColumn.filteredDy) ?? delta;
+
+  @override
+  Offset get velocity => _offset(NativeBatchColumn.velocityX, NativeBatchColumn.velocityY) ?? Offset.zero;
+
+  @override
+  Offset get acceleration => _offset(NativeBatchColumn.accelerationX, NativeBatchColumn.accelerationY) ?? Offset.zero;
+
+  @override
+  Offset get predictedDelta => _offset(NativeBatchColumn.predictedDx, NativeBatchColumn.predictedDy) ?? delta;
+
+  @override
+  double get predictionConfidence => _value(NativeBatchColumn.predictionConfidence) ?? 0;
+
+  @override
+  double? get value => _value(NativeBatchColumn.value);
+
+  @override
+  Offset? get cursorPosition => _offset(NativeBatchColumn.cursorX, NativeBatchColumn.cursorY);
+
+  @override
+  Offset? get position => _offset(NativeBatchColumn.positionX, NativeBatchColumn.positionY);
+
+  @override
+  Offset? get physicalDelta => _offset(NativeBatchColumn.physicalDx, NativeBatchColumn.physicalDy);
+
+  /// The value of the given column, `null` if the batch doesn't contain it or if it's NaN (not applicable).
+  double? _value(NativeBatchColumn column) {
+    if (!_layout.contains(column)) {
+      return null;
+    }
+    final value = _layout.value(column, _index);
+    return value.isNaN ? null : value;
+  }
+
+  /// Like [_value], for two columns.
+  Offset? _offset(NativeBatchColumn x, NativeBatchColumn y) {
+    final dx = _value(x);
+    final dy = _value(y);
+    return dx == null || dy == null ? null : Offset(dx, dy);
+  }
+}
+
+Map<String, Object?> _sessionArguments({
+  required PointerLockWindowsMode windowsMode,
+  required PointerLockCursor cursor,
+  required bool unlockOnPointerUp,
+  PointerLockTransform? transform,
+  PointerLockFilter? filter,
+  int velocityWindow = 0,
+  PointerLockPrediction? prediction,
+  PointerLockValueMode? valueMode,
+  PointerLockVirtualCursor? virtualCursor,
+  bool buttonAndScrollEvents = true,
+}) {
+  return {
+    'windowsMode': windowsMode.name,
+    'cursor': cursor.name,
+    'unlockOnPointerUp': unlockOnPointerUp,
+    'buttonAndScrollEvents': buttonAndScrollEvents,
+    if (transform != null) 'transform': transform.toMap(),
+    if (filter != null) 'filter': filter.toMap(),
+    'velocityWindow': velocityWindow,
+    if (prediction != null) 'prediction': prediction.toMap(),
+    if (valueMode != null) 'valueMode': valueMode.toMap(),
+    if (virtualCursor != null) 'virtualCursor': virtualCursor.toMap(),
+  };
+}
+
 Offset _convertListToOffset(List<double>? list) {
   if (list == null || list.length < 2) {
     return Offset.zero;
@@ -2,8 +2,10 @@ import 'dart:async';
 import 'dart:io';
 
 import 'package:flutter/gestures.dart';
+import 'package:flutter/scheduler.dart';
 import 'package:flutter/widgets.dart';
 import 'pointer_lock.dart';
+import 'pointer_lock_options.dart';
 
 /// A widget that locks the pointer when you press a mouse button and unlocks it as soon as you release it.
 ///
@@ -15,6 +17,16 @@ class PointerLockDragArea extends StatefulWidget {
   /// Which pointer locking approach to use on Windows (doesn't affect other platforms).
   final PointerLockWindowsMode windowsMode;
 
+  /// How the platform should transform the deltas before they are passed to [onMove].
+  final PointerLockTransform? transform;
+
+  /// If set, the movement is mapped to a bounded value, available in [PointerLockMoveEvent.value] of the events
+  /// passed to [onMove]. [onMove] is then only called when the value changes.
+  final PointerLockValueMode? valueMode;
+
+  /// If set, the movement moves this virtual cursor (see [PointerLockVirtualCursor.position]).
+  final PointerLockVirtualCursor? virtualCursor;
+
   /// This is called when receiving a pointer-down event and lets you decide whether you want to lock the pointer or
   /// not, based on that event. By default, the widget locks the pointer only if the primary button is pressed.
   final bool Function(PointerLockDragAcceptDetails details) accept;
@@ -22,9 +34,23 @@ class PointerLockDragArea extends StatefulWidget {
   /// This is called when locking the pointer (after the trigger button has been pressed and accepted).
   final void Function(PointerLockDragLockDetails details)? onLock;
 
-  /// This is called whenever you move the pointer. If not set, pointer locking is disabled.
+  /// This is called whenever you move the pointer.
+  ///
+  /// If neither this, [onFrameMove] nor [dragOffset] is set, pointer locking is disabled.
   final void Function(PointerLockDragMoveDetails details)? onMove;
 
+  /// This is called at most once per frame with the movement since the previous call.
+  ///
+  /// High-rate mice can produce thousands of move events per second, but only one state change per frame is
+  /// visible. Prefer this over [onMove] if you call `setState` in response.
+  final void Function(PointerLockDragFrameDetails details)? onFrameMove;
+
+  /// If set, this is updated once per frame with the movement accumulated since the pointer was locked.
+  ///
+  /// It's reset to [Offset.zero] when locking. Listen to it (e.g. with a [ValueListenableBuilder]) to rebuild only
+  /// the widgets that depend on the drag.
+  final ValueNotifier<Offset>? dragOffset;
+
   /// This is called when unlocking the pointer (after the trigger button has been released).
   final void Function(PointerLockDragUnlockDetails details)? onUnlock;
 
@@ -36,9 +62,14 @@ class PointerLockDragArea extends StatefulWidget {
     super.key,
     this.cursor = PointerLockCursor.hidden,
     this.windowsMode = PointerLockWindowsMode.capture,
+    this.transform,
+    this.valueMode,
+    this.virtualCursor,
     this.accept = _acceptDefault,
     this.onLock,
     this.onMove,
+    this.onFrameMove,
+    this.dragOffset,
     this.onUnlock,
     required this.child,
   });
@@ -57,6 +88,19 @@ class PointerLockDragMoveDetails {
   PointerLockDragMoveDetails({required this.trigger, required this.move});
 }
 
+class PointerLockDragFrameDetails {
+  /// The pointer-down event which triggered the pointer-lock session.
+  final PointerDownEvent trigger;
+
+  /// The sum of the deltas of all move events since the previous frame.
+  final Offset delta;
+
+  /// The number of move events which were summed up.
+  final int sampleCount;
+
+  PointerLockDragFrameDetails({required this.trigger, required this.delta, required this.sampleCount});
+}
+
 class PointerLockDragLockDetails {
   /// The pointer-down event which triggered the pointer-lock session.
   final PointerDownEvent trigger;
@@ -84,19 +128,24 @@ bool _acceptDefault(PointerLockDragAcceptDetails details) {
 
 class _PointerLockDragAreaState extends State<PointerLockDragArea> {
   _Session? _session;
+  Offset _frameDelta = Offset.zero;
+  int _frameSampleCount = 0;
+  int? _frameCallbackId;
 
   @override
   void dispose() {
     _session?.subscription.cancel();
+    _cancelFrameCallback();
     super.dispose();
   }
 
+  bool get _isEnabled => widget.onMove != null || widget.onFrameMove != null || widget.dragOffset != null;
+
   @override
   Widget build(BuildContext context) {
     return Listener(
       behavior: HitTestBehavior.translucent,
-      onPointerDown:
-          widget.onMove == null ? null : (event) => _onPointerDown(event),
+      onPointerDown: _isEnabled ? (event) => _onPointerDown(event) : null,
       onPointerUp: (event) => _onPointerUp(event),
       child: widget.child,
     );
@@ -119,12 +168,20 @@ class _PointerLockDragAreaState extends State<PointerLockDragArea> {
       windowsMode: widget.windowsMode,
       cursor: widget.cursor,
       unlockOnPointerUp: unlockAutomatically,
+      transform: widget.transform,
+      valueMode: widget.valueMode,
+      virtualCursor: widget.virtualCursor,
     );
     final subscription = deltaStream.listen(
       (event) {
+        // Buttons are handled via the normal Flutter pointer events (see build).
+        if (event.kind != PointerLockEventKind.move) {
+          return;
+        }
         final details =
             PointerLockDragMoveDetails(trigger: downEvent, move: event);
         widget.onMove?.call(details);
+        _accumulate(event.delta);
       },
       // onDone will only be invoked if the stream has been created with unlockOnPointerUp
       // (that is, if the stream ends naturally)
@@ -135,10 +192,58 @@ class _PointerLockDragAreaState extends State<PointerLockDragArea> {
       subscription: subscription,
       unlocksAutomatically: unlockAutomatically,
     );
+    widget.dragOffset?.value = Offset.zero;
     final details = PointerLockDragLockDetails(trigger: downEvent);
     widget.onLock?.call(details);
   }
 
+  /// Adds a delta to the movement which is delivered with the next frame.
+  void _accumulate(Offset delta) {
+    if (widget.onFrameMove == null && widget.dragOffset == null) {
+      return;
+    }
+    _frameDelta += delta;
+    _frameSampleCount++;
+    if (_frameCallbackId == null) {
+      final scheduler = SchedulerBinding.instance;
+      _frameCallbackId = scheduler.scheduleFrameCallback((_) {
+        _frameCallbackId = null;
+        _deliverFrame();
+      });
+      // Frame callbacks don't request a frame by themselves
+      scheduler.scheduleFrame();
+    }
+  }
+
+  /// Delivers the movement accumulated since the previous frame.
+  void _deliverFrame() {
+    final session = _session;
+    if (session == null || _frameSampleCount == 0) {
+      return;
+    }
+    final delta = _frameDelta;
+    final sampleCount = _frameSampleCount;
+    _frameDelta = Offset.zero;
+    _frameSampleCount = 0;
+    final dragOffset = widget.dragOffset;
+    if (dragOffset != null) {
+      dragOffset.value += delta;
+    }
+    widget.onFrameMove?.call(
+      PointerLockDragFrameDetails(trigger: session.downEvent, delta: delta, sampleCount: sampleCount),
+    );
+  }
+
+  void _cancelFrameCallback() {
+    final id = _frameCallbackId;
+    if (id != null) {
+      SchedulerBinding.instance.cancelFrameCallbackWithId(id);
+      _frameCallbackId = null;
+    }
+    _frameDelta = Offset.zero;
+    _frameSampleCount = 0;
+  }
+
   /// Unlocks the pointer if necessary.
   void _onPointerUp(PointerUpEvent upEvent) async {
     final session = _session;
@@ -173,6 +278,9 @@ class _PointerLockDragAreaState extends State<PointerLockDragArea> {
     if (session == null) {
       return;
     }
+    // Don't swallow the movement of the last frame
+    _deliverFrame();
+    _cancelFrameCallback();
     _session = null;
     final details = PointerLockDragUnlockDetails(trigger: session.downEvent);
     widget.onUnlock?.call(details);
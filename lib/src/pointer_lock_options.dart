@@ -0,0 +1,307 @@
+import 'dart:typed_data';
+import 'dart:ui';
+
+import 'package:flutter/foundation.dart';
+
+import 'pointer_lock.dart';
+
+/// Describes how a session transforms pointer deltas before delivering them.
+///
+/// The transformation runs natively, right where the samples are produced. Order of operations: axis mapping
+/// ([swapAxes], [invertX], [invertY]), gain ([gainX], [gainY]), acceleration ([curve]) and finally
+/// quantization ([quantize]).
+///
+/// At the moment, this is only applied on Linux. Other platforms deliver untransformed deltas.
+class PointerLockTransform {
+  /// Factor applied to horizontal deltas.
+  final double gainX;
+
+  /// Factor applied to vertical deltas.
+  final double gainY;
+
+  /// Acceleration applied depending on the raw pointer speed.
+  final PointerLockAccelerationCurve curve;
+
+  /// Whether to swap the horizontal and vertical axis.
+  final bool swapAxes;
+
+  /// Whether to invert the horizontal axis.
+  final bool invertX;
+
+  /// Whether to invert the vertical axis.
+  final bool invertY;
+
+  /// Whether to round deltas to whole pixels.
+  ///
+  /// The rounding remainders are carried over to the next delta, so no motion gets lost, not even during long and
+  /// slow drags.
+  final bool quantize;
+
+  const PointerLockTransform({
+    this.gainX = 1,
+    this.gainY = 1,
+    this.curve = PointerLockAccelerationCurve.none,
+    this.swapAxes = false,
+    this.invertX = false,
+    this.invertY = false,
+    this.quantize = false,
+  });
+
+  Map<String, Object?> toMap() {
+    return {
+      'gainX': gainX,
+      'gainY': gainY,
+      'curve': curve.toMap(),
+      'swapAxes': swapAxes,
+      'invertX': invertX,
+      'invertY': invertY,
+      'quantize': quantize,
+    };
+  }
+}
+
+/// Maps the raw pointer speed (in pixels per second) to a factor which is applied to the delta.
+class PointerLockAccelerationCurve {
+  final String _type;
+  final double _coefficient;
+  final double _exponent;
+  final double _maxFactor;
+  final List<(double, double)> _points;
+
+  /// No acceleration.
+  static const none = PointerLockAccelerationCurve._('none');
+
+  /// `factor = 1 + coefficient * (speed / 1000) ^ exponent`, limited to [maxFactor].
+  const PointerLockAccelerationCurve.power({
+    required double coefficient,
+    double exponent = 1,
+    double maxFactor = double.maxFinite,
+  }) : this._('power', coefficient: coefficient, exponent: exponent, maxFactor: maxFactor);
+
+  /// The factor is interpolated linearly between the given `(speed, factor)` points.
+  ///
+  /// Below the first point and above the last one, the factor of the nearest point applies.
+  const PointerLockAccelerationCurve.piecewise(List<(double, double)> points) : this._('piecewise', points: points);
+
+  const PointerLockAccelerationCurve._(
+    this._type, {
+    double coefficient = 0,
+    double exponent = 1,
+    double maxFactor = double.maxFinite,
+    List<(double, double)> points = const [],
+  })  : _coefficient = coefficient,
+        _exponent = exponent,
+        _maxFactor = maxFactor,
+        _points = points;
+
+  Map<String, Object?> toMap() {
+    final sortedPoints = [..._points]..sort((a, b) => a.$1.compareTo(b.$1));
+    return {
+      'type': _type,
+      'coefficient': _coefficient,
+      'exponent': _exponent,
+      'maxFactor': _maxFactor,
+      'points': Float64List.fromList([for (final (speed, factor) in sortedPoints) ...[speed, factor]]),
+    };
+  }
+}
+
+/// Describes how a session smooths pointer deltas (see [PointerLockMoveEvent.filteredDelta]).
+///
+/// The filter runs natively on the timestamped samples, after the [PointerLockTransform]. It smooths the
+/// accumulated pointer position, so the filtered deltas lag behind. Once the pointer rests for a frame, the session
+/// delivers a move event with a zero [PointerLockMoveEvent.delta] which catches up with the lag, so the filtered deltas
+/// add up to the same total movement.
+///
+/// At the moment, this is only applied on Linux. On other platforms, the filtered delta equals the delta.
+class PointerLockFilter {
+  final String _type;
+  final double _alpha;
+  final double _minCutoff;
+  final double _beta;
+  final double _derivativeCutoff;
+
+  /// No smoothing.
+  static const none = PointerLockFilter._('none');
+
+  /// Exponential moving average. The higher [alpha] (0 to 1), the more weight has the newest sample.
+  const PointerLockFilter.ema({double alpha = 0.5}) : this._('ema', alpha: alpha);
+
+  /// One-Euro filter, which smooths strongly when the pointer moves slowly and reduces lag when it moves fast.
+  ///
+  /// [minCutoff] is the cutoff frequency in Hz at zero speed (lower means smoother), [beta] controls how fast the
+  /// cutoff frequency increases with speed (higher means less lag) and [derivativeCutoff] is the cutoff frequency
+  /// used for estimating the speed.
+  const PointerLockFilter.oneEuro({double minCutoff = 1, double beta = 0, double derivativeCutoff = 1})
+      : this._('oneEuro', minCutoff: minCutoff, beta: beta, derivativeCutoff: derivativeCutoff);
+
+  const PointerLockFilter._(
+    this._type, {
+    double alpha = 0.5,
+    double minCutoff = 1,
+    double beta = 0,
+    double derivativeCutoff = 1,
+  })  : _alpha = alpha,
+        _minCutoff = minCutoff,
+        _beta = beta,
+        _derivativeCutoff = derivativeCutoff;
+
+  Map<String, Object?> toMap() {
+    return {
+      'type': _type,
+      'alpha': _alpha,
+      'minCutoff': _minCutoff,
+      'beta': _beta,
+      'derivativeCutoff': _derivativeCutoff,
+    };
+  }
+}
+
+/// How a session predicts the pointer movement until the next frame is presented (see
+/// [PointerLockMoveEvent.predictedDelta]).
+///
+/// The prediction runs natively and uses the frame timing of the Flutter view, so rendering the predicted position
+/// hides about a frame of input latency. At the moment, this is only applied on Linux.
+class PointerLockPrediction {
+  final String _model;
+
+  /// Number of recent samples from which velocity and acceleration are estimated.
+  final int window;
+
+  /// How far into the future to predict at most.
+  final Duration maxHorizon;
+
+  /// How far (in logical pixels) the predicted position may be away from the measured one at most.
+  final double maxDistance;
+
+  /// Extrapolates with the estimated velocity.
+  const PointerLockPrediction.linear({
+    this.window = 8,
+    this.maxHorizon = const Duration(milliseconds: 50),
+    this.maxDistance = 100,
+  }) : _model = 'linear';
+
+  /// Extrapolates with the estimated velocity and acceleration. Reacts faster to changes of speed but overshoots
+  /// more easily than [PointerLockPrediction.linear].
+  const PointerLockPrediction.constantAcceleration({
+    this.window = 8,
+    this.maxHorizon = const Duration(milliseconds: 50),
+    this.maxDistance = 100,
+  }) : _model = 'constantAcceleration';
+
+  Map<String, Object?> toMap() {
+    return {
+      'model': _model,
+      'window': window,
+      'maxHorizonUs': maxHorizon.inMicroseconds,
+      'maxDistance': maxDistance,
+    };
+  }
+}
+
+/// Lets a session map the pointer movement to a bounded value, e.g. for knobs and drag fields (see
+/// [PointerLockMoveEvent.value]).
+///
+/// Move events are only delivered when the (rounded) value changes, so the number of events scales with the number
+/// of value changes instead of the number of pointer samples. On Linux, the mapping runs natively. On other
+/// platforms, it's done in Dart with the same result.
+class PointerLockValueMode {
+  /// The value when the session starts.
+  final double start;
+
+  /// The minimum value.
+  final double min;
+
+  /// The maximum value.
+  final double max;
+
+  /// How far (in logical pixels) the pointer needs to move for going from [min] to [max].
+  final double pixelsPerRange;
+
+  /// If not zero, values are rounded to multiples of this (counted from [min]).
+  final double step;
+
+  /// While any of these modifier keys is pressed, the value changes more slowly (by [fineFactor]).
+  final PointerLockModifiers fineModifiers;
+
+  /// How much slower the value changes in fine mode.
+  final double fineFactor;
+
+  /// Whether to wrap around when exceeding [min] or [max] (e.g. for angles) instead of stopping there.
+  final bool wrap;
+
+  /// Which pointer movement changes the value.
+  final PointerLockValueAxis axis;
+
+  const PointerLockValueMode({
+    this.start = 0,
+    this.min = 0,
+    this.max = 1,
+    this.pixelsPerRange = 200,
+    this.step = 0,
+    this.fineModifiers = const PointerLockModifiers.fromBits(1),
+    this.fineFactor = 0.1,
+    this.wrap = false,
+    this.axis = PointerLockValueAxis.vertical,
+  });
+
+  Map<String, Object?> toMap() {
+    return {
+      'start': start,
+      'min': min,
+      'max': max,
+      'pixelsPerRange': pixelsPerRange,
+      'step': step,
+      'fineModifiers': fineModifiers.bits,
+      'fineFactor': fineFactor,
+      'wrap': wrap,
+      'axis': axis.name,
+    };
+  }
+}
+
+/// Which pointer movement changes the value of a [PointerLockValueMode] session.
+enum PointerLockValueAxis {
+  /// Moving right increases the value.
+  horizontal,
+
+  /// Moving up increases the value.
+  vertical,
+
+  /// Moving right or up increases the value.
+  both,
+}
+
+/// A virtual cursor which a session moves by the pointer deltas, within [bounds] (see
+/// [PointerLockMoveEvent.cursorPosition]).
+///
+/// Widgets which only need the position once per frame can read [position] instead of processing each event. On
+/// Linux, the position is integrated natively. On other platforms, it's done in Dart with the same result.
+class PointerLockVirtualCursor {
+  /// The rectangle in which the cursor moves, in logical pixels.
+  final Rect bounds;
+
+  /// Whether to wrap around at the edges of [bounds] instead of stopping there.
+  final bool wrap;
+
+  /// The latest position of the cursor, with sub-pixel precision.
+  ///
+  /// Starts at the position passed to the constructor and is updated by the session once per batch of events.
+  final ValueNotifier<Offset> position;
+
+  /// Creates a virtual cursor, by default starting in the center of [bounds].
+  PointerLockVirtualCursor({required this.bounds, Offset? start, this.wrap = false})
+      : position = ValueNotifier(start ?? bounds.center);
+
+  Map<String, Object?> toMap() {
+    return {
+      'startX': position.value.dx,
+      'startY': position.value.dy,
+      'left': bounds.left,
+      'top': bounds.top,
+      'right': bounds.right,
+      'bottom': bounds.bottom,
+      'wrap': wrap,
+    };
+  }
+}
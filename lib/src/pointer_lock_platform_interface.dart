@@ -3,7 +3,10 @@ import 'dart:ui';
 import 'package:plugin_platform_interface/plugin_platform_interface.dart';
 
 import 'pointer_lock.dart';
+import 'pointer_lock_batch.dart';
 import 'pointer_lock_channel.dart';
+import 'pointer_lock_options.dart';
+import 'pointer_lock_shared_session.dart';
 
 abstract class PointerLockPlatform extends PlatformInterface {
   /// Constructs a PointerLockPlatform.
@@ -34,10 +37,64 @@ abstract class PointerLockPlatform extends PlatformInterface {
     required PointerLockWindowsMode windowsMode,
     required PointerLockCursor cursor,
     required bool unlockOnPointerUp,
+    PointerLockTransform? transform,
+    PointerLockFilter? filter,
+    int velocityWindow = 0,
+    PointerLockPrediction? prediction,
+    PointerLockValueMode? valueMode,
+    PointerLockVirtualCursor? virtualCursor,
+    bool includeButtonAndScrollEvents = false,
   }) {
     throw UnimplementedError('createSession() has not been implemented.');
   }
 
+  /// Groups the events of [createSession] into batches. Implementations which receive batches from the platform
+  /// should override this.
+  Stream<PointerLockEventBatch> createBatchedSession({
+    required PointerLockWindowsMode windowsMode,
+    required PointerLockCursor cursor,
+    required bool unlockOnPointerUp,
+    PointerLockTransform? transform,
+  }) {
+    return batchEventStream(createSession(
+      windowsMode: windowsMode,
+      cursor: cursor,
+      unlockOnPointerUp: unlockOnPointerUp,
+      transform: transform,
+    ));
+  }
+
+  Stream<PointerLockMoveEvent> createConfinedSession({
+    required Rect rect,
+    required PointerLockCursor cursor,
+    required bool unlockOnPointerUp,
+    PointerLockTransform? transform,
+  }) {
+    return Stream.error(UnsupportedError('Confining the pointer is not supported on this platform'));
+  }
+
+  /// Shares one [createSession] stream among several subscriptions, coalescing the events in Dart. Implementations
+  /// which can coalesce natively should override this.
+  PointerLockSharedSession createSharedSession({
+    required PointerLockWindowsMode windowsMode,
+    required PointerLockCursor cursor,
+    required bool unlockOnPointerUp,
+    PointerLockTransform? transform,
+    PointerLockFilter? filter,
+    int velocityWindow = 0,
+    PointerLockPrediction? prediction,
+  }) {
+    return DartSharedSession(() => createSession(
+          windowsMode: windowsMode,
+          cursor: cursor,
+          unlockOnPointerUp: unlockOnPointerUp,
+          transform: transform,
+          filter: filter,
+          velocityWindow: velocityWindow,
+          prediction: prediction,
+        ));
+  }
+
   Future<void> hidePointer() {
     throw UnimplementedError('hidePointer() has not been implemented.');
   }
@@ -50,4 +107,30 @@ abstract class PointerLockPlatform extends PlatformInterface {
     throw UnimplementedError(
         'pointerPositionOnScreen() has not been implemented.');
   }
+
+  /// Polls [pointerPositionOnScreen] about once per frame. Implementations which can push position changes should
+  /// override this.
+  Stream<Offset> pointerPositionStream() {
+    return Stream<void>.periodic(const Duration(milliseconds: 16))
+        .asyncMap((_) => pointerPositionOnScreen())
+        .distinct();
+  }
+
+  Future<List<PointerLockDevice>> pointingDevices() {
+    throw UnimplementedError('pointingDevices() has not been implemented.');
+  }
+
+  Future<PointerLockMotionHistory> motionHistory({required Duration window}) {
+    throw UnimplementedError('motionHistory() has not been implemented.');
+  }
+
+  /// Changes parameters of the active session. Implementations which can reconfigure sessions should override this.
+  Future<void> updateSession({
+    bool? unlockOnPointerUp,
+    PointerLockTransform? transform,
+    PointerLockFilter? filter,
+    PointerLockValueMode? valueMode,
+  }) {
+    return Future.error(UnsupportedError('Updating sessions is not supported on this platform'));
+  }
 }
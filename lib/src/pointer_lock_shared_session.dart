@@ -0,0 +1,172 @@
+import 'dart:async';
+
+import 'package:flutter/scheduler.dart';
+
+import 'pointer_lock.dart';
+
+/// How a subscription of a [PointerLockSharedSession] receives the events.
+///
+/// Button and scroll events are never coalesced, and all subscriptions receive the events in their original order.
+enum PointerLockDeliveryPolicy {
+  /// Each event as soon as it arrives. Events which arrive together, e.g. a burst of motion events, may be delivered
+  /// in one go.
+  everySample,
+
+  /// At most once per frame. Consecutive move events are merged into one whose deltas are the sums of the merged
+  /// deltas. Everything else (e.g. [PointerLockMoveEvent.velocity]) is taken from the latest event.
+  frameSum,
+
+  /// At most once per frame. Of consecutive move events, only the latest one is delivered. For subscribers which
+  /// only care about the latest state, e.g. [PointerLockMoveEvent.cursorPosition] or [PointerLockMoveEvent.value].
+  latestOnly,
+}
+
+/// One pointer-lock session whose events several subscribers receive, e.g. a viewport, a HUD and a recorder.
+///
+/// The pointer is locked when the first subscription is listened to and unlocked when the last one is cancelled.
+/// Each subscription picks its own [PointerLockDeliveryPolicy], so slow subscribers don't slow down fast ones. On
+/// Linux, the events are coalesced natively, once for each subscription. On other platforms, it's done in Dart.
+///
+/// Starting a shared session ends any other session which is active, just like [PointerLock.createSession] does.
+abstract class PointerLockSharedSession {
+  /// Creates a subscription. The returned stream is single-subscription and ends when the session ends.
+  Stream<PointerLockMoveEvent> subscribe({PointerLockDeliveryPolicy policy = PointerLockDeliveryPolicy.everySample});
+
+  /// Changes the policy of a subscription returned by [subscribe], without affecting the other subscriptions or
+  /// relocking. Events which have been held back for the next frame are delivered with it either way.
+  Future<void> updateSubscription(Stream<PointerLockMoveEvent> subscription, PointerLockDeliveryPolicy policy);
+}
+
+/// Shares a session created in Dart, coalescing the events for each subscription in Dart.
+class DartSharedSession implements PointerLockSharedSession {
+  final Stream<PointerLockMoveEvent> Function() _createSession;
+  final _subscribers = <_Subscriber>[];
+  final _subscribersByStream = Expando<_Subscriber>();
+  StreamSubscription<PointerLockMoveEvent>? _upstream;
+
+  DartSharedSession(this._createSession);
+
+  @override
+  Stream<PointerLockMoveEvent> subscribe({PointerLockDeliveryPolicy policy = PointerLockDeliveryPolicy.everySample}) {
+    late final _Subscriber subscriber;
+    final controller = StreamController<PointerLockMoveEvent>(
+      onListen: () {
+        _subscribers.add(subscriber);
+        _upstream ??= _createSession().listen(
+          _dispatch,
+          onError: (Object error) {
+            for (final subscriber in _subscribers) {
+              subscriber.controller.addError(error);
+            }
+          },
+          onDone: _closeAll,
+        );
+      },
+      onCancel: () {
+        _subscribers.remove(subscriber);
+        if (_subscribers.isNotEmpty) {
+          return null;
+        }
+        final upstream = _upstream;
+        _upstream = null;
+        return upstream?.cancel();
+      },
+    );
+    subscriber = _Subscriber(controller, policy);
+    _subscribersByStream[controller.stream] = subscriber;
+    return controller.stream;
+  }
+
+  @override
+  Future<void> updateSubscription(Stream<PointerLockMoveEvent> subscription, PointerLockDeliveryPolicy policy) async {
+    final subscriber = _subscribersByStream[subscription];
+    if (subscriber == null) {
+      throw ArgumentError.value(subscription, 'subscription', 'Not a subscription of this session');
+    }
+    subscriber.policy = policy;
+  }
+
+  void _dispatch(PointerLockMoveEvent event) {
+    for (final subscriber in _subscribers) {
+      subscriber.add(event);
+    }
+  }
+
+  void _closeAll() {
+    _upstream = null;
+    final subscribers = [..._subscribers];
+    _subscribers.clear();
+    for (final subscriber in subscribers) {
+      subscriber.flush();
+      subscriber.controller.close();
+    }
+  }
+}
+
+/// Dart counterpart of a subscription in `FanOut` (see `pointer_lock_fan_out.h`).
+class _Subscriber {
+  final StreamController<PointerLockMoveEvent> controller;
+  PointerLockDeliveryPolicy policy;
+  final _pending = <PointerLockMoveEvent>[];
+  var _flushScheduled = false;
+
+  _Subscriber(this.controller, this.policy);
+
+  void add(PointerLockMoveEvent event) {
+    if (policy == PointerLockDeliveryPolicy.everySample) {
+      // Events held back before the policy changed go first
+      flush();
+      controller.add(event);
+      return;
+    }
+    final previous = _pending.lastOrNull;
+    if (event.kind != PointerLockEventKind.move || previous == null || previous.kind != PointerLockEventKind.move) {
+      _pending.add(event);
+    } else {
+      _pending.last = policy == PointerLockDeliveryPolicy.latestOnly ? event : _sum(previous, event);
+    }
+    if (!_flushScheduled) {
+      _flushScheduled = true;
+      SchedulerBinding.instance.scheduleFrameCallback((_) => flush());
+      SchedulerBinding.instance.scheduleFrame();
+    }
+  }
+
+  void flush() {
+    _flushScheduled = false;
+    if (controller.isClosed) {
+      _pending.clear();
+      return;
+    }
+    for (final event in _pending) {
+      controller.add(event);
+    }
+    _pending.clear();
+  }
+}
+
+Offset? _sumOrNull(Offset? previous, Offset? latest) {
+  return previous == null || latest == null ? latest : previous + latest;
+}
+
+PointerLockMoveEvent _sum(PointerLockMoveEvent previous, PointerLockMoveEvent latest) {
+  return PointerLockMoveEvent(
+    delta: previous.delta + latest.delta,
+    kind: latest.kind,
+    button: latest.button,
+    buttons: latest.buttons,
+    modifiers: latest.modifiers,
+    deviceId: latest.deviceId,
+    timestamp: latest.timestamp,
+    filteredDelta: previous.filteredDelta + latest.filteredDelta,
+    velocity: latest.velocity,
+    acceleration: latest.acceleration,
+    // Predicted deltas add up just like the deltas, see PointerLockMoveEvent.predictedDelta.
+    predictedDelta: previous.predictedDelta + latest.predictedDelta,
+    predictionConfidence: latest.predictionConfidence,
+    value: latest.value,
+    cursorPosition: latest.cursorPosition,
+    position: latest.position,
+    physicalDelta: _sumOrNull(previous.physicalDelta, latest.physicalDelta),
+  );
+}
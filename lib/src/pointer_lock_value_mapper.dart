@@ -0,0 +1,113 @@
+import 'dart:math' as math;
+import 'dart:ui';
+
+import 'pointer_lock.dart';
+import 'pointer_lock_options.dart';
+
+/// Dart counterpart of `ValueStage` in `pointer_lock_stages.h`, for platforms that don't map values natively.
+class ValueMapper {
+  final PointerLockValueMode mode;
+  double _value;
+  double _emittedValue;
+
+  ValueMapper(this.mode)
+      : _value = 0,
+        _emittedValue = 0 {
+    _value = _bound(mode.start);
+    _emittedValue = _round(_value);
+  }
+
+  Iterable<PointerLockMoveEvent> map(PointerLockMoveEvent event) sync* {
+    if (event.kind != PointerLockEventKind.move) {
+      yield _copyEvent(event, value: _emittedValue);
+      return;
+    }
+    final distance = switch (mode.axis) {
+      PointerLockValueAxis.horizontal => event.delta.dx,
+      PointerLockValueAxis.vertical => -event.delta.dy,
+      PointerLockValueAxis.both => event.delta.dx - event.delta.dy,
+    };
+    var change = distance * (mode.max - mode.min) / mode.pixelsPerRange;
+    if (event.modifiers.bits & mode.fineModifiers.bits != 0) {
+      change *= mode.fineFactor;
+    }
+    _value = _bound(_value + change);
+    final value = _round(_value);
+    if (value == _emittedValue) {
+      return;
+    }
+    _emittedValue = value;
+    yield _copyEvent(event, value: value);
+  }
+
+  double _bound(double value) {
+    final range = mode.max - mode.min;
+    if (!mode.wrap || range <= 0) {
+      return value.clamp(mode.min, mode.max);
+    }
+    // Dart's % is never negative for a positive divisor.
+    return mode.min + (value - mode.min) % range;
+  }
+
+  double _round(double value) {
+    if (mode.step <= 0) {
+      return value;
+    }
+    final rounded = mode.min + ((value - mode.min) / mode.step).roundToDouble() * mode.step;
+    if (mode.wrap && rounded >= mode.max) {
+      // When wrapping, max and min denote the same value
+      return mode.min;
+    }
+    return math.min(rounded, mode.max);
+  }
+}
+
+/// Dart counterpart of `CursorStage` in `pointer_lock_stages.h`, for platforms that don't integrate the virtual cursor
+/// natively.
+class VirtualCursorIntegrator {
+  final PointerLockVirtualCursor cursor;
+  Offset _position;
+
+  VirtualCursorIntegrator(this.cursor) : _position = cursor.position.value;
+
+  PointerLockMoveEvent map(PointerLockMoveEvent event) {
+    if (event.kind == PointerLockEventKind.move) {
+      final bounds = cursor.bounds;
+      _position = Offset(
+        _bound(_position.dx + event.delta.dx, bounds.left, bounds.right),
+        _bound(_position.dy + event.delta.dy, bounds.top, bounds.bottom),
+      );
+      cursor.position.value = _position;
+    }
+    return _copyEvent(event, cursorPosition: _position);
+  }
+
+  double _bound(double value, double min, double max) {
+    final range = max - min;
+    if (!cursor.wrap || range <= 0) {
+      return value.clamp(min, max);
+    }
+    return min + (value - min) % range;
+  }
+}
+
+PointerLockMoveEvent _copyEvent(PointerLockMoveEvent event, {double? value, Offset? cursorPosition}) {
+  return PointerLockMoveEvent(
+    delta: event.delta,
+    kind: event.kind,
+    button: event.button,
+    buttons: event.buttons,
+    modifiers: event.modifiers,
+    deviceId: event.deviceId,
+    timestamp: event.timestamp,
+    filteredDelta: event.filteredDelta,
+    velocity: event.velocity,
+    acceleration: event.acceleration,
+    predictedDelta: event.predictedDelta,
+    predictionConfidence: event.predictionConfidence,
+    value: value ?? event.value,
+    cursorPosition: cursorPosition ?? event.cursorPosition,
+    position: event.position,
+    physicalDelta: event.physicalDelta,
+  );
+}
@@ -5,7 +5,10 @@ import 'package:flutter_web_plugins/flutter_web_plugins.dart';
 import 'package:web/web.dart' as web;
 
 import '../../src/pointer_lock.dart';
+import '../../src/pointer_lock_batch.dart';
+import '../../src/pointer_lock_options.dart';
 import '../../src/pointer_lock_platform_interface.dart';
+import '../../src/pointer_lock_value_mapper.dart';
 
 /// A web implementation of the PointerLockPlatform of the PointerLock plugin.
 class PointerLockWeb extends PointerLockPlatform {
@@ -24,6 +27,12 @@ class PointerLockWeb extends PointerLockPlatform {
     required PointerLockWindowsMode windowsMode,
     required PointerLockCursor cursor,
     required bool unlockOnPointerUp,
+    PointerLockTransform? transform,
+    PointerLockFilter? filter,
+    int velocityWindow = 0,
+    PointerLockPrediction? prediction,
+    PointerLockValueMode? valueMode,
+    PointerLockVirtualCursor? virtualCursor,
   }) {
     final controller = StreamController<PointerLockMoveEvent>();
     final document = web.document;
@@ -122,7 +131,25 @@ class PointerLockWeb extends PointerLockPlatform {
 
     controller.onCancel = unlock;
 
-    return controller.stream;
+    var stream = controller.stream;
+    if (virtualCursor != null) {
+      stream = stream.map(VirtualCursorIntegrator(virtualCursor).map);
+    }
+    if (valueMode != null) {
+      stream = stream.expand(ValueMapper(valueMode).map);
+    }
+    return stream;
+  }
+
+  @override
+  Stream<PointerLockEventBatch> createBatchedSession({
+    required PointerLockWindowsMode windowsMode,
+    required PointerLockCursor cursor,
+    required bool unlockOnPointerUp,
+    PointerLockTransform? transform,
+  }) {
+    // The batch columns use Int64List, which isn't available when compiling to JavaScript.
+    return Stream.error(UnsupportedError('createBatchedSession() is not supported on web'));
   }
 
   @override
@@ -135,6 +162,18 @@ class PointerLockWeb extends PointerLockPlatform {
     // Not supported on web
   }
 
+  @override
+  Future<List<PointerLockDevice>> pointingDevices() async {
+    // Browsers don't expose individual pointing devices
+    return const [];
+  }
+
+  @override
+  Future<PointerLockMotionHistory> motionHistory({required Duration window}) async {
+    // Not supported on web
+    return PointerLockMotionHistory.empty;
+  }
+
   @override
   Future<Offset> pointerPositionOnScreen() async {
     return Offset(
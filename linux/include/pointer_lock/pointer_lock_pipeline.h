@@ -0,0 +1,169 @@
+#ifndef FLUTTER_PLUGIN_POINTER_LOCK_PIPELINE_H_
+#define FLUTTER_PLUGIN_POINTER_LOCK_PIPELINE_H_
+
+#include <cstddef>
+#include <tuple>
+#include <type_traits>
+
+// This file contains the compile-time pipeline which a native session runs each sample through, and the hook for
+// adding custom stages to it. It's header-only and doesn't depend on GTK or Flutter.
+//
+// A stage is any default-constructible class with a member function `process(Sample& sample)`. It may modify the
+// sample. If it returns a bool, false drops the sample: the stages after it don't see it, and it isn't delivered.
+// The pipeline holds its stages by value and calls them directly, so the compiler can inline the whole pipeline.
+//
+// Custom stages are registered by specializing RegisteredStages in a header whose path is passed to the plug-in's
+// CMake configuration as POINTER_LOCK_STAGES_HEADER, e.g. in the application's linux/CMakeLists.txt:
+//
+//     set(POINTER_LOCK_STAGES_HEADER "${CMAKE_CURRENT_SOURCE_DIR}/my_stages.h" CACHE STRING "" FORCE)
+//
+// The header is compiled into the plug-in and can include "pointer_lock_events.h" for pointer_lock::Sample:
+//
+//     #include "pointer_lock_events.h"
+//
+//     struct DeadZoneStage
+//     {
+//         bool process(pointer_lock::Sample& sample)
+//         {
+//             return sample.kind != pointer_lock::EventKind::kMove || std::hypot(sample.dx, sample.dy) >= 0.5;
+//         }
+//     };
+//
+//     namespace pointer_lock
+//     {
+//     template <>
+//     struct RegisteredStages<StageSlot::kAfterTransform>
+//     {
+//         using type = StageList<DeadZoneStage>;
+//     };
+//     }  // namespace pointer_lock
+
+namespace pointer_lock
+{
+
+template <typename... Stages>
+struct StageList
+{
+};
+
+// Where registered stages run within a session's pipeline.
+enum class StageSlot
+{
+    // Right after the built-in transform, so everything derived from the deltas (the virtual cursor, filtering,
+    // velocity, prediction, value mode) sees what the stages did, e.g. a dead zone or a custom curve. The physical
+    // deltas are taken before the transform.
+    kAfterTransform,
+    // After all built-in stages, right before the samples are delivered, e.g. for telemetry.
+    kBeforeDelivery,
+};
+
+// Specialize this for a slot to register stages there. The stages run in the order of the list.
+template <StageSlot slot>
+struct RegisteredStages
+{
+    using type = StageList<>;
+};
+
+namespace pipeline_detail
+{
+
+// Calls a stage, treating stages which don't return a bool as never dropping samples. The int/long parameter makes
+// the first overload win if both are viable.
+template <typename Stage, typename Sample>
+auto run_stage(Stage& stage, Sample& sample, int) -> decltype(static_cast<bool>(stage.process(sample)))
+{
+    return static_cast<bool>(stage.process(sample));
+}
+
+template <typename Stage, typename Sample>
+bool run_stage(Stage& stage, Sample& sample, long)
+{
+    stage.process(sample);
+    return true;
+}
+
+// The position of a stage type within a list of stage types.
+template <typename Stage, typename... Stages>
+struct IndexOf;
+
+template <typename Stage, typename... Rest>
+struct IndexOf<Stage, Stage, Rest...> : std::integral_constant<size_t, 0>
+{
+};
+
+template <typename Stage, typename First, typename... Rest>
+struct IndexOf<Stage, First, Rest...> : std::integral_constant<size_t, 1 + IndexOf<Stage, Rest...>::value>
+{
+};
+
+}  // namespace pipeline_detail
+
+// Runs each sample through the given stages, in order.
+template <typename... Stages>
+class Pipeline
+{
+public:
+    // Returns whether the sample made it through all stages.
+    template <typename Sample>
+    bool process(Sample& sample)
+    {
+        return process_from(sample, std::integral_constant<size_t, 0>());
+    }
+
+    // Like process(), but only runs the stages after the given one, e.g. for samples produced by that stage itself.
+    template <typename Stage, typename Sample>
+    bool process_after(Sample& sample)
+    {
+        return process_from(sample,
+                            std::integral_constant<size_t, pipeline_detail::IndexOf<Stage, Stages...>::value + 1>());
+    }
+
+    // Returns the stage of the given type, e.g. for reconfiguring it. Each type can only be part of the pipeline once.
+    template <typename Stage>
+    Stage& get()
+    {
+        return std::get<Stage>(stages_);
+    }
+
+    template <typename Stage>
+    const Stage& get() const
+    {
+        return std::get<Stage>(stages_);
+    }
+
+private:
+    template <typename Sample>
+    bool process_from(Sample&, std::integral_constant<size_t, sizeof...(Stages)>)
+    {
+        return true;
+    }
+
+    template <typename Sample, size_t index>
+    bool process_from(Sample& sample, std::integral_constant<size_t, index>)
+    {
+        return pipeline_detail::run_stage(std::get<index>(stages_), sample, 0) &&
+               process_from(sample, std::integral_constant<size_t, index + 1>());
+    }
+
+    std::tuple<Stages...> stages_;
+};
+
+// The pipeline made of the stages of all given lists, in order.
+template <typename... Lists>
+struct PipelineOf;
+
+template <typename... Stages>
+struct PipelineOf<StageList<Stages...>>
+{
+    using type = Pipeline<Stages...>;
+};
+
+template <typename... First, typename... Second, typename... Rest>
+struct PipelineOf<StageList<First...>, StageList<Second...>, Rest...>
+    : PipelineOf<StageList<First..., Second...>, Rest...>
+{
+};
+
+}  // namespace pointer_lock
+
+#endif  // FLUTTER_PLUGIN_POINTER_LOCK_PIPELINE_H_
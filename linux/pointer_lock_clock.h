@@ -0,0 +1,126 @@
+#ifndef POINTER_LOCK_CLOCK_H_
+#define POINTER_LOCK_CLOCK_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+
+// This file contains the mapping of event times to the monotonic clock. Like pointer_lock_events.h, it doesn't
+// depend on GTK or Flutter.
+
+namespace pointer_lock
+{
+
+// Maps the 32-bit millisecond event times of the display server (gdk_event_get_time()) to the monotonic clock of
+// this process (g_get_monotonic_time(), which is CLOCK_MONOTONIC), in microseconds. This way, the sample timestamps
+// say when the input happened rather than when the main loop got to it.
+class EventClock
+{
+public:
+    enum class Source
+    {
+        // The server's clock is unrelated to ours (X11: it starts when the server starts and might run on another
+        // machine). The offset between both clocks is estimated from the times at which events arrive.
+        kServer,
+        // The times are CLOCK_MONOTONIC milliseconds already, truncated to 32 bits. Wayland compositors pass on the
+        // kernel's evdev timestamps like that. Falls back to kServer if the times turn out to be far off.
+        kMonotonic,
+    };
+
+    // Forgets everything learned about the server's clock, e.g. when a new session starts.
+    void reset(Source source)
+    {
+        source_ = source;
+        synced_ = false;
+        last_us_ = 0;
+    }
+
+    // Returns the time of an event with the given server time which has been received at now_us. The result is never
+    // later than now_us and never earlier than the previous one. Events without a time (0, e.g. synthesized ones)
+    // get now_us.
+    int64_t map(uint32_t event_time_ms, int64_t now_us)
+    {
+        int64_t mapped_us = now_us;
+        if (event_time_ms != 0)
+        {
+            mapped_us = source_ == Source::kMonotonic ? map_monotonic(event_time_ms, now_us)
+                                                      : map_server(event_time_ms, now_us);
+        }
+        mapped_us = std::max(std::min(mapped_us, now_us), last_us_);
+        last_us_ = mapped_us;
+        return mapped_us;
+    }
+
+private:
+    // A monotonic time this far away from now means the server doesn't use CLOCK_MONOTONIC after all
+    static constexpr int64_t kMaxMonotonicSkewMs = 10000;
+    // How fast the clocks may drift apart, in microseconds per second
+    static constexpr int64_t kMaxDriftUsPerS = 500;
+    // An event delayed by more than this means the server's clock jumped (or the main loop stalled, in which case
+    // re-syncing doesn't hurt either)
+    static constexpr int64_t kMaxDelayUs = 1000000;
+
+    // Picks the millisecond closest to now whose lower 32 bits are the event time.
+    int64_t map_monotonic(uint32_t event_time_ms, int64_t now_us)
+    {
+        const int64_t now_ms = now_us / 1000;
+        const int64_t event_ms = now_ms + static_cast<int32_t>(event_time_ms - static_cast<uint32_t>(now_ms));
+        if (std::abs(event_ms - now_ms) > kMaxMonotonicSkewMs)
+        {
+            source_ = Source::kServer;
+            return map_server(event_time_ms, now_us);
+        }
+        return event_ms * 1000;
+    }
+
+    int64_t map_server(uint32_t event_time_ms, int64_t now_us)
+    {
+        if (!synced_)
+        {
+            synced_ = true;
+            server_ms_ = event_time_ms;
+            offset_us_ = now_us - server_ms_ * 1000;
+        }
+        else
+        {
+            // The signed difference survives the wraparound every 49.7 days, and slightly out-of-order times.
+            const int64_t elapsed_ms = static_cast<int32_t>(event_time_ms - last_event_time_ms_);
+            server_ms_ += elapsed_ms;
+            update_offset(now_us - server_ms_ * 1000, elapsed_ms);
+        }
+        last_event_time_ms_ = event_time_ms;
+        return server_ms_ * 1000 + offset_us_;
+    }
+
+    // Each event arrives some time after it happened, so the offset is at most now - server time. The least delayed
+    // events give the best estimate, so the estimate follows smaller offsets right away. Larger offsets are only
+    // followed as fast as the clocks can drift apart, so delayed events don't pull the estimate up.
+    void update_offset(int64_t observed_offset_us, int64_t elapsed_ms)
+    {
+        if (observed_offset_us <= offset_us_)
+        {
+            offset_us_ = observed_offset_us;
+            return;
+        }
+        if (observed_offset_us - offset_us_ > kMaxDelayUs)
+        {
+            offset_us_ = observed_offset_us;
+            return;
+        }
+        const int64_t max_drift_us = std::max<int64_t>(elapsed_ms, 0) * kMaxDriftUsPerS / 1000;
+        offset_us_ = std::min(observed_offset_us, offset_us_ + max_drift_us);
+    }
+
+    Source source_ = Source::kServer;
+    bool synced_ = false;
+    uint32_t last_event_time_ms_ = 0;
+    // The server time, extended to 64 bits
+    int64_t server_ms_ = 0;
+    // Monotonic time minus server time
+    int64_t offset_us_ = 0;
+    int64_t last_us_ = 0;
+};
+
+}  // namespace pointer_lock
+
+#endif  // POINTER_LOCK_CLOCK_H_
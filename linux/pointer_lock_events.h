@@ -0,0 +1,384 @@
+#ifndef POINTER_LOCK_EVENTS_H_
+#define POINTER_LOCK_EVENTS_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+// This file contains the platform-independent representation of the events produced by a native session and
+// their wire encoding. It doesn't depend on GTK or Flutter.
+
+namespace pointer_lock
+{
+
+// Kinds of events produced by a native session. Must be kept in sync with `PointerLockEventKind` in Dart.
+enum class EventKind : int
+{
+    kMove = 0,
+    kButtonDown = 1,
+    kButtonUp = 2,
+    kScroll = 3,
+};
+
+// A single event produced by a native session.
+struct Sample
+{
+    EventKind kind = EventKind::kMove;
+    // Pointer movement (move events) or scroll amount in notches, possibly fractional (scroll events).
+    double dx = 0;
+    double dy = 0;
+    // Time at which the event was produced, in microseconds of the monotonic clock.
+    int64_t timestamp_us = 0;
+    // The button that went down or up, using Flutter's button constants (e.g. kPrimaryButton).
+    int button = 0;
+    // The buttons pressed when the event happened, as combination of Flutter's button constants.
+    int buttons = 0;
+    // The modifier keys pressed when the event happened, as combination of the Modifier bits.
+    int modifiers = 0;
+    // The physical device which produced the event (see pointing_device_id()), zero if unknown.
+    int device_id = 0;
+    // Move events only: the delta after smoothing (see FilterStage).
+    double filtered_dx = 0;
+    double filtered_dy = 0;
+    // Move events only: estimated velocity in pixels per second and acceleration in pixels per second squared
+    // (see VelocityStage).
+    double velocity_x = 0;
+    double velocity_y = 0;
+    double acceleration_x = 0;
+    double acceleration_y = 0;
+    // Move events only: the delta including the predicted movement until the next frame is presented, and how
+    // reliable the prediction is, from 0 to 1 (see PredictionStage).
+    double predicted_dx = 0;
+    double predicted_dy = 0;
+    double prediction_confidence = 0;
+    // The current value of a value-mode session (see ValueStage), NaN if the session is not in value mode.
+    double value = std::numeric_limits<double>::quiet_NaN();
+    // The position of the virtual cursor (see CursorStage), NaN if the session doesn't maintain one.
+    double cursor_x = std::numeric_limits<double>::quiet_NaN();
+    double cursor_y = std::numeric_limits<double>::quiet_NaN();
+    // The pointer position relative to the view, NaN unless the session confines the pointer instead of locking it.
+    double position_x = std::numeric_limits<double>::quiet_NaN();
+    double position_y = std::numeric_limits<double>::quiet_NaN();
+    // Move events only: the delta in physical pixels of the monitor before the session's transform, NaN for other
+    // events. The other values are in logical pixels.
+    double physical_dx = std::numeric_limits<double>::quiet_NaN();
+    double physical_dy = std::numeric_limits<double>::quiet_NaN();
+};
+
+// Modifier key bits. Must be kept in sync with `PointerLockModifiers` in Dart.
+enum Modifier : int
+{
+    kShiftModifier = 1 << 0,
+    kControlModifier = 1 << 1,
+    kAltModifier = 1 << 2,
+    kMetaModifier = 1 << 3,
+};
+
+// Columns of an encoded batch. Must be kept in sync with `NativeBatchColumn` in Dart.
+enum Column : size_t
+{
+    kKindColumn,
+    kDxColumn,
+    kDyColumn,
+    kTimestampColumn,
+    kButtonColumn,
+    kButtonsColumn,
+    kModifiersColumn,
+    kDeviceColumn,
+    kFilteredDxColumn,
+    kFilteredDyColumn,
+    kVelocityXColumn,
+    kVelocityYColumn,
+    kAccelerationXColumn,
+    kAccelerationYColumn,
+    kPredictedDxColumn,
+    kPredictedDyColumn,
+    kPredictionConfidenceColumn,
+    kValueColumn,
+    kCursorXColumn,
+    kCursorYColumn,
+    kPositionXColumn,
+    kPositionYColumn,
+    kPhysicalDxColumn,
+    kPhysicalDyColumn,
+    kColumnCount,
+};
+
+// Number of values preceding the columns: the number of samples in the batch, the ID of the subscription which
+// receives it (see FanOut) and the column mask.
+constexpr size_t kBatchHeaderLength = 3;
+
+// The bit of a column in the column mask, which tells which columns an encoded batch contains.
+constexpr uint32_t column_bit(Column column)
+{
+    return static_cast<uint32_t>(1) << column;
+}
+
+// The columns contained in every encoded batch. The others belong to optional features and are only encoded for
+// sessions using them. Leaving a column out is lossless as long as the feature is disabled: Dart falls back to what
+// the stages produce in that case (e.g. the delta as filtered delta).
+constexpr uint32_t kBaseColumns = column_bit(kKindColumn) | column_bit(kDxColumn) | column_bit(kDyColumn) |
+                                  column_bit(kTimestampColumn) | column_bit(kButtonColumn) |
+                                  column_bit(kButtonsColumn) | column_bit(kModifiersColumn) |
+                                  column_bit(kDeviceColumn) | column_bit(kPhysicalDxColumn) |
+                                  column_bit(kPhysicalDyColumn);
+
+constexpr uint32_t kAllColumns = (static_cast<uint32_t>(1) << kColumnCount) - 1;
+
+// Stores an integer in a double slot bit by bit. Integer columns are encoded like this, so Dart can view them as
+// Int64List without converting each value.
+inline double int_bits(int64_t value)
+{
+    double result;
+    std::memcpy(&result, &value, sizeof(result));
+    return result;
+}
+
+// Reverses int_bits().
+inline int64_t int_from_bits(double value)
+{
+    int64_t result;
+    std::memcpy(&result, &value, sizeof(result));
+    return result;
+}
+
+// The number of columns in a column mask.
+inline size_t column_count(uint32_t columns)
+{
+    size_t count = 0;
+    for (size_t column = 0; column < kColumnCount; column++)
+    {
+        count += (columns >> column) & 1;
+    }
+    return count;
+}
+
+// Collects samples and encodes them as one list of doubles, column after column:
+//
+//     [count, subscription_id, column_mask, kind_0 .. kind_n, dx_0 .. dx_n, dy_0 .. dy_n, ...]
+//
+// Only the columns in the column mask are encoded, in the order of Column. The header and the integer columns (kind,
+// timestamp, button, buttons, modifiers and device) are encoded with int_bits().
+//
+// The buffers are reused across batches, so encoding doesn't allocate once they have grown large enough.
+class EventBatch
+{
+public:
+    void add(const Sample& sample)
+    {
+        samples_.push_back(sample);
+    }
+
+    void clear()
+    {
+        samples_.clear();
+    }
+
+    bool empty() const
+    {
+        return samples_.empty();
+    }
+
+    size_t size() const
+    {
+        return samples_.size();
+    }
+
+    const Sample& operator[](size_t index) const
+    {
+        return samples_[index];
+    }
+
+    Sample& back()
+    {
+        return samples_.back();
+    }
+
+    // Encodes the collected samples, only with the given columns (plus kBaseColumns). The returned buffer stays valid
+    // until the next call.
+    const std::vector<double>& encode(int64_t subscription_id = 0, uint32_t columns = kAllColumns)
+    {
+        columns |= kBaseColumns;
+        const size_t count = samples_.size();
+        encoded_.resize(kBatchHeaderLength + count * column_count(columns));
+        encoded_[0] = int_bits(static_cast<int64_t>(count));
+        encoded_[1] = int_bits(subscription_id);
+        encoded_[2] = int_bits(columns);
+        double* values = encoded_.data() + kBatchHeaderLength;
+        for (size_t column = 0; column < kColumnCount; column++)
+        {
+            if (columns & column_bit(static_cast<Column>(column)))
+            {
+                encode_column(static_cast<Column>(column), values);
+                values += count;
+            }
+        }
+        return encoded_;
+    }
+
+private:
+    // Picks the member once per column, so each column is encoded by a loop without branches.
+    void encode_column(Column column, double* values) const
+    {
+        switch (column)
+        {
+        case kKindColumn:
+            encode_ints(&Sample::kind, values);
+            break;
+        case kDxColumn:
+            encode_doubles(&Sample::dx, values);
+            break;
+        case kDyColumn:
+            encode_doubles(&Sample::dy, values);
+            break;
+        case kTimestampColumn:
+            encode_ints(&Sample::timestamp_us, values);
+            break;
+        case kButtonColumn:
+            encode_ints(&Sample::button, values);
+            break;
+        case kButtonsColumn:
+            encode_ints(&Sample::buttons, values);
+            break;
+        case kModifiersColumn:
+            encode_ints(&Sample::modifiers, values);
+            break;
+        case kDeviceColumn:
+            encode_ints(&Sample::device_id, values);
+            break;
+        case kFilteredDxColumn:
+            encode_doubles(&Sample::filtered_dx, values);
+            break;
+        case kFilteredDyColumn:
+            encode_doubles(&Sample::filtered_dy, values);
+            break;
+        case kVelocityXColumn:
+            encode_doubles(&Sample::velocity_x, values);
+            break;
+        case kVelocityYColumn:
+            encode_doubles(&Sample::velocity_y, values);
+            break;
+        case kAccelerationXColumn:
+            encode_doubles(&Sample::acceleration_x, values);
+            break;
+        case kAccelerationYColumn:
+            encode_doubles(&Sample::acceleration_y, values);
+            break;
+        case kPredictedDxColumn:
+            encode_doubles(&Sample::predicted_dx, values);
+            break;
+        case kPredictedDyColumn:
+            encode_doubles(&Sample::predicted_dy, values);
+            break;
+        case kPredictionConfidenceColumn:
+            encode_doubles(&Sample::prediction_confidence, values);
+            break;
+        case kValueColumn:
+            encode_doubles(&Sample::value, values);
+            break;
+        case kCursorXColumn:
+            encode_doubles(&Sample::cursor_x, values);
+            break;
+        case kCursorYColumn:
+            encode_doubles(&Sample::cursor_y, values);
+            break;
+        case kPositionXColumn:
+            encode_doubles(&Sample::position_x, values);
+            break;
+        case kPositionYColumn:
+            encode_doubles(&Sample::position_y, values);
+            break;
+        case kPhysicalDxColumn:
+            encode_doubles(&Sample::physical_dx, values);
+            break;
+        case kPhysicalDyColumn:
+            encode_doubles(&Sample::physical_dy, values);
+            break;
+        case kColumnCount:
+            break;
+        }
+    }
+
+    void encode_doubles(double Sample::*member, double* values) const
+    {
+        const size_t count = samples_.size();
+        for (size_t i = 0; i < count; i++)
+        {
+            values[i] = samples_[i].*member;
+        }
+    }
+
+    template <typename T>
+    void encode_ints(T Sample::*member, double* values) const
+    {
+        const size_t count = samples_.size();
+        for (size_t i = 0; i < count; i++)
+        {
+            values[i] = int_bits(static_cast<int64_t>(samples_[i].*member));
+        }
+    }
+
+    std::vector<Sample> samples_;
+    std::vector<double> encoded_;
+};
+
+// Where the columns of a batch encoded by EventBatch are, for readers on the native side. Mirrors
+// `NativeBatchLayout` in Dart: a column's offset follows from the columns before it in the column mask.
+class BatchLayout
+{
+public:
+    // Reads the header of the given batch. The layout is invalid if the batch is malformed.
+    BatchLayout(const double* values, size_t length)
+    {
+        if (length < kBatchHeaderLength)
+        {
+            return;
+        }
+        const int64_t count = int_from_bits(values[0]);
+        const int64_t columns = int_from_bits(values[2]);
+        if (count < 0 || columns < 0 || columns > kAllColumns ||
+            length - kBatchHeaderLength != static_cast<size_t>(count) * column_count(columns))
+        {
+            return;
+        }
+        values_ = values + kBatchHeaderLength;
+        count_ = static_cast<size_t>(count);
+        columns_ = static_cast<uint32_t>(columns);
+    }
+
+    bool valid() const
+    {
+        return values_ != nullptr;
+    }
+
+    size_t count() const
+    {
+        return count_;
+    }
+
+    bool contains(Column column) const
+    {
+        return (columns_ & column_bit(column)) != 0;
+    }
+
+    // The values of the given column, nullptr if the batch doesn't contain it.
+    const double* column(Column column) const
+    {
+        if (!contains(column))
+        {
+            return nullptr;
+        }
+        return values_ + column_count(columns_ & (column_bit(column) - 1)) * count_;
+    }
+
+private:
+    const double* values_ = nullptr;
+    size_t count_ = 0;
+    uint32_t columns_ = 0;
+};
+
+}  // namespace pointer_lock
+
+#endif  // POINTER_LOCK_EVENTS_H_
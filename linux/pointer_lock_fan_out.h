@@ -0,0 +1,210 @@
+#ifndef POINTER_LOCK_FAN_OUT_H_
+#define POINTER_LOCK_FAN_OUT_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "pointer_lock_events.h"
+
+// This file contains the fan-out of one native session to several subscriptions. It doesn't depend on GTK or
+// Flutter.
+
+namespace pointer_lock
+{
+
+// How a subscription receives the samples of a session. Must be kept in sync with `PointerLockDeliveryPolicy` in
+// Dart.
+enum class DeliveryPolicy : int
+{
+    // Each sample right away, but samples which arrive together (see FanOut::dispatch()) are sent in one batch.
+    kEverySample = 0,
+    // Once per frame. Consecutive move samples are merged into one, summing up the deltas.
+    kFrameSum = 1,
+    // Once per frame. Consecutive move samples are replaced by the latest one.
+    kLatestOnly = 2,
+};
+
+// What FanOut::dispatch() left pending
+struct PendingDelivery
+{
+    // Subscriptions receiving every sample have samples to send, see FanOut::flush_every_sample()
+    bool every_sample = false;
+    // Other subscriptions have samples to send with the next frame, see FanOut::flush()
+    bool frame = false;
+};
+
+// Distributes the samples of a session to its subscriptions, coalescing them according to each subscription's
+// policy. Button and scroll samples are never coalesced, and the order of samples is kept within each subscription.
+//
+// Batches are sent encoded (see EventBatch), with the ID of the receiving subscription in the header and only with
+// the columns set via set_columns().
+class FanOut
+{
+public:
+    // Adds a subscription, or changes its policy if it exists already.
+    void add(int64_t id, DeliveryPolicy policy)
+    {
+        Subscription* existing = find(id);
+        if (existing)
+        {
+            existing->policy = policy;
+            return;
+        }
+        subscriptions_.emplace_back();
+        subscriptions_.back().id = id;
+        subscriptions_.back().policy = policy;
+    }
+
+    // Changes the policy of a subscription. Samples it has pending are sent with the next batch either way. Returns
+    // false if there's no such subscription.
+    bool set_policy(int64_t id, DeliveryPolicy policy)
+    {
+        Subscription* existing = find(id);
+        if (!existing)
+        {
+            return false;
+        }
+        existing->policy = policy;
+        return true;
+    }
+
+    // Removes a subscription, dropping whatever it has pending.
+    void remove(int64_t id)
+    {
+        subscriptions_.erase(std::remove_if(subscriptions_.begin(),
+                                            subscriptions_.end(),
+                                            [id](const Subscription& s) { return s.id == id; }),
+                             subscriptions_.end());
+    }
+
+    bool empty() const
+    {
+        return subscriptions_.empty();
+    }
+
+    // Sets the columns to encode in addition to kBaseColumns, as mask of column_bit()s. All columns by default.
+    void set_columns(uint32_t columns)
+    {
+        columns_ = columns;
+    }
+
+    // Hands a sample to all subscriptions, without sending anything. Subscriptions receiving every sample should be
+    // sent theirs as soon as the events which arrived along with this one have been handled, so a burst of events
+    // takes one batch instead of one per sample. The others should be sent with the next frame.
+    PendingDelivery dispatch(const Sample& sample)
+    {
+        PendingDelivery pending;
+        for (Subscription& subscription : subscriptions_)
+        {
+            if (subscription.policy == DeliveryPolicy::kEverySample)
+            {
+                subscription.batch.add(sample);
+                pending.every_sample = true;
+                continue;
+            }
+            coalesce(subscription, sample);
+            pending.frame = true;
+        }
+        return pending;
+    }
+
+    // Sends the pending samples of the subscriptions receiving every sample, via send(values, length).
+    template <typename Send>
+    void flush_every_sample(Send&& send)
+    {
+        for (Subscription& subscription : subscriptions_)
+        {
+            if (subscription.policy == DeliveryPolicy::kEverySample && !subscription.batch.empty())
+            {
+                send_batch(subscription, send);
+            }
+        }
+    }
+
+    // Sends the pending samples of all subscriptions, via send(values, length).
+    template <typename Send>
+    void flush(Send&& send)
+    {
+        for (Subscription& subscription : subscriptions_)
+        {
+            if (!subscription.batch.empty())
+            {
+                send_batch(subscription, send);
+            }
+        }
+    }
+
+    // Drops the pending samples of all subscriptions.
+    void clear()
+    {
+        for (Subscription& subscription : subscriptions_)
+        {
+            subscription.batch.clear();
+        }
+    }
+
+private:
+    struct Subscription
+    {
+        int64_t id = 0;
+        DeliveryPolicy policy = DeliveryPolicy::kEverySample;
+        EventBatch batch;
+    };
+
+    Subscription* find(int64_t id)
+    {
+        for (Subscription& subscription : subscriptions_)
+        {
+            if (subscription.id == id)
+            {
+                return &subscription;
+            }
+        }
+        return nullptr;
+    }
+
+    static void coalesce(Subscription& subscription, const Sample& sample)
+    {
+        EventBatch& batch = subscription.batch;
+        if (sample.kind != EventKind::kMove || batch.empty() || batch.back().kind != EventKind::kMove)
+        {
+            batch.add(sample);
+            return;
+        }
+        Sample& previous = batch.back();
+        if (subscription.policy == DeliveryPolicy::kLatestOnly)
+        {
+            previous = sample;
+            return;
+        }
+        // Deltas add up, everything else describes the latest state.
+        Sample merged = sample;
+        merged.dx += previous.dx;
+        merged.dy += previous.dy;
+        merged.filtered_dx += previous.filtered_dx;
+        merged.filtered_dy += previous.filtered_dy;
+        merged.physical_dx += previous.physical_dx;
+        merged.physical_dy += previous.physical_dy;
+        // Predicted deltas add up as well: the sum is the sum of the deltas plus the change of the predicted offset
+        // since the sample before the merged ones.
+        merged.predicted_dx += previous.predicted_dx;
+        merged.predicted_dy += previous.predicted_dy;
+        previous = merged;
+    }
+
+    template <typename Send>
+    void send_batch(Subscription& subscription, Send& send)
+    {
+        const std::vector<double>& encoded = subscription.batch.encode(subscription.id, columns_);
+        send(encoded.data(), encoded.size());
+        subscription.batch.clear();
+    }
+
+    std::vector<Subscription> subscriptions_;
+    uint32_t columns_ = kAllColumns;
+};
+
+}  // namespace pointer_lock
+
+#endif  // POINTER_LOCK_FAN_OUT_H_
@@ -4,9 +4,15 @@
 #include <gtk/gtk.h>
 #include <sys/utsname.h>
 
+#include <algorithm>
+#include <cmath>
 #include <cstring>
+#include <vector>
 
 #include "pointer_lock_plugin_private.h"
+#include "pointer_lock_position_stream.h"
+#include "pointer_lock_session.h"
+#include "pointer_lock_x11_async.h"
 
 #define POINTER_LOCK_PLUGIN(obj) \
   (G_TYPE_CHECK_INSTANCE_CAST((obj), pointer_lock_plugin_get_type(), \
@@ -18,8 +24,21 @@ struct _PointerLockPlugin
     FlPluginRegistrar* registrar;
     GdkPoint initial_pointer_pos;
     bool cursor_visible;
+    FlEventChannel* session_event_channel;
+    // The session driven by the "pointer_lock_session" event channel, if any.
+    pointer_lock::Session* native_session;
+    // Recent move samples of the native session. Outlives the session, so it can be queried right after it ended.
+    pointer_lock::MotionHistory* motion_history;
+    FlEventChannel* position_event_channel;
+    // The stream driven by the "pointer_lock_position" event channel, if any.
+    pointer_lock::PositionStream* position_stream;
+    // Non-blocking X11 requests, created on first use
+    pointer_lock::AsyncX11* x11;
 };
 
+// About one second of samples from a 1000 Hz mouse
+constexpr size_t kMotionHistoryCapacity = 1024;
+
 // Reusable functions
 
 GdkWindow* get_gdk_window(FlPluginRegistrar* registrar)
@@ -65,17 +84,261 @@ FlMethodResponse* no_pointer_error_response()
     return error_response("No pointer");
 }
 
-GdkPoint get_pointer_position_on_screen(GdkDisplay* gdk_display)
+// Returns the boolean stored under the given key in a method-call argument map, or the fallback if absent.
+bool lookup_bool_arg(FlValue* args, const char* key, bool fallback)
 {
-    GdkSeat* gdk_seat = gdk_display_get_default_seat(gdk_display);
-    GdkDevice* gdk_pointer = gdk_seat_get_pointer(gdk_seat);
-    if (!gdk_pointer)
+    if (!args || fl_value_get_type(args) != FL_VALUE_TYPE_MAP)
+    {
+        return fallback;
+    }
+    FlValue* value = fl_value_lookup_string(args, key);
+    if (!value || fl_value_get_type(value) != FL_VALUE_TYPE_BOOL)
+    {
+        return fallback;
+    }
+    return fl_value_get_bool(value);
+}
+
+// Returns the string stored under the given key in a method-call argument map, or the fallback if absent.
+const gchar* lookup_string_arg(FlValue* args, const char* key, const gchar* fallback)
+{
+    if (!args || fl_value_get_type(args) != FL_VALUE_TYPE_MAP)
+    {
+        return fallback;
+    }
+    FlValue* value = fl_value_lookup_string(args, key);
+    if (!value || fl_value_get_type(value) != FL_VALUE_TYPE_STRING)
+    {
+        return fallback;
+    }
+    return fl_value_get_string(value);
+}
+
+// Returns the number stored under the given key in a method-call argument map, or the fallback if absent.
+double lookup_double_arg(FlValue* args, const char* key, double fallback)
+{
+    if (!args || fl_value_get_type(args) != FL_VALUE_TYPE_MAP)
+    {
+        return fallback;
+    }
+    FlValue* value = fl_value_lookup_string(args, key);
+    if (!value)
+    {
+        return fallback;
+    }
+    switch (fl_value_get_type(value))
+    {
+    case FL_VALUE_TYPE_FLOAT:
+        return fl_value_get_float(value);
+    case FL_VALUE_TYPE_INT:
+        return static_cast<double>(fl_value_get_int(value));
+    default:
+        return fallback;
+    }
+}
+
+// Returns the map stored under the given key in a method-call argument map, or nullptr if absent.
+FlValue* lookup_map_arg(FlValue* args, const char* key)
+{
+    if (!args || fl_value_get_type(args) != FL_VALUE_TYPE_MAP)
+    {
+        return nullptr;
+    }
+    FlValue* value = fl_value_lookup_string(args, key);
+    if (!value || fl_value_get_type(value) != FL_VALUE_TYPE_MAP)
+    {
+        return nullptr;
+    }
+    return value;
+}
+
+// Reads the transform part of the session arguments (see `PointerLockTransform.toMap` in Dart).
+pointer_lock::TransformConfig transform_config_from_args(FlValue* args)
+{
+    pointer_lock::TransformConfig config;
+    FlValue* transform = lookup_map_arg(args, "transform");
+    if (!transform)
+    {
+        return config;
+    }
+    config.gain_x = lookup_double_arg(transform, "gainX", 1);
+    config.gain_y = lookup_double_arg(transform, "gainY", 1);
+    config.swap_axes = lookup_bool_arg(transform, "swapAxes", false);
+    config.invert_x = lookup_bool_arg(transform, "invertX", false);
+    config.invert_y = lookup_bool_arg(transform, "invertY", false);
+    config.quantize = lookup_bool_arg(transform, "quantize", false);
+    FlValue* curve = lookup_map_arg(transform, "curve");
+    if (!curve)
+    {
+        return config;
+    }
+    const gchar* type = lookup_string_arg(curve, "type", "none");
+    if (strcmp(type, "power") == 0)
+    {
+        config.curve.type = pointer_lock::AccelerationCurveType::kPower;
+        config.curve.coefficient = lookup_double_arg(curve, "coefficient", 0);
+        config.curve.exponent = lookup_double_arg(curve, "exponent", 1);
+        config.curve.max_factor = lookup_double_arg(curve, "maxFactor", config.curve.max_factor);
+    }
+    else if (strcmp(type, "piecewise") == 0)
+    {
+        config.curve.type = pointer_lock::AccelerationCurveType::kPiecewise;
+        // Flattened (speed, factor) pairs
+        FlValue* points = fl_value_lookup_string(curve, "points");
+        if (points && fl_value_get_type(points) == FL_VALUE_TYPE_FLOAT_LIST)
+        {
+            const double* values = fl_value_get_float_list(points);
+            const size_t length = fl_value_get_length(points);
+            for (size_t i = 0; i + 1 < length; i += 2)
+            {
+                config.curve.points.emplace_back(values[i], values[i + 1]);
+            }
+        }
+    }
+    return config;
+}
+
+// Reads the filter part of the session arguments (see `PointerLockFilter.toMap` in Dart).
+pointer_lock::FilterConfig filter_config_from_args(FlValue* args)
+{
+    pointer_lock::FilterConfig config;
+    FlValue* filter = lookup_map_arg(args, "filter");
+    if (!filter)
+    {
+        return config;
+    }
+    const gchar* type = lookup_string_arg(filter, "type", "none");
+    if (strcmp(type, "ema") == 0)
+    {
+        config.type = pointer_lock::FilterType::kEma;
+    }
+    else if (strcmp(type, "oneEuro") == 0)
+    {
+        config.type = pointer_lock::FilterType::kOneEuro;
+    }
+    config.alpha = lookup_double_arg(filter, "alpha", config.alpha);
+    config.min_cutoff = lookup_double_arg(filter, "minCutoff", config.min_cutoff);
+    config.beta = lookup_double_arg(filter, "beta", config.beta);
+    config.derivative_cutoff = lookup_double_arg(filter, "derivativeCutoff", config.derivative_cutoff);
+    return config;
+}
+
+// Reads the prediction part of the session arguments (see `PointerLockPrediction.toMap` in Dart).
+pointer_lock::PredictionConfig prediction_config_from_args(FlValue* args)
+{
+    pointer_lock::PredictionConfig config;
+    FlValue* prediction = lookup_map_arg(args, "prediction");
+    if (!prediction)
+    {
+        return config;
+    }
+    const gchar* model = lookup_string_arg(prediction, "model", "none");
+    if (strcmp(model, "linear") == 0)
+    {
+        config.model = pointer_lock::PredictionModel::kLinear;
+    }
+    else if (strcmp(model, "constantAcceleration") == 0)
+    {
+        config.model = pointer_lock::PredictionModel::kConstantAcceleration;
+    }
+    config.window = static_cast<size_t>(std::max(lookup_double_arg(prediction, "window", 8), 2.0));
+    config.max_horizon_us = static_cast<int64_t>(lookup_double_arg(prediction, "maxHorizonUs", 50000));
+    config.max_distance = lookup_double_arg(prediction, "maxDistance", config.max_distance);
+    return config;
+}
+
+// Reads the value-mode part of the session arguments (see `PointerLockValueMode.toMap` in Dart).
+pointer_lock::ValueConfig value_config_from_args(FlValue* args)
+{
+    pointer_lock::ValueConfig config;
+    FlValue* value_mode = lookup_map_arg(args, "valueMode");
+    if (!value_mode)
+    {
+        return config;
+    }
+    config.enabled = true;
+    config.start = lookup_double_arg(value_mode, "start", config.start);
+    config.min = lookup_double_arg(value_mode, "min", config.min);
+    config.max = lookup_double_arg(value_mode, "max", config.max);
+    config.pixels_per_range = lookup_double_arg(value_mode, "pixelsPerRange", config.pixels_per_range);
+    config.step = lookup_double_arg(value_mode, "step", config.step);
+    config.fine_modifiers = static_cast<int>(lookup_double_arg(value_mode, "fineModifiers", config.fine_modifiers));
+    config.fine_factor = lookup_double_arg(value_mode, "fineFactor", config.fine_factor);
+    config.wrap = lookup_bool_arg(value_mode, "wrap", config.wrap);
+    const gchar* axis = lookup_string_arg(value_mode, "axis", "vertical");
+    if (strcmp(axis, "horizontal") == 0)
+    {
+        config.axis = pointer_lock::ValueAxis::kHorizontal;
+    }
+    else if (strcmp(axis, "both") == 0)
+    {
+        config.axis = pointer_lock::ValueAxis::kBoth;
+    }
+    return config;
+}
+
+// Reads the virtual-cursor part of the session arguments (see `PointerLockVirtualCursor.toMap` in Dart).
+pointer_lock::CursorConfig cursor_config_from_args(FlValue* args)
+{
+    pointer_lock::CursorConfig config;
+    FlValue* cursor = lookup_map_arg(args, "virtualCursor");
+    if (!cursor)
+    {
+        return config;
+    }
+    config.enabled = true;
+    config.start_x = lookup_double_arg(cursor, "startX", 0);
+    config.start_y = lookup_double_arg(cursor, "startY", 0);
+    config.left = lookup_double_arg(cursor, "left", 0);
+    config.top = lookup_double_arg(cursor, "top", 0);
+    config.right = lookup_double_arg(cursor, "right", 0);
+    config.bottom = lookup_double_arg(cursor, "bottom", 0);
+    config.wrap = lookup_bool_arg(cursor, "wrap", false);
+    return config;
+}
+
+// Reads the confinement part of the session arguments. The rectangle is rounded inwards, so the pointer never
+// leaves it.
+pointer_lock::ConfineConfig confine_config_from_args(FlValue* args)
+{
+    pointer_lock::ConfineConfig config;
+    FlValue* confine = lookup_map_arg(args, "confine");
+    if (!confine)
+    {
+        return config;
+    }
+    config.enabled = true;
+    config.left = static_cast<int>(std::ceil(lookup_double_arg(confine, "left", 0)));
+    config.top = static_cast<int>(std::ceil(lookup_double_arg(confine, "top", 0)));
+    config.right = static_cast<int>(std::floor(lookup_double_arg(confine, "right", 0)));
+    config.bottom = static_cast<int>(std::floor(lookup_double_arg(confine, "bottom", 0)));
+    return config;
+}
+
+// Reads a delivery policy name (see `PointerLockDeliveryPolicy` in Dart).
+pointer_lock::DeliveryPolicy delivery_policy_from_args(FlValue* args)
+{
+    const gchar* name = lookup_string_arg(args, "deliveryPolicy", "everySample");
+    if (strcmp(name, "frameSum") == 0)
+    {
+        return pointer_lock::DeliveryPolicy::kFrameSum;
+    }
+    if (strcmp(name, "latestOnly") == 0)
     {
-        return {0, 0};
+        return pointer_lock::DeliveryPolicy::kLatestOnly;
     }
-    int x, y;
-    gdk_device_get_position(gdk_pointer, nullptr, &x, &y);
-    return {x, y};
+    return pointer_lock::DeliveryPolicy::kEverySample;
+}
+
+// Returns the helper for non-blocking X11 requests, or nullptr if GDK's blocking functions must be used (e.g. on
+// Wayland).
+pointer_lock::AsyncX11* async_x11(PointerLockPlugin* plugin, GdkDisplay* gdk_display)
+{
+    if (!plugin->x11)
+    {
+        plugin->x11 = new pointer_lock::AsyncX11(gdk_display);
+    }
+    return plugin->x11->available() ? plugin->x11 : nullptr;
 }
 
 // End reusable functions
@@ -88,12 +351,18 @@ static void pointer_lock_plugin_handle_method_call(
 {
     g_autoptr(FlMethodResponse) response = nullptr;
 
+    if (handle_method_call_async(self, method_call))
+    {
+        return;
+    }
+
     const gchar* method = fl_method_call_get_name(method_call);
 
     if (strcmp(method, "flutterRestart") == 0)
     {
-        set_pointer_visible(self, true);
-        set_pointer_locked(self, false);
+        stop_native_session(self);
+        g_object_unref(set_pointer_visible(self, true));
+        g_object_unref(set_pointer_locked(self, false));
         response = success_response();
     }
     else if (strcmp(method, "hidePointer") == 0)
@@ -120,6 +389,26 @@ static void pointer_lock_plugin_handle_method_call(
     {
         response = pointer_position_on_screen(self);
     }
+    else if (strcmp(method, "pointingDevices") == 0)
+    {
+        response = pointing_devices(self);
+    }
+    else if (strcmp(method, "motionHistory") == 0)
+    {
+        response = motion_history(self, fl_method_call_get_args(method_call));
+    }
+    else if (strcmp(method, "addSubscription") == 0)
+    {
+        response = add_subscription(self, fl_method_call_get_args(method_call));
+    }
+    else if (strcmp(method, "removeSubscription") == 0)
+    {
+        response = remove_subscription(self, fl_method_call_get_args(method_call));
+    }
+    else if (strcmp(method, "updateSession") == 0)
+    {
+        response = update_session(self, fl_method_call_get_args(method_call));
+    }
     else
     {
         response = FL_METHOD_RESPONSE(fl_method_not_implemented_response_new());
@@ -140,6 +429,120 @@ FlMethodResponse* pointer_position_on_screen(const PointerLockPlugin* plugin)
     return point_response(pos.x, pos.y);
 }
 
+static const gchar* input_source_name(GdkInputSource source)
+{
+    switch (source)
+    {
+    case GDK_SOURCE_MOUSE:
+        return "mouse";
+    case GDK_SOURCE_PEN:
+    case GDK_SOURCE_ERASER:
+        return "pen";
+    case GDK_SOURCE_TOUCHSCREEN:
+        return "touchscreen";
+    case GDK_SOURCE_TOUCHPAD:
+        return "touchpad";
+    case GDK_SOURCE_TRACKPOINT:
+        return "trackpoint";
+    default:
+        return "other";
+    }
+}
+
+FlMethodResponse* motion_history(const PointerLockPlugin* plugin, FlValue* args)
+{
+    const auto window_us = static_cast<int64_t>(lookup_double_arg(args, "windowUs", 0));
+    std::vector<double> encoded;
+    plugin->motion_history->encode_since(g_get_monotonic_time() - window_us, encoded);
+    g_autoptr(FlValue) result = fl_value_new_float_list(encoded.data(), encoded.size());
+    return FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+}
+
+// Lets another subscription share the session of the "pointer_lock_session" event channel.
+FlMethodResponse* add_subscription(PointerLockPlugin* plugin, FlValue* args)
+{
+    if (!plugin->native_session)
+    {
+        return error_response("No session");
+    }
+    const auto id = static_cast<int64_t>(lookup_double_arg(args, "subscriptionId", 0));
+    plugin->native_session->add_subscription(id, delivery_policy_from_args(args));
+    return success_response();
+}
+
+// Changes parameters of the session of the "pointer_lock_session" event channel without relocking. Parameters which
+// aren't passed keep their values.
+FlMethodResponse* update_session(PointerLockPlugin* plugin, FlValue* args)
+{
+    if (!plugin->native_session)
+    {
+        return error_response("No session");
+    }
+    pointer_lock::SessionConfig config = plugin->native_session->config();
+    config.unlock_on_pointer_up = lookup_bool_arg(args, "unlockOnPointerUp", config.unlock_on_pointer_up);
+    if (lookup_map_arg(args, "transform"))
+    {
+        config.transform = transform_config_from_args(args);
+    }
+    if (lookup_map_arg(args, "filter"))
+    {
+        config.filter = filter_config_from_args(args);
+    }
+    if (lookup_map_arg(args, "valueMode"))
+    {
+        config.value = value_config_from_args(args);
+    }
+    plugin->native_session->reconfigure(config);
+    if (lookup_string_arg(args, "deliveryPolicy", nullptr))
+    {
+        const auto id = static_cast<int64_t>(lookup_double_arg(args, "subscriptionId", 0));
+        if (!plugin->native_session->set_subscription_policy(id, delivery_policy_from_args(args)))
+        {
+            return error_response("No subscription");
+        }
+    }
+    return success_response();
+}
+
+FlMethodResponse* remove_subscription(PointerLockPlugin* plugin, FlValue* args)
+{
+    // The session might have ended already, which is fine.
+    if (plugin->native_session)
+    {
+        const auto id = static_cast<int64_t>(lookup_double_arg(args, "subscriptionId", 0));
+        plugin->native_session->remove_subscription(id);
+    }
+    return success_response();
+}
+
+FlMethodResponse* pointing_devices(const PointerLockPlugin* plugin)
+{
+    GdkWindow* gdk_window = get_gdk_window(plugin->registrar);
+    if (!gdk_window)
+    {
+        return no_window_error_response();
+    }
+    GdkSeat* gdk_seat = gdk_display_get_default_seat(gdk_window_get_display(gdk_window));
+    GList* gdk_devices = gdk_seat_get_slaves(gdk_seat, GDK_SEAT_CAPABILITY_ALL_POINTING);
+    g_autoptr(FlValue) result = fl_value_new_list();
+    for (GList* item = gdk_devices; item != nullptr; item = item->next)
+    {
+        auto* gdk_device = static_cast<GdkDevice*>(item->data);
+        const gchar* vendor_id = gdk_device_get_vendor_id(gdk_device);
+        const gchar* product_id = gdk_device_get_product_id(gdk_device);
+        FlValue* device = fl_value_new_map();
+        fl_value_set_string_take(device, "id", fl_value_new_int(pointing_device_id(gdk_device)));
+        fl_value_set_string_take(device, "name", fl_value_new_string(gdk_device_get_name(gdk_device)));
+        fl_value_set_string_take(device, "source",
+                                 fl_value_new_string(input_source_name(gdk_device_get_source(gdk_device))));
+        fl_value_set_string_take(device, "vendorId", fl_value_new_string(vendor_id ? vendor_id : ""));
+        fl_value_set_string_take(device, "productId", fl_value_new_string(product_id ? product_id : ""));
+        fl_value_append_take(result, device);
+    }
+    g_list_free(gdk_devices);
+    return FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+}
+
 FlMethodResponse* last_pointer_delta(const PointerLockPlugin* plugin)
 {
     GdkWindow* gdk_window = get_gdk_window(plugin->registrar);
@@ -159,6 +562,41 @@ FlMethodResponse* last_pointer_delta(const PointerLockPlugin* plugin)
                           new_pointer_pos.y - initial_y);
 }
 
+void apply_pointer_visible(PointerLockPlugin* plugin, GdkWindow* gdk_window, bool visible)
+{
+    plugin->cursor_visible = visible;
+    set_window_cursor_visible(gdk_window, visible);
+}
+
+static GdkEventMask locked_event_mask()
+{
+    return static_cast<GdkEventMask>(GDK_POINTER_MOTION_MASK | GDK_BUTTON_PRESS_MASK | GDK_BUTTON_RELEASE_MASK |
+        GDK_ENTER_NOTIFY_MASK | GDK_LEAVE_NOTIFY_MASK);
+}
+
+GdkGrabStatus apply_pointer_locked(PointerLockPlugin* plugin, GdkWindow* gdk_window, bool locked)
+{
+    if (!locked)
+    {
+        // Grabs made via AsyncX11 are unknown to GDK
+        pointer_lock::AsyncX11* x11 = async_x11(plugin, gdk_window_get_display(gdk_window));
+        if (x11)
+        {
+            x11->ungrab_pointer();
+        }
+        else
+        {
+            ungrab_pointer(gdk_window);
+        }
+        return GDK_GRAB_SUCCESS;
+    }
+    // Memorize initial pointer position
+    plugin->initial_pointer_pos = get_pointer_position_on_screen(gdk_window_get_display(gdk_window));
+    // Grab pointer. We warp asynchronously here: Mouse movement => Flutter Engine calls Dart code => Dart code
+    // requests last pointer delta => Native code warps. The native session (see pointer_lock_session.h) does better.
+    return grab_pointer(gdk_window, locked_event_mask());
+}
+
 FlMethodResponse* set_pointer_visible(PointerLockPlugin* plugin, bool visible)
 {
     GdkWindow* gdk_window = get_gdk_window(plugin->registrar);
@@ -166,69 +604,258 @@ FlMethodResponse* set_pointer_visible(PointerLockPlugin* plugin, bool visible)
     {
         return no_window_error_response();
     }
-    plugin->cursor_visible = visible;
-    if (visible)
+    apply_pointer_visible(plugin, gdk_window, visible);
+    return success_response();
+}
+
+FlMethodResponse* set_pointer_locked(PointerLockPlugin* plugin, bool locked)
+{
+    GdkWindow* gdk_window = get_gdk_window(plugin->registrar);
+    if (!gdk_window)
     {
-        gdk_window_set_cursor(gdk_window, nullptr);
+        return no_window_error_response();
     }
-    else
+    if (apply_pointer_locked(plugin, gdk_window, locked) != GDK_GRAB_SUCCESS)
     {
-        GdkDisplay* gdk_display = gdk_window_get_display(gdk_window);
-        GdkCursor* gdk_cursor = gdk_cursor_new_for_display(gdk_display, GDK_BLANK_CURSOR);
-        gdk_window_set_cursor(gdk_window, gdk_cursor);
-        g_object_unref(gdk_cursor);
+        return error_response("gdk_seat_grab failed");
     }
     return success_response();
 }
 
-FlMethodResponse* set_pointer_locked(PointerLockPlugin* plugin, bool locked)
+// A method call which is answered once the X server has replied. Keeps the plugin alive until then.
+struct PendingMethodCall
+{
+    PointerLockPlugin* plugin;
+    FlMethodCall* method_call;
+};
+
+static PendingMethodCall* pending_method_call_new(PointerLockPlugin* plugin, FlMethodCall* method_call)
+{
+    auto* pending = new PendingMethodCall();
+    pending->plugin = POINTER_LOCK_PLUGIN(g_object_ref(plugin));
+    pending->method_call = FL_METHOD_CALL(g_object_ref(method_call));
+    return pending;
+}
+
+static void pending_method_call_respond(PendingMethodCall* pending, FlMethodResponse* response)
+{
+    fl_method_call_respond(pending->method_call, response, nullptr);
+    g_object_unref(response);
+    g_object_unref(pending->method_call);
+    g_object_unref(pending->plugin);
+    delete pending;
+}
+
+static void pointer_position_reply_cb(bool ok, int x, int y, gpointer user_data)
+{
+    auto* pending = static_cast<PendingMethodCall*>(user_data);
+    pending_method_call_respond(pending, ok ? point_response(x, y) : no_pointer_error_response());
+}
+
+static void last_pointer_delta_reply_cb(bool ok, int x, int y, gpointer user_data)
+{
+    auto* pending = static_cast<PendingMethodCall*>(user_data);
+    if (!ok)
+    {
+        pending_method_call_respond(pending, no_pointer_error_response());
+        return;
+    }
+    const GdkPoint initial = pending->plugin->initial_pointer_pos;
+    pending->plugin->x11->warp_pointer(initial.x, initial.y);
+    pending_method_call_respond(pending, point_response(x - initial.x, y - initial.y));
+}
+
+static void initial_pointer_position_reply_cb(bool ok, int x, int y, gpointer user_data)
+{
+    auto* pending = static_cast<PendingMethodCall*>(user_data);
+    if (ok)
+    {
+        pending->plugin->initial_pointer_pos.x = x;
+        pending->plugin->initial_pointer_pos.y = y;
+    }
+}
+
+static void lock_reply_cb(GdkGrabStatus status, gpointer user_data)
+{
+    auto* pending = static_cast<PendingMethodCall*>(user_data);
+    if (status != GDK_GRAB_SUCCESS)
+    {
+        pending_method_call_respond(pending, error_response("gdk_seat_grab failed"));
+        return;
+    }
+    pending_method_call_respond(pending, success_response());
+}
+
+// Issues the requests of apply_pointer_locked() without waiting for the replies.
+static void lock_pointer_async(pointer_lock::AsyncX11* x11, GdkWindow* gdk_window, PendingMethodCall* pending)
+{
+    // Replies come in request order, so the initial position is known when the grab reply arrives.
+    x11->query_pointer(initial_pointer_position_reply_cb, pending);
+    // Same as grab_pointer()
+    GdkCursor* gdk_cursor = gdk_cursor_new_for_display(gdk_window_get_display(gdk_window), GDK_BLANK_CURSOR);
+    x11->grab_pointer(gdk_window, true, locked_event_mask(), gdk_cursor, gdk_window, lock_reply_cb, pending);
+    g_object_unref(gdk_cursor);
+}
+
+// Handles the method calls which would otherwise block on a round trip to the X server, answering them once the
+// server has replied. Returns false if the method call must be handled synchronously.
+bool handle_method_call_async(PointerLockPlugin* plugin, FlMethodCall* method_call)
 {
     GdkWindow* gdk_window = get_gdk_window(plugin->registrar);
     if (!gdk_window)
     {
-        return no_window_error_response();
+        return false;
     }
-    GdkDisplay* gdk_display = gdk_window_get_display(gdk_window);
-    GdkSeat* gdk_seat = gdk_display_get_default_seat(gdk_display);
-    if (locked)
-    {
-        // Memorize initial pointer position
-        plugin->initial_pointer_pos = get_pointer_position_on_screen(gdk_display);
-        // Grab pointer
-        gdk_seat_ungrab(gdk_seat);
-        // Always use blank cursor! Otherwise, the warping won't work (at least not on Wayland).
-        GdkCursor* gdk_cursor = gdk_cursor_new_for_display(gdk_display, GDK_BLANK_CURSOR);
-        // gdk_seat_grab is the replacement of the deprecated gdk_pointer_grab, but unfortunately it doesn't allow
-        // confining the cursor to the window. Very fast mouse movements will make the cursor end up outside the window,
-        // and then warping to the original position is not possible anymore (at least on Wayland). This could
-        // maybe be avoided by *synchronously* warping on pointer move events. At the moment we warp asynchronously:
-        // Mouse movement => Native code calls Dart code => Dart code requests last pointer delta => Native code warps.
-        // I don't know how to get synchronously informed of mouse events on the native side without hacking the
-        // Flutter Engine.
-        // GdkGrabStatus result = gdk_seat_grab(gdk_seat, gdk_window, GDK_SEAT_CAPABILITY_ALL_POINTING, TRUE, gdk_cursor, nullptr, nullptr, nullptr);
-        auto gdk_event_mask = static_cast<GdkEventMask>(GDK_POINTER_MOTION_MASK | GDK_BUTTON_PRESS_MASK |
-            GDK_BUTTON_RELEASE_MASK | GDK_ENTER_NOTIFY_MASK | GDK_LEAVE_NOTIFY_MASK);
-        // Use deprecated gdk_pointer_grab in order to confine to a window.
-#pragma GCC diagnostic push
-#pragma GCC diagnostic ignored "-Wdeprecated-declarations"
-        GdkGrabStatus result = gdk_pointer_grab(gdk_window, TRUE, gdk_event_mask, gdk_window, gdk_cursor,
-                                                GDK_CURRENT_TIME);
-#pragma GCC diagnostic pop
-        g_object_unref(gdk_cursor);
-        if (result != GDK_GRAB_SUCCESS)
-        {
-            return error_response("gdk_seat_grab failed");
-        }
+    pointer_lock::AsyncX11* x11 = async_x11(plugin, gdk_window_get_display(gdk_window));
+    if (!x11)
+    {
+        return false;
     }
-    else
+    const gchar* method = fl_method_call_get_name(method_call);
+    if (strcmp(method, "pointerPositionOnScreen") == 0)
     {
-        gdk_seat_ungrab(gdk_seat);
+        x11->query_pointer(pointer_position_reply_cb, pending_method_call_new(plugin, method_call));
+        return true;
     }
-    return success_response();
+    if (strcmp(method, "lastPointerDelta") == 0)
+    {
+        x11->query_pointer(last_pointer_delta_reply_cb, pending_method_call_new(plugin, method_call));
+        return true;
+    }
+    if (strcmp(method, "lockPointer") == 0)
+    {
+        lock_pointer_async(x11, gdk_window, pending_method_call_new(plugin, method_call));
+        return true;
+    }
+    return false;
+}
+
+void stop_native_session(PointerLockPlugin* plugin)
+{
+    delete plugin->native_session;
+    plugin->native_session = nullptr;
+}
+
+static void native_session_batch_cb(const double* values, size_t length, gpointer user_data)
+{
+    PointerLockPlugin* plugin = POINTER_LOCK_PLUGIN(user_data);
+    g_autoptr(FlValue) event = fl_value_new_float_list(values, length);
+    fl_event_channel_send(plugin->session_event_channel, event, nullptr, nullptr);
+}
+
+static void native_session_end_cb(gpointer user_data)
+{
+    PointerLockPlugin* plugin = POINTER_LOCK_PLUGIN(user_data);
+    // The session has already undone everything. Dart will cancel the stream in response, which disposes it.
+    fl_event_channel_send_end_of_stream(plugin->session_event_channel, nullptr, nullptr);
+}
+
+static void native_session_started_cb(GdkGrabStatus status, gpointer user_data)
+{
+    PointerLockPlugin* plugin = POINTER_LOCK_PLUGIN(user_data);
+    if (status != GDK_GRAB_SUCCESS)
+    {
+        // The stream has been listened to already, so the failure arrives as an error event. The session stays
+        // inactive until Dart cancels the stream.
+        fl_event_channel_send_error(plugin->session_event_channel, "gdk_seat_grab failed", nullptr, nullptr, nullptr,
+                                    nullptr);
+    }
+}
+
+static FlMethodErrorResponse* native_session_listen_cb(FlEventChannel* channel, FlValue* args, gpointer user_data)
+{
+    PointerLockPlugin* plugin = POINTER_LOCK_PLUGIN(user_data);
+    stop_native_session(plugin);
+    FlView* fl_view = fl_plugin_registrar_get_view(plugin->registrar);
+    if (!fl_view)
+    {
+        return fl_method_error_response_new("No window", nullptr, nullptr);
+    }
+    pointer_lock::SessionConfig config;
+    config.hide_cursor = strcmp(lookup_string_arg(args, "cursor", "hidden"), "hidden") == 0;
+    config.unlock_on_pointer_up = lookup_bool_arg(args, "unlockOnPointerUp", false);
+    config.button_and_scroll_events = lookup_bool_arg(args, "buttonAndScrollEvents", true);
+    config.transform = transform_config_from_args(args);
+    config.filter = filter_config_from_args(args);
+    config.velocity_window = static_cast<size_t>(std::max(lookup_double_arg(args, "velocityWindow", 0), 0.0));
+    config.prediction = prediction_config_from_args(args);
+    config.value = value_config_from_args(args);
+    config.cursor = cursor_config_from_args(args);
+    config.confine = confine_config_from_args(args);
+    config.history = plugin->motion_history;
+    plugin->native_session = new pointer_lock::Session(GTK_WIDGET(fl_view), config, native_session_batch_cb,
+                                                       native_session_end_cb, plugin);
+    // The listener is the first subscription. Further ones are added via "addSubscription".
+    plugin->native_session->add_subscription(static_cast<int64_t>(lookup_double_arg(args, "subscriptionId", 0)),
+                                             delivery_policy_from_args(args));
+    pointer_lock::AsyncX11* x11 = async_x11(plugin, gtk_widget_get_display(GTK_WIDGET(fl_view)));
+    if (x11)
+    {
+        plugin->native_session->start_async(x11, native_session_started_cb);
+        return nullptr;
+    }
+    if (plugin->native_session->start() != GDK_GRAB_SUCCESS)
+    {
+        stop_native_session(plugin);
+        return fl_method_error_response_new("gdk_seat_grab failed", nullptr, nullptr);
+    }
+    return nullptr;
+}
+
+static FlMethodErrorResponse* native_session_cancel_cb(FlEventChannel* channel, FlValue* args, gpointer user_data)
+{
+    PointerLockPlugin* plugin = POINTER_LOCK_PLUGIN(user_data);
+    stop_native_session(plugin);
+    return nullptr;
+}
+
+static void stop_position_stream(PointerLockPlugin* plugin)
+{
+    delete plugin->position_stream;
+    plugin->position_stream = nullptr;
+}
+
+static void position_stream_cb(double x, double y, int64_t timestamp_us, int motion_count, gpointer user_data)
+{
+    PointerLockPlugin* plugin = POINTER_LOCK_PLUGIN(user_data);
+    const double values[] = {x, y, static_cast<double>(timestamp_us), static_cast<double>(motion_count)};
+    g_autoptr(FlValue) event = fl_value_new_float_list(values, G_N_ELEMENTS(values));
+    fl_event_channel_send(plugin->position_event_channel, event, nullptr, nullptr);
+}
+
+static FlMethodErrorResponse* position_stream_listen_cb(FlEventChannel* channel, FlValue* args, gpointer user_data)
+{
+    PointerLockPlugin* plugin = POINTER_LOCK_PLUGIN(user_data);
+    stop_position_stream(plugin);
+    GdkWindow* gdk_window = get_gdk_window(plugin->registrar);
+    if (!gdk_window)
+    {
+        return fl_method_error_response_new("No window", nullptr, nullptr);
+    }
+    pointer_lock::AsyncX11* x11 = async_x11(plugin, gdk_window_get_display(gdk_window));
+    plugin->position_stream = new pointer_lock::PositionStream(gdk_window, x11, position_stream_cb, plugin);
+    plugin->position_stream->start();
+    return nullptr;
+}
+
+static FlMethodErrorResponse* position_stream_cancel_cb(FlEventChannel* channel, FlValue* args, gpointer user_data)
+{
+    PointerLockPlugin* plugin = POINTER_LOCK_PLUGIN(user_data);
+    stop_position_stream(plugin);
+    return nullptr;
 }
 
 static void pointer_lock_plugin_dispose(GObject* object)
 {
+    PointerLockPlugin* self = POINTER_LOCK_PLUGIN(object);
+    stop_native_session(self);
+    g_clear_object(&self->session_event_channel);
+    stop_position_stream(self);
+    g_clear_object(&self->position_event_channel);
+    delete self->x11;
+    self->x11 = nullptr;
+    delete self->motion_history;
+    self->motion_history = nullptr;
     G_OBJECT_CLASS(pointer_lock_plugin_parent_class)->dispose(object);
 }
 
@@ -242,6 +869,12 @@ static void pointer_lock_plugin_init(PointerLockPlugin* self)
     self->cursor_visible = true;
     self->initial_pointer_pos.x = 0;
     self->initial_pointer_pos.y = 0;
+    self->session_event_channel = nullptr;
+    self->native_session = nullptr;
+    self->motion_history = new pointer_lock::MotionHistory(kMotionHistoryCapacity);
+    self->position_event_channel = nullptr;
+    self->position_stream = nullptr;
+    self->x11 = nullptr;
 }
 
 static void method_call_cb(FlMethodChannel* channel, FlMethodCall* method_call,
@@ -268,6 +901,26 @@ void pointer_lock_plugin_register_with_registrar(FlPluginRegistrar* registrar)
     fl_method_channel_set_method_call_handler(method_channel, method_call_cb,
                                               g_object_ref(plugin),
                                               g_object_unref);
+    // Set up session event channel. The plugin owns the channel, so the handlers don't keep a reference.
+    plugin->session_event_channel =
+        fl_event_channel_new(messenger,
+                             "pointer_lock_session",
+                             FL_METHOD_CODEC(codec));
+    fl_event_channel_set_stream_handlers(plugin->session_event_channel,
+                                         native_session_listen_cb,
+                                         native_session_cancel_cb,
+                                         plugin,
+                                         nullptr);
+    // Set up position event channel
+    plugin->position_event_channel =
+        fl_event_channel_new(messenger,
+                             "pointer_lock_position",
+                             FL_METHOD_CODEC(codec));
+    fl_event_channel_set_stream_handlers(plugin->position_event_channel,
+                                         position_stream_listen_cb,
+                                         position_stream_cancel_cb,
+                                         plugin,
+                                         nullptr);
 
     g_object_unref(plugin);
 }
@@ -8,5 +8,12 @@
 
 FlMethodResponse* pointer_position_on_screen(const PointerLockPlugin* plugin);
 FlMethodResponse* last_pointer_delta(const PointerLockPlugin* plugin);
+FlMethodResponse* pointing_devices(const PointerLockPlugin* plugin);
+FlMethodResponse* motion_history(const PointerLockPlugin* plugin, FlValue* args);
+FlMethodResponse* add_subscription(PointerLockPlugin* plugin, FlValue* args);
+FlMethodResponse* remove_subscription(PointerLockPlugin* plugin, FlValue* args);
+FlMethodResponse* update_session(PointerLockPlugin* plugin, FlValue* args);
 FlMethodResponse* set_pointer_visible(PointerLockPlugin* plugin, bool visible);
-FlMethodResponse* set_pointer_locked(PointerLockPlugin* plugin, bool locked);
\ No newline at end of file
+FlMethodResponse* set_pointer_locked(PointerLockPlugin* plugin, bool locked);
+void stop_native_session(PointerLockPlugin* plugin);
+bool handle_method_call_async(PointerLockPlugin* plugin, FlMethodCall* method_call);
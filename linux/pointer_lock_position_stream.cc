@@ -0,0 +1,207 @@
+#include "pointer_lock_position_stream.h"
+
+#include <gdk/gdkx.h>
+
+#ifdef POINTER_LOCK_HAVE_XI2
+#include <X11/extensions/XInput2.h>
+#endif
+
+#include "pointer_lock_session.h"
+
+namespace pointer_lock
+{
+
+PositionStream::PositionStream(GdkWindow* window, AsyncX11* x11, PositionCallback on_position, gpointer user_data)
+    : window_(window), x11_(x11), on_position_(on_position), user_data_(user_data)
+{
+}
+
+PositionStream::~PositionStream()
+{
+    stop();
+}
+
+void PositionStream::start()
+{
+    if (active_)
+    {
+        return;
+    }
+    frame_clock_ = gdk_window_get_frame_clock(window_);
+    if (!frame_clock_)
+    {
+        return;
+    }
+    g_object_ref(frame_clock_);
+    active_ = true;
+    has_reported_ = false;
+    motion_count_ = 0;
+    update_handler_ = g_signal_connect(frame_clock_, "update", G_CALLBACK(update_cb), this);
+    event_driven_ = select_raw_motion(true);
+    if (event_driven_)
+    {
+        gdk_window_add_filter(nullptr, event_filter_cb, this);
+        // Report the initial position
+        report_requested_ = true;
+        gdk_frame_clock_request_phase(frame_clock_, GDK_FRAME_CLOCK_PHASE_UPDATE);
+    }
+    else
+    {
+        // Keeps the frame clock ticking, so we can poll on each frame
+        gdk_frame_clock_begin_updating(frame_clock_);
+    }
+}
+
+void PositionStream::stop()
+{
+    if (!active_)
+    {
+        return;
+    }
+    active_ = false;
+    if (query_pending_)
+    {
+        x11_->cancel(this);
+        query_pending_ = false;
+    }
+    if (event_driven_)
+    {
+        gdk_window_remove_filter(nullptr, event_filter_cb, this);
+        select_raw_motion(false);
+    }
+    else
+    {
+        gdk_frame_clock_end_updating(frame_clock_);
+    }
+    g_signal_handler_disconnect(frame_clock_, update_handler_);
+    update_handler_ = 0;
+    g_clear_object(&frame_clock_);
+}
+
+// Selects (or deselects) XInput 2 raw motion events on the root window. Unlike regular motion events, they are
+// delivered no matter which window the pointer is over. Returns whether this is supported.
+bool PositionStream::select_raw_motion(bool enabled)
+{
+#ifdef POINTER_LOCK_HAVE_XI2
+    GdkDisplay* gdk_display = gdk_window_get_display(window_);
+    if (!GDK_IS_X11_DISPLAY(gdk_display))
+    {
+        return false;
+    }
+    Display* x_display = GDK_DISPLAY_XDISPLAY(gdk_display);
+    int event_base, error_base;
+    if (!XQueryExtension(x_display, "XInputExtension", &xi_opcode_, &event_base, &error_base))
+    {
+        return false;
+    }
+    // Since 2.1, raw events are delivered even while another client grabs the pointer.
+    int major = 2, minor = 2;
+    if (XIQueryVersion(x_display, &major, &minor) != Success)
+    {
+        return false;
+    }
+    unsigned char mask_bits[XIMaskLen(XI_LASTEVENT)] = {0};
+    if (enabled)
+    {
+        XISetMask(mask_bits, XI_RawMotion);
+    }
+    // GDK selects its own events on the root window for XIAllDevices. Selections are per device ID, so using
+    // XIAllMasterDevices here doesn't replace them.
+    XIEventMask mask;
+    mask.deviceid = XIAllMasterDevices;
+    mask.mask_len = sizeof(mask_bits);
+    mask.mask = mask_bits;
+    XISelectEvents(x_display, DefaultRootWindow(x_display), &mask, 1);
+    return true;
+#else
+    (void) enabled;
+    return false;
+#endif
+}
+
+GdkFilterReturn PositionStream::event_filter_cb(GdkXEvent* xevent, GdkEvent* event, gpointer user_data)
+{
+#ifdef POINTER_LOCK_HAVE_XI2
+    auto* self = static_cast<PositionStream*>(user_data);
+    auto* x_event = static_cast<XEvent*>(xevent);
+    if (x_event->type == GenericEvent && x_event->xcookie.extension == self->xi_opcode_ &&
+        x_event->xcookie.evtype == XI_RawMotion)
+    {
+        self->handle_motion();
+    }
+#else
+    (void) xevent;
+    (void) user_data;
+#endif
+    (void) event;
+    // GDK ignores raw events, but other filters might be interested
+    return GDK_FILTER_CONTINUE;
+}
+
+void PositionStream::handle_motion()
+{
+    if (motion_count_ == 0 && !report_requested_)
+    {
+        // Coalesce everything until the next frame
+        gdk_frame_clock_request_phase(frame_clock_, GDK_FRAME_CLOCK_PHASE_UPDATE);
+    }
+    motion_count_++;
+}
+
+void PositionStream::update_cb(GdkFrameClock* frame_clock, gpointer user_data)
+{
+    auto* self = static_cast<PositionStream*>(user_data);
+    // The frame clock also updates for other reasons (e.g. animations), nothing to do then if motion drives us.
+    if (self->event_driven_ && self->motion_count_ == 0 && !self->report_requested_)
+    {
+        return;
+    }
+    self->report();
+}
+
+void PositionStream::report()
+{
+    if (query_pending_)
+    {
+        // Motion since then is reported with the frame after the reply.
+        gdk_frame_clock_request_phase(frame_clock_, GDK_FRAME_CLOCK_PHASE_UPDATE);
+        return;
+    }
+    const int motion_count = motion_count_;
+    const bool forced = report_requested_;
+    motion_count_ = 0;
+    report_requested_ = false;
+    if (x11_)
+    {
+        query_pending_ = true;
+        queried_motion_count_ = motion_count;
+        query_forced_ = forced;
+        x11_->query_pointer(position_reply_cb, this);
+        return;
+    }
+    deliver(get_pointer_position_on_screen(gdk_window_get_display(window_)), motion_count, forced);
+}
+
+void PositionStream::position_reply_cb(bool ok, int x, int y, gpointer user_data)
+{
+    auto* self = static_cast<PositionStream*>(user_data);
+    self->query_pending_ = false;
+    if (!ok)
+    {
+        return;
+    }
+    self->deliver({x, y}, self->queried_motion_count_, self->query_forced_);
+}
+
+void PositionStream::deliver(GdkPoint position, int motion_count, bool forced)
+{
+    if (!forced && has_reported_ && position.x == last_position_.x && position.y == last_position_.y)
+    {
+        return;
+    }
+    has_reported_ = true;
+    last_position_ = position;
+    on_position_(position.x, position.y, g_get_monotonic_time(), motion_count, user_data_);
+}
+
+}  // namespace pointer_lock
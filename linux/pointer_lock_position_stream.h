@@ -0,0 +1,89 @@
+#ifndef POINTER_LOCK_POSITION_STREAM_H_
+#define POINTER_LOCK_POSITION_STREAM_H_
+
+#include <gtk/gtk.h>
+
+#include <cstdint>
+
+#include "pointer_lock_x11_async.h"
+
+// This file contains the position stream, which reports the pointer position on screen while the pointer is not
+// locked. It doesn't depend on Flutter.
+
+namespace pointer_lock
+{
+
+// Samples the pointer position on screen once per frame of the given window while it changes, also while the
+// pointer is outside of the window. Positions the pointer passes between two frames aren't reported, the number of
+// motion events in between is.
+//
+// On X11 with XInput 2, raw motion events of the whole screen wake the stream up, so it doesn't do anything while
+// the pointer rests. Raw motion events don't carry the position, so it's queried with the next frame. On X11, the
+// query doesn't block (see AsyncX11), the position is reported once the X server has replied. Elsewhere (e.g. on
+// Wayland, where the global position isn't available anyway), the stream polls GDK's last known position once per
+// frame.
+class PositionStream
+{
+public:
+    // Called with the position in screen coordinates, the time in microseconds of the monotonic clock and the number
+    // of motion events coalesced into this report (zero when polling).
+    typedef void (*PositionCallback)(double x, double y, int64_t timestamp_us, int motion_count, gpointer user_data);
+
+    // If `x11` is given, the position is queried via it instead of GDK. It must outlive the stream.
+    PositionStream(GdkWindow* window, AsyncX11* x11, PositionCallback on_position, gpointer user_data);
+    ~PositionStream();
+
+    PositionStream(const PositionStream&) = delete;
+    PositionStream& operator=(const PositionStream&) = delete;
+
+    // Starts reporting. The current position is reported with the next frame.
+    void start();
+
+    // Stops reporting. Safe to call multiple times.
+    void stop();
+
+    bool active() const
+    {
+        return active_;
+    }
+
+    // Whether motion events drive the stream (as opposed to polling).
+    bool event_driven() const
+    {
+        return event_driven_;
+    }
+
+private:
+    static GdkFilterReturn event_filter_cb(GdkXEvent* xevent, GdkEvent* event, gpointer user_data);
+    static void update_cb(GdkFrameClock* frame_clock, gpointer user_data);
+    static void position_reply_cb(bool ok, int x, int y, gpointer user_data);
+
+    bool select_raw_motion(bool enabled);
+    void handle_motion();
+    void report();
+    void deliver(GdkPoint position, int motion_count, bool forced);
+
+    GdkWindow* window_;
+    AsyncX11* x11_;
+    PositionCallback on_position_;
+    gpointer user_data_;
+    GdkFrameClock* frame_clock_ = nullptr;
+    gulong update_handler_ = 0;
+    bool active_ = false;
+    bool event_driven_ = false;
+    int xi_opcode_ = 0;
+    // Motion events since the last report
+    int motion_count_ = 0;
+    // Whether to report with the next frame even without motion
+    bool report_requested_ = false;
+    // Whether a position query is waiting for the X server, and what it's going to report
+    bool query_pending_ = false;
+    int queried_motion_count_ = 0;
+    bool query_forced_ = false;
+    bool has_reported_ = false;
+    GdkPoint last_position_ = {0, 0};
+};
+
+}  // namespace pointer_lock
+
+#endif  // POINTER_LOCK_POSITION_STREAM_H_
@@ -0,0 +1,836 @@
+#include "pointer_lock_session.h"
+
+#include <gdk/gdkx.h>
+
+#include <algorithm>
+
+GdkPoint get_pointer_position_on_screen(GdkDisplay* gdk_display)
+{
+    GdkSeat* gdk_seat = gdk_display_get_default_seat(gdk_display);
+    GdkDevice* gdk_pointer = gdk_seat_get_pointer(gdk_seat);
+    if (!gdk_pointer)
+    {
+        return {0, 0};
+    }
+    int x, y;
+    gdk_device_get_position(gdk_pointer, nullptr, &x, &y);
+    return {x, y};
+}
+
+void set_window_cursor_visible(GdkWindow* gdk_window, bool visible)
+{
+    if (visible)
+    {
+        gdk_window_set_cursor(gdk_window, nullptr);
+    }
+    else
+    {
+        GdkDisplay* gdk_display = gdk_window_get_display(gdk_window);
+        GdkCursor* gdk_cursor = gdk_cursor_new_for_display(gdk_display, GDK_BLANK_CURSOR);
+        gdk_window_set_cursor(gdk_window, gdk_cursor);
+        g_object_unref(gdk_cursor);
+    }
+}
+
+GdkGrabStatus grab_pointer(GdkWindow* gdk_window, GdkEventMask gdk_event_mask)
+{
+    GdkDisplay* gdk_display = gdk_window_get_display(gdk_window);
+    GdkSeat* gdk_seat = gdk_display_get_default_seat(gdk_display);
+    gdk_seat_ungrab(gdk_seat);
+    // Always use blank cursor! Otherwise, the warping won't work (at least not on Wayland).
+    GdkCursor* gdk_cursor = gdk_cursor_new_for_display(gdk_display, GDK_BLANK_CURSOR);
+    // gdk_seat_grab is the replacement of the deprecated gdk_pointer_grab, but unfortunately it doesn't allow
+    // confining the cursor to the window. Very fast mouse movements will make the cursor end up outside the window,
+    // and then warping to the original position is not possible anymore (at least on Wayland).
+    // GdkGrabStatus result = gdk_seat_grab(gdk_seat, gdk_window, GDK_SEAT_CAPABILITY_ALL_POINTING, TRUE, gdk_cursor, nullptr, nullptr, nullptr);
+    // Use deprecated gdk_pointer_grab in order to confine to a window. GDK only confines core grabs though, it ignores
+    // confine_to when using XInput 2 (the default). AsyncX11::grab_pointer confines both kinds.
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wdeprecated-declarations"
+    GdkGrabStatus result = gdk_pointer_grab(gdk_window, TRUE, gdk_event_mask, gdk_window, gdk_cursor,
+                                            GDK_CURRENT_TIME);
+#pragma GCC diagnostic pop
+    g_object_unref(gdk_cursor);
+    return result;
+}
+
+// Grabs the pointer without changing the cursor, confining it to the given window. Events are reported to the
+// grabbing window, no matter which window the pointer is over.
+GdkGrabStatus grab_pointer_confined(GdkWindow* gdk_window, GdkEventMask gdk_event_mask, GdkWindow* confine_to)
+{
+    GdkDisplay* gdk_display = gdk_window_get_display(gdk_window);
+    gdk_seat_ungrab(gdk_display_get_default_seat(gdk_display));
+    // As above, gdk_seat_grab can't confine.
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wdeprecated-declarations"
+    return gdk_pointer_grab(gdk_window, FALSE, gdk_event_mask, confine_to, nullptr, GDK_CURRENT_TIME);
+#pragma GCC diagnostic pop
+}
+
+void ungrab_pointer(GdkWindow* gdk_window)
+{
+    GdkDisplay* gdk_display = gdk_window_get_display(gdk_window);
+    GdkSeat* gdk_seat = gdk_display_get_default_seat(gdk_display);
+    gdk_seat_ungrab(gdk_seat);
+}
+
+// Returns a small, stable ID for the given device, assigning one on first use.
+//
+// This works the same on all GDK backends. The ID is stored on the device object itself, so looking it up is cheap
+// enough to do for every event.
+int pointing_device_id(GdkDevice* gdk_device)
+{
+    static GQuark id_quark = g_quark_from_static_string("pointer-lock-device-id");
+    static int next_id = 1;
+    if (!gdk_device)
+    {
+        return 0;
+    }
+    gpointer existing_id = g_object_get_qdata(G_OBJECT(gdk_device), id_quark);
+    if (existing_id)
+    {
+        return GPOINTER_TO_INT(existing_id);
+    }
+    int id = next_id++;
+    g_object_set_qdata(G_OBJECT(gdk_device), id_quark, GINT_TO_POINTER(id));
+    return id;
+}
+
+namespace pointer_lock
+{
+
+// Translates GDK button numbers into Flutter's button constants (kPrimaryButton etc.).
+static int flutter_button_from_gdk(guint gdk_button)
+{
+    switch (gdk_button)
+    {
+    case GDK_BUTTON_PRIMARY:
+        return 0x01;
+    case GDK_BUTTON_SECONDARY:
+        return 0x02;
+    case GDK_BUTTON_MIDDLE:
+        return 0x04;
+    case 8:
+        return 0x08;
+    case 9:
+        return 0x10;
+    default:
+        return 0;
+    }
+}
+
+// Translates the button part of a GDK modifier state into a combination of Flutter's button constants.
+static int flutter_buttons_from_gdk(guint gdk_state)
+{
+    int buttons = 0;
+    if (gdk_state & GDK_BUTTON1_MASK)
+    {
+        buttons |= flutter_button_from_gdk(GDK_BUTTON_PRIMARY);
+    }
+    if (gdk_state & GDK_BUTTON2_MASK)
+    {
+        buttons |= flutter_button_from_gdk(GDK_BUTTON_MIDDLE);
+    }
+    if (gdk_state & GDK_BUTTON3_MASK)
+    {
+        buttons |= flutter_button_from_gdk(GDK_BUTTON_SECONDARY);
+    }
+    return buttons;
+}
+
+// Translates the keyboard part of a GDK modifier state (with virtual modifiers resolved) into Modifier bits.
+static int modifiers_from_gdk(guint gdk_state)
+{
+    int modifiers = 0;
+    if (gdk_state & GDK_SHIFT_MASK)
+    {
+        modifiers |= kShiftModifier;
+    }
+    if (gdk_state & GDK_CONTROL_MASK)
+    {
+        modifiers |= kControlModifier;
+    }
+    if (gdk_state & GDK_MOD1_MASK)
+    {
+        modifiers |= kAltModifier;
+    }
+    if (gdk_state & (GDK_SUPER_MASK | GDK_META_MASK))
+    {
+        modifiers |= kMetaModifier;
+    }
+    return modifiers;
+}
+
+// The columns of the optional features a session uses (see EventBatch).
+static uint32_t feature_columns(const SessionConfig& config)
+{
+    uint32_t columns = 0;
+    if (config.filter.type != FilterType::kNone)
+    {
+        columns |= column_bit(kFilteredDxColumn) | column_bit(kFilteredDyColumn);
+    }
+    if (config.velocity_window > 0)
+    {
+        columns |= column_bit(kVelocityXColumn) | column_bit(kVelocityYColumn) | column_bit(kAccelerationXColumn) |
+                   column_bit(kAccelerationYColumn);
+    }
+    if (config.prediction.model != PredictionModel::kNone)
+    {
+        columns |= column_bit(kPredictedDxColumn) | column_bit(kPredictedDyColumn) |
+                   column_bit(kPredictionConfidenceColumn);
+    }
+    if (config.value.enabled)
+    {
+        columns |= column_bit(kValueColumn);
+    }
+    if (config.cursor.enabled)
+    {
+        columns |= column_bit(kCursorXColumn) | column_bit(kCursorYColumn);
+    }
+    if (config.confine.enabled)
+    {
+        columns |= column_bit(kPositionXColumn) | column_bit(kPositionYColumn);
+    }
+    return columns;
+}
+
+Session::Session(GtkWidget* widget,
+                 const SessionConfig& config,
+                 BatchCallback on_batch,
+                 EndCallback on_end,
+                 gpointer user_data)
+    : widget_(widget),
+      config_(config),
+      on_batch_(on_batch),
+      on_end_(on_end),
+      user_data_(user_data)
+{
+    pipeline_.get<TransformStage>() = TransformStage(config.transform);
+    pipeline_.get<HistoryStage>().set_history(config.history);
+    pipeline_.get<CursorStage>() = CursorStage(config.cursor);
+    pipeline_.get<FilterStage>() = FilterStage(config.filter);
+    pipeline_.get<VelocityStage>() = VelocityStage(config.velocity_window);
+    pipeline_.get<PredictionStage>() = PredictionStage(config.prediction);
+    pipeline_.get<ValueStage>() = ValueStage(config.value);
+    fan_out_.set_columns(feature_columns(config));
+}
+
+Session::~Session()
+{
+    stop();
+}
+
+// Returns the given position, moved into the given area (on screen) and away from its edges by up to the given
+// margin if necessary. The pointer can't move beyond the edges of the area, so movement towards them would be cut
+// off before the pointer is warped back.
+static GdkPoint warp_target_within(GdkPoint pos, const GdkRectangle& area, int max_margin)
+{
+    if (area.width <= 0 || area.height <= 0)
+    {
+        return pos;
+    }
+    const int margin_x = std::min(max_margin, area.width / 4);
+    const int margin_y = std::min(max_margin, area.height / 4);
+    return {std::min(std::max(pos.x, area.x + margin_x), area.x + area.width - 1 - margin_x),
+            std::min(std::max(pos.y, area.y + margin_y), area.y + area.height - 1 - margin_y)};
+}
+
+// Returns where a locking session warps the pointer back to, given the area of the window on screen.
+//
+// Confining grabs (see AsyncX11::grab_pointer) keep the pointer inside the window, so the X server would move a warp
+// target outside of it to the nearest position inside, and the motion caused by warping back would never arrive where
+// expected. The blocking GDK grab doesn't confine under XInput 2, but keeping the target inside costs nothing there.
+// If the cursor is hidden, the target is also kept away from the edges of the window (as far as it's on the monitor),
+// because the position at which the pointer rests is invisible anyway.
+static GdkPoint warp_target_in_window(GdkPoint pos, const GdkRectangle& area, const GdkRectangle& monitor,
+                                      bool hide_cursor)
+{
+    GdkRectangle visible_area;
+    if (hide_cursor && gdk_rectangle_intersect(&area, &monitor, &visible_area))
+    {
+        return warp_target_within(pos, visible_area, 100);
+    }
+    return warp_target_within(pos, area, 0);
+}
+
+// The events a session needs while it has grabbed the pointer
+static GdkEventMask session_event_mask()
+{
+    return static_cast<GdkEventMask>(GDK_POINTER_MOTION_MASK | GDK_BUTTON_PRESS_MASK | GDK_BUTTON_RELEASE_MASK |
+        GDK_ENTER_NOTIFY_MASK | GDK_LEAVE_NOTIFY_MASK | GDK_SCROLL_MASK | GDK_SMOOTH_SCROLL_MASK);
+}
+
+GdkGrabStatus Session::start()
+{
+    if (!prepare())
+    {
+        return GDK_GRAB_NOT_VIEWABLE;
+    }
+    const GdkGrabStatus result = confine_window_
+                                     ? grab_pointer_confined(window_, session_event_mask(), confine_window_)
+                                     : grab_pointer(window_, session_event_mask());
+    return finish_start(result, get_pointer_position_on_screen(gdk_window_get_display(window_)));
+}
+
+void Session::start_async(AsyncX11* x11, StartCallback on_started)
+{
+    if (!prepare())
+    {
+        on_started(GDK_GRAB_NOT_VIEWABLE, user_data_);
+        return;
+    }
+    x11_ = x11;
+    on_started_ = on_started;
+    starting_ = true;
+    // Both requests are sent right away. The position reply arrives first, because replies come in request order.
+    x11->query_pointer(start_position_cb, this);
+    if (confine_window_)
+    {
+        // Same as grab_pointer_confined()
+        x11->grab_pointer(window_, false, session_event_mask(), nullptr, confine_window_, start_grab_cb, this);
+        return;
+    }
+    // Same as grab_pointer()
+    GdkCursor* gdk_cursor = gdk_cursor_new_for_display(gdk_window_get_display(window_), GDK_BLANK_CURSOR);
+    x11->grab_pointer(window_, true, session_event_mask(), gdk_cursor, window_, start_grab_cb, this);
+    g_object_unref(gdk_cursor);
+}
+
+void Session::start_position_cb(bool ok, int x, int y, gpointer user_data)
+{
+    auto* session = static_cast<Session*>(user_data);
+    if (ok)
+    {
+        session->start_pos_ = {x, y};
+    }
+}
+
+void Session::start_grab_cb(GdkGrabStatus status, gpointer user_data)
+{
+    auto* session = static_cast<Session*>(user_data);
+    session->starting_ = false;
+    const GdkGrabStatus result = session->finish_start(status, session->start_pos_);
+    session->on_started_(result, session->user_data_);
+}
+
+// Does everything which needs to happen before grabbing. Returns false if the widget doesn't have a window.
+bool Session::prepare()
+{
+    window_ = gtk_widget_get_window(widget_);
+    if (!window_)
+    {
+        return false;
+    }
+    if (config_.hide_cursor)
+    {
+        set_window_cursor_visible(window_, false);
+    }
+    const ConfineConfig& confine = config_.confine;
+    if (confine.enabled)
+    {
+        // X confines the pointer to a window, so we create an invisible one covering the rectangle. It doesn't take
+        // any events itself.
+        GdkWindowAttr attributes = {};
+        attributes.x = confine.left;
+        attributes.y = confine.top;
+        attributes.width = std::max(confine.right - confine.left, 1);
+        attributes.height = std::max(confine.bottom - confine.top, 1);
+        attributes.wclass = GDK_INPUT_ONLY;
+        attributes.window_type = GDK_WINDOW_CHILD;
+        confine_window_ = gdk_window_new(window_, &attributes, GDK_WA_X | GDK_WA_Y);
+        gdk_window_show(confine_window_);
+    }
+    origin_ = cached_window_origin(window_);
+    return true;
+}
+
+// Activates the session if grabbing succeeded, otherwise undoes prepare().
+GdkGrabStatus Session::finish_start(GdkGrabStatus result, GdkPoint pointer_pos)
+{
+    if (result != GDK_GRAB_SUCCESS)
+    {
+        unprepare();
+        return result;
+    }
+    initial_pos_ = pointer_pos;
+    last_x_ = initial_pos_.x;
+    last_y_ = initial_pos_.y;
+    warp_pending_ = false;
+    update_monitor();
+    update_warp_target();
+    // The geometry only changes if monitors are (re)configured or the window moves to a monitor with another scale
+    screen_ = GDK_SCREEN(g_object_ref(gdk_window_get_screen(window_)));
+    monitors_changed_handler_ = g_signal_connect(screen_, "monitors-changed", G_CALLBACK(monitors_changed_cb), this);
+    scale_factor_handler_ =
+        g_signal_connect(widget_, "notify::scale-factor", G_CALLBACK(scale_factor_changed_cb), this);
+    // X servers have their own clock. Wayland compositors use the kernel's timestamps.
+    clock_.reset(GDK_IS_X11_DISPLAY(gdk_window_get_display(window_)) ? EventClock::Source::kServer
+                                                                      : EventClock::Source::kMonotonic);
+    if (config_.history)
+    {
+        config_.history->clear();
+    }
+    // Without this, GDK merges queued motion events and we could miss the one caused by warping.
+    gdk_window_set_event_compression(window_, FALSE);
+    // Capturing on the toplevel lets us see events before any Flutter widget does, and decide whether to pass them
+    // on.
+    toplevel_ = gtk_widget_get_toplevel(widget_);
+    captured_event_handler_ = g_signal_connect(toplevel_, "captured-event", G_CALLBACK(captured_event_cb), this);
+    // The origin is cached, because gdk_window_get_origin() waits for the X server
+    configure_handler_ = g_signal_connect(toplevel_, "configure-event", G_CALLBACK(configure_cb), this);
+    frame_clock_ = gdk_window_get_frame_clock(window_);
+    if (frame_clock_)
+    {
+        g_object_ref(frame_clock_);
+        update_handler_ = g_signal_connect(frame_clock_, "update", G_CALLBACK(update_cb), this);
+    }
+    active_ = true;
+    return GDK_GRAB_SUCCESS;
+}
+
+void Session::monitors_changed_cb(GdkScreen* screen, gpointer user_data)
+{
+    static_cast<Session*>(user_data)->update_monitor();
+}
+
+void Session::scale_factor_changed_cb(GObject* object, GParamSpec* pspec, gpointer user_data)
+{
+    static_cast<Session*>(user_data)->update_monitor();
+}
+
+gboolean Session::configure_cb(GtkWidget* widget, GdkEventConfigure* event, gpointer user_data)
+{
+    Session* self = static_cast<Session*>(user_data);
+    // GDK has updated the position of the toplevel before emitting this
+    self->origin_ = cached_window_origin(self->window_);
+    self->update_warp_target();
+    return FALSE;
+}
+
+void Session::update_warp_target()
+{
+    const GdkRectangle area = {origin_.x, origin_.y, gdk_window_get_width(window_), gdk_window_get_height(window_)};
+    warp_target_ = warp_target_in_window(initial_pos_, area, monitor_.bounds, config_.hide_cursor);
+}
+
+void Session::update_monitor()
+{
+    GdkMonitor* gdk_monitor = gdk_display_get_monitor_at_window(gdk_window_get_display(window_), window_);
+    if (gdk_monitor)
+    {
+        gdk_monitor_get_geometry(gdk_monitor, &monitor_.bounds);
+    }
+    monitor_.scale_factor = std::max(gdk_window_get_scale_factor(window_), 1);
+    pipeline_.get<PhysicalDeltaStage>().set_scale_factor(monitor_.scale_factor);
+}
+
+void Session::unprepare()
+{
+    if (confine_window_)
+    {
+        g_clear_pointer(&confine_window_, gdk_window_destroy);
+    }
+    if (config_.hide_cursor)
+    {
+        set_window_cursor_visible(window_, true);
+    }
+}
+
+void Session::stop()
+{
+    if (starting_)
+    {
+        // The grab might still succeed on the server, so it's released right after.
+        starting_ = false;
+        x11_->cancel(this);
+        x11_->ungrab_pointer();
+        unprepare();
+        return;
+    }
+    if (!active_)
+    {
+        return;
+    }
+    active_ = false;
+    g_signal_handler_disconnect(toplevel_, captured_event_handler_);
+    captured_event_handler_ = 0;
+    g_signal_handler_disconnect(toplevel_, configure_handler_);
+    configure_handler_ = 0;
+    if (frame_clock_)
+    {
+        g_signal_handler_disconnect(frame_clock_, update_handler_);
+        update_handler_ = 0;
+        g_clear_object(&frame_clock_);
+    }
+    g_signal_handler_disconnect(screen_, monitors_changed_handler_);
+    monitors_changed_handler_ = 0;
+    g_clear_object(&screen_);
+    g_signal_handler_disconnect(widget_, scale_factor_handler_);
+    scale_factor_handler_ = 0;
+    if (send_source_)
+    {
+        g_source_remove(send_source_);
+        send_source_ = 0;
+    }
+    fan_out_.clear();
+    gdk_window_set_event_compression(window_, TRUE);
+    if (x11_)
+    {
+        // GDK doesn't know about grabs made via AsyncX11
+        x11_->ungrab_pointer();
+    }
+    else
+    {
+        ungrab_pointer(window_);
+    }
+    // Only now, because the grab would keep the pointer within the window.
+    if (!confine_window_ && (warp_target_.x != initial_pos_.x || warp_target_.y != initial_pos_.y))
+    {
+        warp_pointer(initial_pos_);
+    }
+    unprepare();
+}
+
+gboolean Session::captured_event_cb(GtkWidget* widget, GdkEvent* event, gpointer user_data)
+{
+    auto* session = static_cast<Session*>(user_data);
+    return session->handle_event(event);
+}
+
+gboolean Session::handle_event(GdkEvent* event)
+{
+    switch (gdk_event_get_event_type(event))
+    {
+    case GDK_MOTION_NOTIFY:
+        handle_motion(event);
+        // Motion while locked would only trigger hover effects in Flutter. While confined, the pointer really moves.
+        return confine_window_ == nullptr;
+    case GDK_BUTTON_PRESS:
+        handle_button(event, EventKind::kButtonDown);
+        // With unlock-on-pointer-up, button events belong to the session.
+        return config_.unlock_on_pointer_up;
+    case GDK_2BUTTON_PRESS:
+    case GDK_3BUTTON_PRESS:
+        return config_.unlock_on_pointer_up;
+    case GDK_BUTTON_RELEASE:
+        {
+            const bool unlock = config_.unlock_on_pointer_up;
+            handle_button(event, EventKind::kButtonUp);
+            if (unlock)
+            {
+                // Subscriptions waiting for the next frame would miss the last samples otherwise
+                settle();
+                flush();
+                stop();
+                on_end_(user_data_);
+            }
+            return unlock;
+        }
+    case GDK_SCROLL:
+        handle_scroll(event);
+        return FALSE;
+    default:
+        return FALSE;
+    }
+}
+
+Sample Session::sample_from_event(GdkEvent* event, EventKind kind)
+{
+    Sample sample;
+    sample.kind = kind;
+    sample.timestamp_us = clock_.map(gdk_event_get_time(event), g_get_monotonic_time());
+    // The source device is the physical (slave) device, as opposed to the logical (master) pointer which merges the
+    // motion of all devices.
+    sample.device_id = pointing_device_id(gdk_event_get_source_device(event));
+    // The state is sampled by the windowing system together with the event itself, so it's exactly what was
+    // pressed at that point (for button events: right before the button went down or up).
+    GdkModifierType gdk_state;
+    if (gdk_event_get_state(event, &gdk_state))
+    {
+        // Super and Meta are virtual modifiers, which must be resolved from the real ones (e.g. Mod4).
+        GdkKeymap* gdk_keymap = gdk_keymap_get_for_display(gdk_window_get_display(window_));
+        gdk_keymap_add_virtual_modifiers(gdk_keymap, &gdk_state);
+        sample.buttons = flutter_buttons_from_gdk(gdk_state);
+        sample.modifiers = modifiers_from_gdk(gdk_state);
+    }
+    return sample;
+}
+
+void Session::warp_pointer(GdkPoint pos)
+{
+    if (x11_)
+    {
+        x11_->warp_pointer(pos.x, pos.y);
+        return;
+    }
+    GdkDisplay* gdk_display = gdk_window_get_display(window_);
+    GdkDevice* gdk_pointer = gdk_seat_get_pointer(gdk_display_get_default_seat(gdk_display));
+    gdk_device_warp(gdk_pointer, gdk_display_get_default_screen(gdk_display), pos.x, pos.y);
+}
+
+void Session::handle_motion(GdkEvent* event)
+{
+    gdouble x, y;
+    if (!gdk_event_get_root_coords(event, &x, &y))
+    {
+        return;
+    }
+    if (!confine_window_ && warp_pending_ && x == warp_target_.x && y == warp_target_.y)
+    {
+        // This is the motion caused by warping back. From now on, positions are relative to the warp target again.
+        warp_pending_ = false;
+        last_x_ = x;
+        last_y_ = y;
+        return;
+    }
+    Sample sample = sample_from_event(event, EventKind::kMove);
+    sample.dx = x - last_x_;
+    sample.dy = y - last_y_;
+    last_x_ = x;
+    last_y_ = y;
+    if (sample.dx == 0 && sample.dy == 0)
+    {
+        return;
+    }
+    if (confine_window_)
+    {
+        // Nothing to warp, the pointer moves freely within the confinement.
+        sample.position_x = x - origin_.x;
+        sample.position_y = y - origin_.y;
+    }
+    else if (!warp_pending_)
+    {
+        // Warp right away, so the pointer doesn't get far away from the warp target.
+        warp_pointer(warp_target_);
+        warp_pending_ = true;
+    }
+    if (config_.prediction.model != PredictionModel::kNone)
+    {
+        pipeline_.get<PredictionStage>().set_target_time(next_presentation_time(sample.timestamp_us));
+    }
+    const bool delivered = pipeline_.process(sample);
+    const bool settles = config_.filter.type != FilterType::kNone || config_.prediction.model != PredictionModel::kNone;
+    if (settles && frame_clock_)
+    {
+        // Filtered and predicted deltas are settled once a frame goes by without motion.
+        last_move_ = sample;
+        settle_pending_ = true;
+        moved_since_frame_ = true;
+        gdk_frame_clock_request_phase(frame_clock_, GDK_FRAME_CLOCK_PHASE_UPDATE);
+    }
+    if (delivered)
+    {
+        emit(sample);
+    }
+}
+
+// Returns when the frame after the given time will presumably be presented, based on the frame clock's history.
+// The frame clock uses the same clock as the sample timestamps.
+int64_t Session::next_presentation_time(int64_t timestamp_us) const
+{
+    GdkFrameClock* frame_clock = gdk_window_get_frame_clock(window_);
+    if (!frame_clock)
+    {
+        return timestamp_us;
+    }
+    gint64 refresh_interval = 0;
+    gint64 presentation_time = 0;
+    gdk_frame_clock_get_refresh_info(frame_clock, timestamp_us, &refresh_interval, &presentation_time);
+    if (presentation_time == 0)
+    {
+        // No presentation history (yet). Assume frames are presented one refresh interval after they started.
+        presentation_time = gdk_frame_clock_get_frame_time(frame_clock) + refresh_interval;
+    }
+    if (presentation_time < timestamp_us && refresh_interval > 0)
+    {
+        presentation_time += ((timestamp_us - presentation_time) / refresh_interval + 1) * refresh_interval;
+    }
+    return presentation_time;
+}
+
+void Session::handle_button(GdkEvent* event, EventKind kind)
+{
+    if (!config_.button_and_scroll_events)
+    {
+        return;
+    }
+    guint gdk_button;
+    if (!gdk_event_get_button(event, &gdk_button))
+    {
+        return;
+    }
+    Sample sample = sample_from_event(event, kind);
+    sample.button = flutter_button_from_gdk(gdk_button);
+    if (!pipeline_.process(sample))
+    {
+        return;
+    }
+    emit(sample);
+}
+
+void Session::handle_scroll(GdkEvent* event)
+{
+    if (!config_.button_and_scroll_events)
+    {
+        return;
+    }
+    Sample sample = sample_from_event(event, EventKind::kScroll);
+    // Because of GDK_SMOOTH_SCROLL_MASK, high-resolution wheels and touchpads deliver fractional deltas (one unit
+    // corresponds to one notch of a classic wheel). Devices without smooth scrolling still send discrete directions.
+    if (gdk_event_get_scroll_deltas(event, &sample.dx, &sample.dy))
+    {
+        if (sample.dx == 0 && sample.dy == 0)
+        {
+            // Touchpads send this to signal that scrolling stopped.
+            return;
+        }
+    }
+    else
+    {
+        GdkScrollDirection direction;
+        if (!gdk_event_get_scroll_direction(event, &direction))
+        {
+            return;
+        }
+        switch (direction)
+        {
+        case GDK_SCROLL_UP:
+            sample.dy = -1;
+            break;
+        case GDK_SCROLL_DOWN:
+            sample.dy = 1;
+            break;
+        case GDK_SCROLL_LEFT:
+            sample.dx = -1;
+            break;
+        case GDK_SCROLL_RIGHT:
+            sample.dx = 1;
+            break;
+        default:
+            return;
+        }
+    }
+    if (!pipeline_.process(sample))
+    {
+        return;
+    }
+    emit(sample);
+}
+
+void Session::add_subscription(int64_t id, DeliveryPolicy policy)
+{
+    fan_out_.add(id, policy);
+}
+
+void Session::remove_subscription(int64_t id)
+{
+    fan_out_.remove(id);
+}
+
+bool Session::set_subscription_policy(int64_t id, DeliveryPolicy policy)
+{
+    return fan_out_.set_policy(id, policy);
+}
+
+void Session::reconfigure(const SessionConfig& config)
+{
+    config_.unlock_on_pointer_up = config.unlock_on_pointer_up;
+    config_.transform = config.transform;
+    config_.filter = config.filter;
+    config_.value = config.value;
+    pipeline_.get<TransformStage>().reconfigure(config.transform);
+    pipeline_.get<FilterStage>().reconfigure(config.filter);
+    pipeline_.get<ValueStage>().reconfigure(config.value);
+    fan_out_.set_columns(feature_columns(config_));
+}
+
+void Session::emit(const Sample& sample)
+{
+    const PendingDelivery pending = fan_out_.dispatch(sample);
+    if (pending.every_sample && !send_source_)
+    {
+        // GDK dispatches all queued events before idle sources of this priority run, so a burst of events is sent in
+        // one message. Redrawing has a lower priority.
+        send_source_ = g_idle_add_full(G_PRIORITY_HIGH_IDLE, send_cb, this, nullptr);
+    }
+    if (!pending.frame)
+    {
+        return;
+    }
+    if (frame_clock_)
+    {
+        gdk_frame_clock_request_phase(frame_clock_, GDK_FRAME_CLOCK_PHASE_UPDATE);
+    }
+    else
+    {
+        flush();
+    }
+}
+
+gboolean Session::send_cb(gpointer user_data)
+{
+    auto* session = static_cast<Session*>(user_data);
+    session->send_source_ = 0;
+    session->fan_out_.flush_every_sample(
+        [session](const double* values, size_t length) { session->on_batch_(values, length, session->user_data_); });
+    return G_SOURCE_REMOVE;
+}
+
+void Session::flush()
+{
+    fan_out_.flush([this](const double* values, size_t length) { on_batch_(values, length, user_data_); });
+}
+
+// Delivers a move sample without movement which makes the filtered and predicted deltas catch up with the deltas,
+// unless there's nothing to catch up with. The stages up to the prediction don't see it, as if nothing happened.
+void Session::settle()
+{
+    if (!settle_pending_)
+    {
+        return;
+    }
+    settle_pending_ = false;
+    moved_since_frame_ = false;
+    Sample sample = last_move_;
+    sample.dx = 0;
+    sample.dy = 0;
+    sample.timestamp_us = g_get_monotonic_time();
+    sample.filtered_dx = 0;
+    sample.filtered_dy = 0;
+    sample.velocity_x = 0;
+    sample.velocity_y = 0;
+    sample.acceleration_x = 0;
+    sample.acceleration_y = 0;
+    sample.predicted_dx = 0;
+    sample.predicted_dy = 0;
+    sample.prediction_confidence = 0;
+    sample.physical_dx = 0;
+    sample.physical_dy = 0;
+    const bool filtered = pipeline_.get<FilterStage>().settle(sample);
+    const bool predicted = pipeline_.get<PredictionStage>().settle(sample);
+    if ((!filtered && !predicted) || !pipeline_.process_after<PredictionStage>(sample))
+    {
+        return;
+    }
+    emit(sample);
+}
+
+void Session::update_cb(GdkFrameClock* frame_clock, gpointer user_data)
+{
+    auto* session = static_cast<Session*>(user_data);
+    session->flush();
+    if (!session->settle_pending_)
+    {
+        return;
+    }
+    if (session->moved_since_frame_)
+    {
+        // Check again in the next frame
+        session->moved_since_frame_ = false;
+        gdk_frame_clock_request_phase(frame_clock, GDK_FRAME_CLOCK_PHASE_UPDATE);
+        return;
+    }
+    session->settle();
+}
+
+}  // namespace pointer_lock
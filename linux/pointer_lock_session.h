@@ -0,0 +1,238 @@
+#ifndef POINTER_LOCK_SESSION_H_
+#define POINTER_LOCK_SESSION_H_
+
+#include <gtk/gtk.h>
+
+#include <cstddef>
+
+#include "include/pointer_lock/pointer_lock_pipeline.h"
+#include "pointer_lock_clock.h"
+#include "pointer_lock_events.h"
+#include "pointer_lock_fan_out.h"
+#include "pointer_lock_stages.h"
+#include "pointer_lock_x11_async.h"
+
+// Custom stages registered by the embedder (see pointer_lock_pipeline.h)
+#ifdef POINTER_LOCK_STAGES_HEADER
+#include POINTER_LOCK_STAGES_HEADER
+#endif
+
+// This file contains the GDK-level building blocks of pointer locking. It doesn't depend on Flutter.
+
+GdkPoint get_pointer_position_on_screen(GdkDisplay* gdk_display);
+
+void set_window_cursor_visible(GdkWindow* gdk_window, bool visible);
+
+GdkGrabStatus grab_pointer(GdkWindow* gdk_window, GdkEventMask gdk_event_mask);
+
+GdkGrabStatus grab_pointer_confined(GdkWindow* gdk_window, GdkEventMask gdk_event_mask, GdkWindow* confine_to);
+
+void ungrab_pointer(GdkWindow* gdk_window);
+
+int pointing_device_id(GdkDevice* gdk_device);
+
+namespace pointer_lock
+{
+
+// A rectangle in the coordinates of the session's window, to which the pointer is confined.
+struct ConfineConfig
+{
+    bool enabled = false;
+    int left = 0;
+    int top = 0;
+    int right = 0;
+    int bottom = 0;
+};
+
+// The monitor a session started on. Cached, so that handling events doesn't need to query it.
+struct MonitorGeometry
+{
+    // In logical pixels on screen
+    GdkRectangle bounds = {0, 0, 0, 0};
+    // Physical pixels per logical pixel
+    int scale_factor = 1;
+};
+
+struct SessionConfig
+{
+    // Whether to hide the cursor while the session is active.
+    bool hide_cursor = true;
+    // Whether releasing any pointer button ends the session.
+    bool unlock_on_pointer_up = false;
+    // Whether button and scroll samples are delivered, or only move samples. Either way, button and scroll events
+    // are passed on to Flutter unless they belong to the session (see unlock_on_pointer_up).
+    bool button_and_scroll_events = true;
+    // How to transform the deltas before delivering them.
+    TransformConfig transform;
+    // How to smooth the deltas.
+    FilterConfig filter;
+    // Number of recent samples used for estimating velocity and acceleration, zero to disable.
+    size_t velocity_window = 0;
+    // How to predict the movement until the next frame is presented.
+    PredictionConfig prediction;
+    // Whether and how to map the movement to a bounded value.
+    ValueConfig value;
+    // Whether and how to maintain a virtual cursor.
+    CursorConfig cursor;
+    // If enabled, the pointer stays visible and moves freely within the rectangle instead of being locked.
+    ConfineConfig confine;
+    // Where to record the move samples, if anywhere. Must outlive the session. Cleared when the session starts.
+    MotionHistory* history = nullptr;
+};
+
+// The stages which each sample of a session runs through, in order. Button and scroll samples run through them as
+// well, most stages just pass them on.
+using SessionPipeline = PipelineOf<StageList<PhysicalDeltaStage, TransformStage>,
+                                   RegisteredStages<StageSlot::kAfterTransform>::type,
+                                   StageList<HistoryStage,
+                                             CursorStage,
+                                             FilterStage,
+                                             VelocityStage,
+                                             PredictionStage,
+                                             ValueStage>,
+                                   RegisteredStages<StageSlot::kBeforeDelivery>::type>::type;
+
+// A pointer-lock session driven directly by the GDK events which the locked window receives.
+//
+// Each motion event is turned into a delta and the pointer is warped back right away, while GDK dispatches the event.
+// If the cursor is hidden, it's warped back to a position at some distance from the monitor's edges, so that fast
+// movements don't get cut off there, and restored when the session ends. Button and scroll events are reported in
+// the same ordered stream. Motion events are not passed on to Flutter while locked (they would trigger hover
+// effects), button and scroll events are.
+//
+// A confining session doesn't warp. Instead, the pointer is confined to a rectangle of the window. Its samples carry
+// the pointer position in addition to the delta, and motion events are passed on to Flutter.
+//
+// Several subscriptions can share a session, each with its own delivery policy (see FanOut). Samples for
+// subscriptions which don't want every sample are sent with the next frame of the window.
+class Session
+{
+public:
+    // Called with each encoded batch of samples (see EventBatch). The values are only valid during the call.
+    typedef void (*BatchCallback)(const double* values, size_t length, gpointer user_data);
+    // Called when the session ended by itself, e.g. because of unlock-on-pointer-up.
+    typedef void (*EndCallback)(gpointer user_data);
+    // Called when a session started via start_async() is active, or failed to start.
+    typedef void (*StartCallback)(GdkGrabStatus status, gpointer user_data);
+
+    Session(GtkWidget* widget,
+            const SessionConfig& config,
+            BatchCallback on_batch,
+            EndCallback on_end,
+            gpointer user_data);
+    ~Session();
+
+    Session(const Session&) = delete;
+    Session& operator=(const Session&) = delete;
+
+    // Hides the cursor (if configured), grabs the pointer and starts listening to events. Nothing stays applied if
+    // grabbing fails.
+    GdkGrabStatus start();
+
+    // Like start(), but doesn't wait for the X server. The session is active once on_started has been called with
+    // GDK_GRAB_SUCCESS. Stopping it before cancels the start. The given AsyncX11 must be available and outlive the
+    // session.
+    void start_async(AsyncX11* x11, StartCallback on_started);
+
+    // Undoes everything start() did. Safe to call multiple times.
+    void stop();
+
+    // Adds a subscription, or changes the policy of an existing one. Batches for it carry the given ID.
+    void add_subscription(int64_t id, DeliveryPolicy policy);
+
+    // Removes a subscription. Pending samples for it are dropped.
+    void remove_subscription(int64_t id);
+
+    // Changes the policy of an existing subscription. Returns false if there's no such subscription.
+    bool set_subscription_policy(int64_t id, DeliveryPolicy policy);
+
+    // Applies the parts of the given configuration which can change while the session is active: whether it unlocks
+    // on pointer up, the transform, the filter and the value mode. The rest is ignored. The whole configuration
+    // applies from the next event on (GDK dispatches events on the same thread), and the stages keep their state, so
+    // the movement continues seamlessly.
+    void reconfigure(const SessionConfig& config);
+
+    const SessionConfig& config() const
+    {
+        return config_;
+    }
+
+    bool active() const
+    {
+        return active_;
+    }
+
+private:
+    static gboolean captured_event_cb(GtkWidget* widget, GdkEvent* event, gpointer user_data);
+    static void update_cb(GdkFrameClock* frame_clock, gpointer user_data);
+
+    gboolean handle_event(GdkEvent* event);
+    Sample sample_from_event(GdkEvent* event, EventKind kind);
+    static void monitors_changed_cb(GdkScreen* screen, gpointer user_data);
+    static void scale_factor_changed_cb(GObject* object, GParamSpec* pspec, gpointer user_data);
+    void update_monitor();
+    static gboolean configure_cb(GtkWidget* widget, GdkEventConfigure* event, gpointer user_data);
+    void update_warp_target();
+    static void start_position_cb(bool ok, int x, int y, gpointer user_data);
+    static void start_grab_cb(GdkGrabStatus status, gpointer user_data);
+    bool prepare();
+    GdkGrabStatus finish_start(GdkGrabStatus result, GdkPoint pointer_pos);
+    void unprepare();
+    void warp_pointer(GdkPoint pos);
+    void handle_motion(GdkEvent* event);
+    void handle_button(GdkEvent* event, EventKind kind);
+    void handle_scroll(GdkEvent* event);
+    void emit(const Sample& sample);
+    static gboolean send_cb(gpointer user_data);
+    void flush();
+    void settle();
+    int64_t next_presentation_time(int64_t timestamp_us) const;
+
+    GtkWidget* widget_;
+    GtkWidget* toplevel_ = nullptr;
+    GdkWindow* window_ = nullptr;
+    SessionConfig config_;
+    BatchCallback on_batch_;
+    EndCallback on_end_;
+    gpointer user_data_;
+    bool active_ = false;
+    // Set while a start via start_async() waits for the X server
+    bool starting_ = false;
+    AsyncX11* x11_ = nullptr;
+    StartCallback on_started_ = nullptr;
+    GdkPoint start_pos_ = {0, 0};
+    gulong captured_event_handler_ = 0;
+    gulong configure_handler_ = 0;
+    EventClock clock_;
+    GdkFrameClock* frame_clock_ = nullptr;
+    gulong update_handler_ = 0;
+    GdkPoint initial_pos_ = {0, 0};
+    // Where the pointer is warped back to
+    GdkPoint warp_target_ = {0, 0};
+    MonitorGeometry monitor_;
+    GdkScreen* screen_ = nullptr;
+    gulong monitors_changed_handler_ = 0;
+    gulong scale_factor_handler_ = 0;
+    // Input-only child window to which a confining session confines the pointer
+    GdkWindow* confine_window_ = nullptr;
+    // Position of the window on screen, from GDK's cache (see cached_window_origin())
+    GdkPoint origin_ = {0, 0};
+    double last_x_ = 0;
+    double last_y_ = 0;
+    // Whether we warped the pointer back and haven't seen the resulting motion event yet. Until then, motion
+    // events still refer to the position before warping.
+    bool warp_pending_ = false;
+    SessionPipeline pipeline_;
+    FanOut fan_out_;
+    // Idle source which sends the samples of subscriptions receiving every sample
+    guint send_source_ = 0;
+    // The most recent move sample, if filtered or predicted deltas haven't been settled since (see settle())
+    Sample last_move_;
+    bool settle_pending_ = false;
+    // Whether a move sample arrived since the previous frame, in which case the pointer doesn't rest yet
+    bool moved_since_frame_ = false;
+};
+
+}  // namespace pointer_lock
+
+#endif  // POINTER_LOCK_SESSION_H_
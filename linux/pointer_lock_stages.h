@@ -0,0 +1,843 @@
+#ifndef POINTER_LOCK_STAGES_H_
+#define POINTER_LOCK_STAGES_H_
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "pointer_lock_events.h"
+
+// This file contains the processing stages which a native session applies to its samples before encoding them.
+// Like pointer_lock_events.h, it doesn't depend on GTK or Flutter.
+
+namespace pointer_lock
+{
+
+// Returns the time between two samples in seconds, clamped to a sensible range. If there's no previous sample,
+// the maximum is returned, which makes the first movement count as slow.
+inline double elapsed_seconds(int64_t previous_timestamp_us, int64_t timestamp_us)
+{
+    constexpr int64_t kMinElapsedUs = 100;
+    constexpr int64_t kMaxElapsedUs = 100000;
+    if (previous_timestamp_us == 0)
+    {
+        return kMaxElapsedUs / 1e6;
+    }
+    const int64_t elapsed_us = std::min(std::max(timestamp_us - previous_timestamp_us, kMinElapsedUs), kMaxElapsedUs);
+    return elapsed_us / 1e6;
+}
+
+enum class AccelerationCurveType
+{
+    // No acceleration.
+    kNone,
+    // factor = 1 + coefficient * (speed / 1000) ^ exponent, limited to max_factor.
+    kPower,
+    // factor is interpolated linearly between the given (speed, factor) points.
+    kPiecewise,
+};
+
+// Maps the raw pointer speed (in pixels per second) to a factor applied to the delta.
+struct AccelerationCurve
+{
+    AccelerationCurveType type = AccelerationCurveType::kNone;
+    double coefficient = 0;
+    double exponent = 1;
+    double max_factor = 1e9;
+    // (speed, factor) pairs, sorted by speed.
+    std::vector<std::pair<double, double>> points;
+
+    double factor_at(double speed) const
+    {
+        switch (type)
+        {
+        case AccelerationCurveType::kPower:
+            return std::min(1 + coefficient * std::pow(speed / 1000, exponent), max_factor);
+        case AccelerationCurveType::kPiecewise:
+            {
+                if (points.empty())
+                {
+                    return 1;
+                }
+                if (speed <= points.front().first)
+                {
+                    return points.front().second;
+                }
+                for (size_t i = 1; i < points.size(); i++)
+                {
+                    if (speed <= points[i].first)
+                    {
+                        const auto& a = points[i - 1];
+                        const auto& b = points[i];
+                        const double t = (speed - a.first) / (b.first - a.first);
+                        return a.second + t * (b.second - a.second);
+                    }
+                }
+                return points.back().second;
+            }
+        default:
+            return 1;
+        }
+    }
+};
+
+struct TransformConfig
+{
+    double gain_x = 1;
+    double gain_y = 1;
+    AccelerationCurve curve;
+    bool swap_axes = false;
+    bool invert_x = false;
+    bool invert_y = false;
+    // Whether to round the output to whole pixels. The rounding remainders are carried over to the next sample,
+    // so no motion gets lost over the course of a long drag.
+    bool quantize = false;
+};
+
+// Applies axis mapping, gain and acceleration to move samples. Move samples whose delta ends up zero (e.g. because
+// quantization carries it over to the next sample) are dropped.
+class TransformStage
+{
+public:
+    TransformStage() = default;
+
+    explicit TransformStage(const TransformConfig& config) : config_(config)
+    {
+    }
+
+    // Changes the configuration, keeping the state (e.g. the quantization remainder).
+    void reconfigure(const TransformConfig& config)
+    {
+        config_ = config;
+        if (!config_.quantize)
+        {
+            remainder_x_ = 0;
+            remainder_y_ = 0;
+        }
+    }
+
+    bool process(Sample& sample)
+    {
+        if (sample.kind != EventKind::kMove)
+        {
+            return true;
+        }
+        double dx = sample.dx;
+        double dy = sample.dy;
+        // The curve looks at the raw speed, so that it behaves the same regardless of gain.
+        const double speed = std::hypot(dx, dy) / elapsed_seconds(previous_timestamp_us_, sample.timestamp_us);
+        previous_timestamp_us_ = sample.timestamp_us;
+        if (config_.swap_axes)
+        {
+            std::swap(dx, dy);
+        }
+        if (config_.invert_x)
+        {
+            dx = -dx;
+        }
+        if (config_.invert_y)
+        {
+            dy = -dy;
+        }
+        const double factor = config_.curve.factor_at(speed);
+        dx *= config_.gain_x * factor;
+        dy *= config_.gain_y * factor;
+        if (config_.quantize)
+        {
+            dx += remainder_x_;
+            dy += remainder_y_;
+            const double quantized_dx = std::round(dx);
+            const double quantized_dy = std::round(dy);
+            remainder_x_ = dx - quantized_dx;
+            remainder_y_ = dy - quantized_dy;
+            dx = quantized_dx;
+            dy = quantized_dy;
+        }
+        sample.dx = dx;
+        sample.dy = dy;
+        return dx != 0 || dy != 0;
+    }
+
+private:
+    TransformConfig config_;
+    int64_t previous_timestamp_us_ = 0;
+    double remainder_x_ = 0;
+    double remainder_y_ = 0;
+};
+
+enum class FilterType
+{
+    // The filtered delta equals the delta.
+    kNone,
+    // Exponential moving average with a fixed smoothing factor.
+    kEma,
+    // One-Euro filter (Casiez et al.), which smooths strongly at low speeds and reduces lag at high speeds.
+    kOneEuro,
+};
+
+struct FilterConfig
+{
+    FilterType type = FilterType::kNone;
+    // EMA: weight of the newest sample, in (0, 1].
+    double alpha = 0.5;
+    // One-Euro: cutoff frequency in Hz at zero speed.
+    double min_cutoff = 1;
+    // One-Euro: how much the cutoff frequency increases with speed.
+    double beta = 0;
+    // One-Euro: cutoff frequency in Hz used for smoothing the speed itself.
+    double derivative_cutoff = 1;
+};
+
+// Low-pass filter with a smoothing factor that can change from sample to sample.
+class LowPass
+{
+public:
+    double filter(double value, double alpha)
+    {
+        value_ = initialized_ ? value_ + alpha * (value - value_) : value;
+        initialized_ = true;
+        return value_;
+    }
+
+    double value() const
+    {
+        return value_;
+    }
+
+    bool initialized() const
+    {
+        return initialized_;
+    }
+
+private:
+    double value_ = 0;
+    bool initialized_ = false;
+};
+
+// Smooths move samples and stores the result in Sample::filtered_dx/filtered_dy.
+//
+// The filter runs on the accumulated position, not on the individual deltas, so the filtered deltas only lag
+// behind. settle() delivers what they lag behind once the pointer rests, after which they add up to the same total
+// movement.
+class FilterStage
+{
+public:
+    FilterStage() = default;
+
+    explicit FilterStage(const FilterConfig& config) : config_(config)
+    {
+    }
+
+    // Changes the configuration. If the filter type changes, the filter starts over at the current position, so the
+    // first filtered delta afterwards catches up with what the previous filter lagged behind.
+    void reconfigure(const FilterConfig& config)
+    {
+        if (config.type != config_.type)
+        {
+            x_filter_ = LowPass();
+            y_filter_ = LowPass();
+            dx_filter_ = LowPass();
+            dy_filter_ = LowPass();
+        }
+        config_ = config;
+    }
+
+    void process(Sample& sample)
+    {
+        if (sample.kind != EventKind::kMove)
+        {
+            return;
+        }
+        x_ += sample.dx;
+        y_ += sample.dy;
+        const double elapsed = elapsed_seconds(previous_timestamp_us_, sample.timestamp_us);
+        previous_timestamp_us_ = sample.timestamp_us;
+        double filtered_x = x_;
+        double filtered_y = y_;
+        switch (config_.type)
+        {
+        case FilterType::kEma:
+            filtered_x = x_filter_.filter(x_, config_.alpha);
+            filtered_y = y_filter_.filter(y_, config_.alpha);
+            break;
+        case FilterType::kOneEuro:
+            filtered_x = one_euro(x_filter_, dx_filter_, x_, elapsed);
+            filtered_y = one_euro(y_filter_, dy_filter_, y_, elapsed);
+            break;
+        default:
+            break;
+        }
+        sample.filtered_dx = filtered_x - filtered_x_;
+        sample.filtered_dy = filtered_y - filtered_y_;
+        filtered_x_ = filtered_x;
+        filtered_y_ = filtered_y;
+    }
+
+    // Stores what the filtered deltas lag behind in the given (resting) move sample, and lets the filter start over
+    // at the current position. Returns false if they don't lag behind.
+    bool settle(Sample& sample)
+    {
+        sample.filtered_dx = x_ - filtered_x_;
+        sample.filtered_dy = y_ - filtered_y_;
+        filtered_x_ = x_;
+        filtered_y_ = y_;
+        x_filter_ = LowPass();
+        y_filter_ = LowPass();
+        dx_filter_ = LowPass();
+        dy_filter_ = LowPass();
+        return sample.filtered_dx != 0 || sample.filtered_dy != 0;
+    }
+
+private:
+    static double smoothing_factor(double elapsed, double cutoff)
+    {
+        constexpr double kPi = 3.14159265358979323846;
+        const double tau = 1 / (2 * kPi * cutoff);
+        return 1 / (1 + tau / elapsed);
+    }
+
+    double one_euro(LowPass& value_filter, LowPass& derivative_filter, double value, double elapsed) const
+    {
+        const double derivative = value_filter.initialized() ? (value - value_filter.value()) / elapsed : 0;
+        const double smoothed_derivative =
+            derivative_filter.filter(derivative, smoothing_factor(elapsed, config_.derivative_cutoff));
+        const double cutoff = config_.min_cutoff + config_.beta * std::abs(smoothed_derivative);
+        return value_filter.filter(value, smoothing_factor(elapsed, cutoff));
+    }
+
+    FilterConfig config_;
+    int64_t previous_timestamp_us_ = 0;
+    // Accumulated position, unfiltered and filtered
+    double x_ = 0;
+    double y_ = 0;
+    double filtered_x_ = 0;
+    double filtered_y_ = 0;
+    LowPass x_filter_;
+    LowPass y_filter_;
+    LowPass dx_filter_;
+    LowPass dy_filter_;
+};
+
+// Estimates velocity and acceleration of move samples by fitting a parabola to the accumulated positions of the
+// most recent samples (least squares). The results are in pixels per second (squared) and stored in the sample.
+class VelocityStage
+{
+public:
+    VelocityStage() = default;
+
+    // A window of zero disables the estimation.
+    explicit VelocityStage(size_t window) : times_(window), xs_(window), ys_(window)
+    {
+    }
+
+    void process(Sample& sample)
+    {
+        if (sample.kind != EventKind::kMove || times_.empty())
+        {
+            return;
+        }
+        x_ += sample.dx;
+        y_ += sample.dy;
+        // Ring buffer, so the window doesn't need to be shifted
+        times_[next_] = sample.timestamp_us;
+        xs_[next_] = x_;
+        ys_[next_] = y_;
+        next_ = (next_ + 1) % times_.size();
+        count_ = std::min(count_ + 1, times_.size());
+        fit(sample.timestamp_us, xs_, sample.velocity_x, sample.acceleration_x);
+        fit(sample.timestamp_us, ys_, sample.velocity_y, sample.acceleration_y);
+    }
+
+private:
+    // Fits p(t) = a + b * t + c * t^2 with t relative to the newest sample. Then the velocity at the newest sample
+    // is b and the acceleration is 2c. Falls back to a line if there are too few distinct points for a parabola.
+    //
+    // The fit uses t divided by the time span of the window, which ranges from -1 to 0 regardless of the sample rate.
+    // In seconds, the sums of t^k of a short window at a high rate would be so small that the determinants couldn't
+    // be told apart from zero.
+    void fit(int64_t newest_us, const std::vector<double>& positions, double& velocity, double& acceleration) const
+    {
+        velocity = 0;
+        acceleration = 0;
+        if (count_ < 2)
+        {
+            return;
+        }
+        const size_t size = times_.size();
+        const double span = (newest_us - times_[(next_ + size - count_) % size]) / 1e6;
+        if (span <= 0)
+        {
+            return;
+        }
+        // Power sums of t and sums of p * t^k
+        double s0 = 0, s1 = 0, s2 = 0, s3 = 0, s4 = 0;
+        double p0 = 0, p1 = 0, p2 = 0;
+        for (size_t i = 0; i < count_; i++)
+        {
+            const size_t index = (next_ + size - 1 - i) % size;
+            const double t = (times_[index] - newest_us) / 1e6 / span;
+            const double p = positions[index];
+            const double t2 = t * t;
+            s0 += 1;
+            s1 += t;
+            s2 += t2;
+            s3 += t2 * t;
+            s4 += t2 * t2;
+            p0 += p;
+            p1 += p * t;
+            p2 += p * t2;
+        }
+        // The determinants are compared relative to the magnitude of their terms
+        if (count_ >= 3)
+        {
+            // Normal equations, solved with Cramer's rule
+            const double det = s0 * (s2 * s4 - s3 * s3) - s1 * (s1 * s4 - s3 * s2) + s2 * (s1 * s3 - s2 * s2);
+            if (std::abs(det) > 1e-9 * s0 * s2 * s4)
+            {
+                const double det_b = s0 * (p1 * s4 - s3 * p2) - p0 * (s1 * s4 - s3 * s2) + s2 * (s1 * p2 - p1 * s2);
+                const double det_c = s0 * (s2 * p2 - p1 * s3) - s1 * (s1 * p2 - p1 * s2) + p0 * (s1 * s3 - s2 * s2);
+                velocity = det_b / det / span;
+                acceleration = 2 * det_c / det / (span * span);
+                return;
+            }
+        }
+        const double det = s0 * s2 - s1 * s1;
+        if (std::abs(det) > 1e-9 * s0 * s2)
+        {
+            velocity = (s0 * p1 - s1 * p0) / det / span;
+        }
+    }
+
+    std::vector<int64_t> times_;
+    std::vector<double> xs_;
+    std::vector<double> ys_;
+    size_t next_ = 0;
+    size_t count_ = 0;
+    double x_ = 0;
+    double y_ = 0;
+};
+
+enum class PredictionModel
+{
+    // The predicted delta equals the delta.
+    kNone,
+    // Extrapolates with the estimated velocity.
+    kLinear,
+    // Extrapolates with the estimated velocity and acceleration.
+    kConstantAcceleration,
+};
+
+struct PredictionConfig
+{
+    PredictionModel model = PredictionModel::kNone;
+    // Number of recent samples used for estimating velocity and acceleration.
+    size_t window = 8;
+    // How far into the future to predict at most, in microseconds.
+    int64_t max_horizon_us = 50000;
+    // How far the predicted position may be away from the measured one at most, in pixels.
+    double max_distance = 100;
+};
+
+// Predicts where the pointer will be at the time the next frame is presented (see set_target_time()).
+//
+// The prediction is delivered as delta as well: Sample::predicted_dx/predicted_dy contain the delta plus the change
+// of the extrapolated offset since the previous sample. Accumulating the predicted deltas yields the predicted
+// position. settle() takes the extrapolated offset back once the pointer rests, after which they add up to the same
+// total movement as the deltas.
+class PredictionStage
+{
+public:
+    PredictionStage() = default;
+
+    explicit PredictionStage(const PredictionConfig& config)
+        : config_(config), estimator_(config.model == PredictionModel::kNone ? 0 : config.window)
+    {
+    }
+
+    // Sets the time (monotonic clock, microseconds) for which the following samples should be predicted.
+    void set_target_time(int64_t target_time_us)
+    {
+        target_time_us_ = target_time_us;
+    }
+
+    void process(Sample& sample)
+    {
+        if (sample.kind != EventKind::kMove)
+        {
+            return;
+        }
+        double offset_x = 0;
+        double offset_y = 0;
+        // Without a model, nothing is predicted
+        double confidence = 0;
+        if (config_.model != PredictionModel::kNone)
+        {
+            Sample estimate = sample;
+            estimator_.process(estimate);
+            count_ = std::min(count_ + 1, config_.window);
+            const int64_t horizon_us =
+                std::min(std::max<int64_t>(target_time_us_ - sample.timestamp_us, 0), config_.max_horizon_us);
+            const double h = horizon_us / 1e6;
+            offset_x = estimate.velocity_x * h;
+            offset_y = estimate.velocity_y * h;
+            if (config_.model == PredictionModel::kConstantAcceleration)
+            {
+                offset_x += 0.5 * estimate.acceleration_x * h * h;
+                offset_y += 0.5 * estimate.acceleration_y * h * h;
+            }
+            // Trust the prediction less if there's little history or if it reaches far into the future
+            confidence = static_cast<double>(count_) / config_.window;
+            if (config_.max_horizon_us > 0)
+            {
+                confidence *= 1 - 0.5 * horizon_us / config_.max_horizon_us;
+            }
+            const double distance = std::hypot(offset_x, offset_y);
+            if (distance > config_.max_distance)
+            {
+                const double factor = config_.max_distance / distance;
+                offset_x *= factor;
+                offset_y *= factor;
+                confidence *= factor;
+            }
+        }
+        sample.predicted_dx = sample.dx + offset_x - offset_x_;
+        sample.predicted_dy = sample.dy + offset_y - offset_y_;
+        sample.prediction_confidence = confidence;
+        offset_x_ = offset_x;
+        offset_y_ = offset_y;
+    }
+
+    // Stores the change back to the measured position in the given (resting) move sample. Returns false if nothing
+    // was predicted.
+    bool settle(Sample& sample)
+    {
+        sample.predicted_dx = -offset_x_;
+        sample.predicted_dy = -offset_y_;
+        sample.prediction_confidence = 0;
+        offset_x_ = 0;
+        offset_y_ = 0;
+        return sample.predicted_dx != 0 || sample.predicted_dy != 0;
+    }
+
+private:
+    PredictionConfig config_;
+    VelocityStage estimator_;
+    size_t count_ = 0;
+    int64_t target_time_us_ = 0;
+    // Extrapolated offset of the previous sample
+    double offset_x_ = 0;
+    double offset_y_ = 0;
+};
+
+// Which movement changes the value of a value-mode session.
+enum class ValueAxis
+{
+    kHorizontal,
+    // Moving up increases the value.
+    kVertical,
+    // Moving right or up increases the value.
+    kBoth,
+};
+
+struct ValueConfig
+{
+    bool enabled = false;
+    double start = 0;
+    double min = 0;
+    double max = 1;
+    // How far the pointer needs to move for going from min to max.
+    double pixels_per_range = 200;
+    // Values are rounded to multiples of this (counted from min), zero means no rounding.
+    double step = 0;
+    // While any of these modifiers (Modifier bits) is pressed, the value changes more slowly.
+    int fine_modifiers = kShiftModifier;
+    double fine_factor = 0.1;
+    // Whether to wrap around instead of clamping at the bounds.
+    bool wrap = false;
+    ValueAxis axis = ValueAxis::kVertical;
+};
+
+// Maps move samples to a bounded value and stores it in Sample::value. Move samples which don't change the
+// (rounded) value are dropped, so the number of delivered events scales with the number of value changes.
+class ValueStage
+{
+public:
+    ValueStage() = default;
+
+    explicit ValueStage(const ValueConfig& config) : config_(config)
+    {
+        value_ = bound(config.start);
+        emitted_value_ = round(value_);
+    }
+
+    // Changes the configuration (e.g. the fine factor). The current value is kept (within the new bounds), unless
+    // value mode was disabled before, in which case it starts at ValueConfig::start.
+    void reconfigure(const ValueConfig& config)
+    {
+        const double value = config_.enabled ? value_ : config.start;
+        config_ = config;
+        value_ = bound(value);
+        emitted_value_ = round(value_);
+    }
+
+    // Returns whether the sample should be delivered.
+    bool process(Sample& sample)
+    {
+        if (!config_.enabled)
+        {
+            return true;
+        }
+        if (sample.kind != EventKind::kMove)
+        {
+            sample.value = emitted_value_;
+            return true;
+        }
+        double distance = 0;
+        switch (config_.axis)
+        {
+        case ValueAxis::kHorizontal:
+            distance = sample.dx;
+            break;
+        case ValueAxis::kVertical:
+            distance = -sample.dy;
+            break;
+        case ValueAxis::kBoth:
+            distance = sample.dx - sample.dy;
+            break;
+        }
+        double change = distance * (config_.max - config_.min) / config_.pixels_per_range;
+        if (sample.modifiers & config_.fine_modifiers)
+        {
+            change *= config_.fine_factor;
+        }
+        // The unrounded value is kept, so slow movements add up and reversing the direction at a bound reacts
+        // immediately.
+        value_ = bound(value_ + change);
+        const double value = round(value_);
+        if (value == emitted_value_)
+        {
+            return false;
+        }
+        emitted_value_ = value;
+        sample.value = value;
+        return true;
+    }
+
+private:
+    double bound(double value) const
+    {
+        const double range = config_.max - config_.min;
+        if (!config_.wrap || range <= 0)
+        {
+            return std::min(std::max(value, config_.min), config_.max);
+        }
+        double offset = std::fmod(value - config_.min, range);
+        if (offset < 0)
+        {
+            offset += range;
+        }
+        return config_.min + offset;
+    }
+
+    double round(double value) const
+    {
+        if (config_.step <= 0)
+        {
+            return value;
+        }
+        const double rounded = config_.min + std::round((value - config_.min) / config_.step) * config_.step;
+        if (config_.wrap && rounded >= config_.max)
+        {
+            // When wrapping, max and min denote the same value
+            return config_.min;
+        }
+        return std::min(rounded, config_.max);
+    }
+
+    ValueConfig config_;
+    double value_ = 0;
+    double emitted_value_ = 0;
+};
+
+struct CursorConfig
+{
+    bool enabled = false;
+    double start_x = 0;
+    double start_y = 0;
+    // The rectangle in which the virtual cursor moves.
+    double left = 0;
+    double top = 0;
+    double right = 0;
+    double bottom = 0;
+    // Whether to wrap around at the edges instead of clamping.
+    bool wrap = false;
+};
+
+// Integrates the deltas of move samples into a virtual cursor position, with sub-pixel precision, and stores it in
+// Sample::cursor_x/cursor_y.
+class CursorStage
+{
+public:
+    CursorStage() = default;
+
+    explicit CursorStage(const CursorConfig& config) : config_(config)
+    {
+        x_ = bound(config.start_x, config.left, config.right);
+        y_ = bound(config.start_y, config.top, config.bottom);
+    }
+
+    void process(Sample& sample)
+    {
+        if (!config_.enabled)
+        {
+            return;
+        }
+        if (sample.kind == EventKind::kMove)
+        {
+            x_ = bound(x_ + sample.dx, config_.left, config_.right);
+            y_ = bound(y_ + sample.dy, config_.top, config_.bottom);
+        }
+        sample.cursor_x = x_;
+        sample.cursor_y = y_;
+    }
+
+private:
+    double bound(double value, double min, double max) const
+    {
+        const double range = max - min;
+        if (!config_.wrap || range <= 0)
+        {
+            return std::min(std::max(value, min), max);
+        }
+        // The range is half-open when wrapping, otherwise max and min would be distinct positions on the same spot
+        double offset = std::fmod(value - min, range);
+        if (offset < 0)
+        {
+            offset += range;
+        }
+        return min + offset;
+    }
+
+    CursorConfig config_;
+    double x_ = 0;
+    double y_ = 0;
+};
+
+// Keeps the most recent move samples in a fixed-size ring, one array per field (struct of arrays), so recording
+// doesn't allocate and reading a time window touches only the memory it needs.
+class MotionHistory
+{
+public:
+    explicit MotionHistory(size_t capacity) : timestamps_(capacity), dx_(capacity), dy_(capacity)
+    {
+    }
+
+    void clear()
+    {
+        next_ = 0;
+        count_ = 0;
+    }
+
+    size_t size() const
+    {
+        return count_;
+    }
+
+    void add(const Sample& sample)
+    {
+        if (sample.kind != EventKind::kMove || timestamps_.empty())
+        {
+            return;
+        }
+        timestamps_[next_] = sample.timestamp_us;
+        dx_[next_] = sample.dx;
+        dy_[next_] = sample.dy;
+        next_ = (next_ + 1) % timestamps_.size();
+        count_ = std::min(count_ + 1, timestamps_.size());
+    }
+
+    // Encodes the samples not older than the given time, oldest first, column after column:
+    //
+    //     [count, timestamp_0 .. timestamp_n, dx_0 .. dx_n, dy_0 .. dy_n]
+    void encode_since(int64_t since_us, std::vector<double>& encoded) const
+    {
+        const size_t capacity = timestamps_.size();
+        // Samples are recorded in chronological order, so walk back from the newest one.
+        size_t count = 0;
+        while (count < count_ && timestamps_[(next_ + capacity - 1 - count) % capacity] >= since_us)
+        {
+            count++;
+        }
+        encoded.resize(1 + 3 * count);
+        encoded[0] = static_cast<double>(count);
+        double* columns = encoded.data() + 1;
+        const size_t first = (next_ + capacity - count) % capacity;
+        for (size_t i = 0; i < count; i++)
+        {
+            const size_t index = (first + i) % capacity;
+            columns[i] = static_cast<double>(timestamps_[index]);
+            columns[count + i] = dx_[index];
+            columns[2 * count + i] = dy_[index];
+        }
+    }
+
+private:
+    std::vector<int64_t> timestamps_;
+    std::vector<double> dx_;
+    std::vector<double> dy_;
+    size_t next_ = 0;
+    size_t count_ = 0;
+};
+
+// Records move samples in a MotionHistory, if there is one.
+class HistoryStage
+{
+public:
+    // The history must outlive the stage.
+    void set_history(MotionHistory* history)
+    {
+        history_ = history;
+    }
+
+    void process(const Sample& sample)
+    {
+        if (history_)
+        {
+            history_->add(sample);
+        }
+    }
+
+private:
+    MotionHistory* history_ = nullptr;
+};
+
+// Converts the deltas of move samples to physical pixels and stores them in Sample::physical_dx/physical_dy. Sessions
+// run it before the transform, so the physical deltas are the pointer's actual motion, without gain or axis mapping.
+class PhysicalDeltaStage
+{
+public:
+    // Physical pixels per logical pixel
+    void set_scale_factor(double scale_factor)
+    {
+        scale_factor_ = scale_factor;
+    }
+
+    void process(Sample& sample)
+    {
+        if (sample.kind != EventKind::kMove)
+        {
+            return;
+        }
+        sample.physical_dx = sample.dx * scale_factor_;
+        sample.physical_dy = sample.dy * scale_factor_;
+    }
+
+private:
+    double scale_factor_ = 1;
+};
+
+}  // namespace pointer_lock
+
+#endif  // POINTER_LOCK_STAGES_H_
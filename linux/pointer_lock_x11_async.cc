@@ -0,0 +1,385 @@
+#include "pointer_lock_x11_async.h"
+
+#ifdef POINTER_LOCK_HAVE_XCB
+#include <X11/Xlib-xcb.h>
+#include <gdk/gdkx.h>
+#include <xcb/xcb.h>
+#include <xcb/xcbext.h>
+#include <xcb/xfixes.h>
+#include <xcb/xinput.h>
+
+#include <cstdlib>
+#endif
+
+#include <algorithm>
+
+namespace pointer_lock
+{
+
+AsyncX11::AsyncX11(GdkDisplay* gdk_display) : gdk_display_(gdk_display)
+{
+#ifdef POINTER_LOCK_HAVE_XCB
+    if (!GDK_IS_X11_DISPLAY(gdk_display))
+    {
+        return;
+    }
+    Display* x_display = GDK_DISPLAY_XDISPLAY(gdk_display);
+    connection_ = XGetXCBConnection(x_display);
+    root_ = static_cast<uint32_t>(DefaultRootWindow(x_display));
+    // GDK decides the same way whether to use XInput 2
+    xi2_ = g_getenv("GDK_CORE_DEVICE_EVENTS") == nullptr;
+    GdkDevice* gdk_pointer = gdk_seat_get_pointer(gdk_display_get_default_seat(gdk_display));
+    pointer_device_id_ = static_cast<uint16_t>(gdk_x11_device_get_id(gdk_pointer));
+    // Asks whether XFixes is there without waiting, so add_barriers() finds the answer later
+    xcb_prefetch_extension_data(connection_, &xcb_xfixes_id);
+#endif
+}
+
+AsyncX11::~AsyncX11()
+{
+    if (poll_source_ != 0)
+    {
+        g_source_remove(poll_source_);
+    }
+    // Callers might wait for the replies to release resources (e.g. method calls), so they get a failure.
+    std::vector<PendingRequest> pending;
+    pending.swap(pending_);
+    for (const PendingRequest& request : pending)
+    {
+        if (request.kind == RequestKind::kQueryPointer)
+        {
+            request.on_position(false, 0, 0, request.user_data);
+        }
+        else
+        {
+            request.on_grab(GDK_GRAB_FAILED, request.user_data);
+        }
+    }
+}
+
+void AsyncX11::query_pointer(PositionCallback on_position, gpointer user_data)
+{
+#ifdef POINTER_LOCK_HAVE_XCB
+    flush_xlib();
+    xcb_query_pointer_cookie_t cookie = xcb_query_pointer(connection_, root_);
+    xcb_flush(connection_);
+    add_pending({cookie.sequence, RequestKind::kQueryPointer, on_position, nullptr, user_data});
+#else
+    on_position(false, 0, 0, user_data);
+#endif
+}
+
+#ifdef POINTER_LOCK_HAVE_XCB
+// Translates the pointer-related part of a GDK event mask into the core protocol event mask used for grabs.
+static uint16_t core_pointer_event_mask(GdkEventMask gdk_event_mask)
+{
+    uint16_t mask = 0;
+    if (gdk_event_mask & GDK_POINTER_MOTION_MASK)
+    {
+        mask |= XCB_EVENT_MASK_POINTER_MOTION;
+    }
+    // Scrolling is reported as button 4 to 7 in the core protocol
+    if (gdk_event_mask & (GDK_BUTTON_PRESS_MASK | GDK_SCROLL_MASK | GDK_SMOOTH_SCROLL_MASK))
+    {
+        mask |= XCB_EVENT_MASK_BUTTON_PRESS;
+    }
+    if (gdk_event_mask & (GDK_BUTTON_RELEASE_MASK | GDK_SCROLL_MASK | GDK_SMOOTH_SCROLL_MASK))
+    {
+        mask |= XCB_EVENT_MASK_BUTTON_RELEASE;
+    }
+    if (gdk_event_mask & GDK_ENTER_NOTIFY_MASK)
+    {
+        mask |= XCB_EVENT_MASK_ENTER_WINDOW;
+    }
+    if (gdk_event_mask & GDK_LEAVE_NOTIFY_MASK)
+    {
+        mask |= XCB_EVENT_MASK_LEAVE_WINDOW;
+    }
+    return mask;
+}
+
+// Same for XInput 2, see gdk_x11_device_xi2_grab()
+static uint32_t xi2_pointer_event_mask(GdkEventMask gdk_event_mask)
+{
+    uint32_t mask = 0;
+    // Smooth scrolling is reported as motion along the scroll valuators in XInput 2
+    if (gdk_event_mask & (GDK_POINTER_MOTION_MASK | GDK_SMOOTH_SCROLL_MASK))
+    {
+        mask |= XCB_INPUT_XI_EVENT_MASK_MOTION;
+    }
+    if (gdk_event_mask & (GDK_BUTTON_PRESS_MASK | GDK_SCROLL_MASK))
+    {
+        mask |= XCB_INPUT_XI_EVENT_MASK_BUTTON_PRESS;
+    }
+    if (gdk_event_mask & (GDK_BUTTON_RELEASE_MASK | GDK_SCROLL_MASK))
+    {
+        mask |= XCB_INPUT_XI_EVENT_MASK_BUTTON_RELEASE;
+    }
+    if (gdk_event_mask & GDK_ENTER_NOTIFY_MASK)
+    {
+        mask |= XCB_INPUT_XI_EVENT_MASK_ENTER;
+    }
+    if (gdk_event_mask & GDK_LEAVE_NOTIFY_MASK)
+    {
+        mask |= XCB_INPUT_XI_EVENT_MASK_LEAVE;
+    }
+    return mask;
+}
+#endif
+
+void AsyncX11::grab_pointer(GdkWindow* gdk_window,
+                            bool owner_events,
+                            GdkEventMask gdk_event_mask,
+                            GdkCursor* cursor,
+                            GdkWindow* confine_to,
+                            GrabCallback on_grab,
+                            gpointer user_data)
+{
+#ifdef POINTER_LOCK_HAVE_XCB
+    flush_xlib();
+    const auto window = static_cast<xcb_window_t>(gdk_x11_window_get_xid(gdk_window));
+    const xcb_cursor_t x_cursor = cursor ? static_cast<xcb_cursor_t>(gdk_x11_cursor_get_xcursor(cursor)) : XCB_NONE;
+    unsigned int sequence;
+    if (xi2_)
+    {
+        if (confine_to)
+        {
+            add_barriers(confine_to);
+        }
+        const uint32_t mask = xi2_pointer_event_mask(gdk_event_mask);
+        sequence = xcb_input_xi_grab_device(connection_,
+                                            window,
+                                            XCB_CURRENT_TIME,
+                                            x_cursor,
+                                            pointer_device_id_,
+                                            XCB_INPUT_GRAB_MODE_22_ASYNC,
+                                            XCB_INPUT_GRAB_MODE_22_ASYNC,
+                                            owner_events,
+                                            1,
+                                            &mask)
+                       .sequence;
+    }
+    else
+    {
+        sequence = xcb_grab_pointer(connection_,
+                                    owner_events,
+                                    window,
+                                    core_pointer_event_mask(gdk_event_mask),
+                                    XCB_GRAB_MODE_ASYNC,
+                                    XCB_GRAB_MODE_ASYNC,
+                                    confine_to ? static_cast<xcb_window_t>(gdk_x11_window_get_xid(confine_to))
+                                               : XCB_NONE,
+                                    x_cursor,
+                                    XCB_CURRENT_TIME)
+                       .sequence;
+    }
+    xcb_flush(connection_);
+    add_pending({sequence, RequestKind::kGrabPointer, nullptr, on_grab, user_data});
+#else
+    (void) gdk_window;
+    (void) owner_events;
+    (void) gdk_event_mask;
+    (void) cursor;
+    (void) confine_to;
+    on_grab(GDK_GRAB_FAILED, user_data);
+#endif
+}
+
+void AsyncX11::ungrab_pointer()
+{
+#ifdef POINTER_LOCK_HAVE_XCB
+    flush_xlib();
+    if (xi2_)
+    {
+        xcb_input_xi_ungrab_device(connection_, XCB_CURRENT_TIME, pointer_device_id_);
+    }
+    else
+    {
+        xcb_ungrab_pointer(connection_, XCB_CURRENT_TIME);
+    }
+    remove_barriers();
+    xcb_flush(connection_);
+#endif
+}
+
+#ifdef POINTER_LOCK_HAVE_XCB
+// Puts pointer barriers along the edges of the given window, so the pointer can't leave it. Errors (e.g. if the X
+// server doesn't support barriers) are discarded, they mustn't reach GDK's error handler.
+void AsyncX11::add_barriers(GdkWindow* gdk_window)
+{
+    remove_barriers();
+    const xcb_query_extension_reply_t* xfixes = xcb_get_extension_data(connection_, &xcb_xfixes_id);
+    if (!xfixes || !xfixes->present)
+    {
+        return;
+    }
+    if (!xfixes_version_sent_)
+    {
+        // Barriers are only accepted from clients which announced version 5. The reply isn't needed, because the X
+        // server processes requests in order.
+        xcb_discard_reply(connection_, xcb_xfixes_query_version(connection_, 5, 0).sequence);
+        xfixes_version_sent_ = true;
+    }
+    const int scale = window_scale();
+    const GdkPoint origin = cached_window_origin(gdk_window);
+    const int left = origin.x * scale;
+    const int top = origin.y * scale;
+    const int right = left + gdk_window_get_width(gdk_window) * scale;
+    const int bottom = top + gdk_window_get_height(gdk_window) * scale;
+    const int edges[4][4] = {
+        {left, top, left, bottom},
+        {right, top, right, bottom},
+        {left, top, right, top},
+        {left, bottom, right, bottom},
+    };
+    for (const auto& edge : edges)
+    {
+        const uint32_t barrier = xcb_generate_id(connection_);
+        // No directions means that the barrier blocks in both
+        const xcb_void_cookie_t cookie = xcb_xfixes_create_pointer_barrier_checked(connection_,
+                                                                                   barrier,
+                                                                                   root_,
+                                                                                   static_cast<uint16_t>(edge[0]),
+                                                                                   static_cast<uint16_t>(edge[1]),
+                                                                                   static_cast<uint16_t>(edge[2]),
+                                                                                   static_cast<uint16_t>(edge[3]),
+                                                                                   0,
+                                                                                   0,
+                                                                                   nullptr);
+        xcb_discard_reply(connection_, cookie.sequence);
+        barriers_.push_back(barrier);
+    }
+}
+
+void AsyncX11::remove_barriers()
+{
+    for (const uint32_t barrier : barriers_)
+    {
+        xcb_discard_reply(connection_, xcb_xfixes_delete_pointer_barrier_checked(connection_, barrier).sequence);
+    }
+    barriers_.clear();
+}
+#endif
+
+void AsyncX11::warp_pointer(int x, int y)
+{
+#ifdef POINTER_LOCK_HAVE_XCB
+    flush_xlib();
+    const int scale = window_scale();
+    xcb_warp_pointer(
+        connection_, XCB_NONE, root_, 0, 0, 0, 0, static_cast<int16_t>(x * scale), static_cast<int16_t>(y * scale));
+    xcb_flush(connection_);
+#else
+    (void) x;
+    (void) y;
+#endif
+}
+
+void AsyncX11::cancel(gpointer user_data)
+{
+    pending_.erase(std::remove_if(pending_.begin(),
+                                  pending_.end(),
+                                  [user_data](const PendingRequest& r) { return r.user_data == user_data; }),
+                   pending_.end());
+}
+
+GdkPoint cached_window_origin(GdkWindow* gdk_window)
+{
+    GdkPoint origin = {0, 0};
+    for (GdkWindow* window = gdk_window; window && gdk_window_get_window_type(window) != GDK_WINDOW_ROOT;
+         window = gdk_window_get_parent(window))
+    {
+        int x, y;
+        gdk_window_get_position(window, &x, &y);
+        origin.x += x;
+        origin.y += y;
+    }
+    return origin;
+}
+
+// GDK divides X coordinates by this, see GDK_SCALE. It's the same for all windows of a display.
+int AsyncX11::window_scale() const
+{
+    GdkWindow* root = gdk_screen_get_root_window(gdk_display_get_default_screen(gdk_display_));
+    return std::max(gdk_window_get_scale_factor(root), 1);
+}
+
+// Hands requests which GDK has queued in Xlib to the server first, so they keep their order relative to ours.
+void AsyncX11::flush_xlib()
+{
+#ifdef POINTER_LOCK_HAVE_XCB
+    XFlush(GDK_DISPLAY_XDISPLAY(gdk_display_));
+#endif
+}
+
+void AsyncX11::add_pending(const PendingRequest& request)
+{
+    pending_.push_back(request);
+    if (poll_source_ == 0)
+    {
+        // The reply usually arrives within a millisecond on a local display
+        poll_source_ = g_timeout_add(1, poll_cb, this);
+    }
+}
+
+gboolean AsyncX11::poll_cb(gpointer user_data)
+{
+    auto* self = static_cast<AsyncX11*>(user_data);
+    if (self->poll())
+    {
+        return G_SOURCE_CONTINUE;
+    }
+    self->poll_source_ = 0;
+    return G_SOURCE_REMOVE;
+}
+
+// Processes the replies which have arrived, in request order. Returns whether requests are still pending.
+bool AsyncX11::poll()
+{
+#ifdef POINTER_LOCK_HAVE_XCB
+    while (!pending_.empty())
+    {
+        const PendingRequest request = pending_.front();
+        void* reply = nullptr;
+        xcb_generic_error_t* error = nullptr;
+        if (!xcb_poll_for_reply(connection_, request.sequence, &reply, &error))
+        {
+            return true;
+        }
+        // Remove it before calling back, which might issue or cancel requests
+        pending_.erase(pending_.begin());
+        if (request.kind == RequestKind::kQueryPointer)
+        {
+            auto* query_reply = static_cast<xcb_query_pointer_reply_t*>(reply);
+            if (query_reply)
+            {
+                const int scale = window_scale();
+                request.on_position(true, query_reply->root_x / scale, query_reply->root_y / scale, request.user_data);
+            }
+            else
+            {
+                request.on_position(false, 0, 0, request.user_data);
+            }
+        }
+        else
+        {
+            // The statuses of both kinds of grabs have the same order as GdkGrabStatus
+            GdkGrabStatus status = GDK_GRAB_FAILED;
+            if (reply && xi2_)
+            {
+                status = static_cast<GdkGrabStatus>(static_cast<xcb_input_xi_grab_device_reply_t*>(reply)->status);
+            }
+            else if (reply)
+            {
+                status = static_cast<GdkGrabStatus>(static_cast<xcb_grab_pointer_reply_t*>(reply)->status);
+            }
+            request.on_grab(status, request.user_data);
+        }
+        free(reply);
+        free(error);
+    }
+#endif
+    return false;
+}
+
+}  // namespace pointer_lock
@@ -0,0 +1,125 @@
+#ifndef POINTER_LOCK_X11_ASYNC_H_
+#define POINTER_LOCK_X11_ASYNC_H_
+
+#include <gtk/gtk.h>
+
+#include <cstdint>
+#include <vector>
+
+// Declared by <xcb/xcb.h>, which is only included where needed
+struct xcb_connection_t;
+
+// This file contains non-blocking variants of the X11 requests used for pointer locking. It doesn't depend on
+// Flutter.
+
+namespace pointer_lock
+{
+
+// Issues pointer grabs, position queries and warps without waiting for the X server, so the GTK main loop (which is
+// also Flutter's platform thread) never blocks on a round trip. Replies are collected on later main-loop iterations
+// and passed to the callbacks, in the order of the requests.
+//
+// Only available on X11 if the plug-in was built with xcb (see available()). Otherwise, callers use the blocking GDK
+// functions.
+class AsyncX11
+{
+public:
+    // Called with the pointer position on screen, in logical pixels like GDK's coordinates. `ok` is false if the
+    // query failed or was cancelled.
+    typedef void (*PositionCallback)(bool ok, int x, int y, gpointer user_data);
+    // Called with the result of a grab, GDK_GRAB_FAILED if the request failed or was cancelled.
+    typedef void (*GrabCallback)(GdkGrabStatus status, gpointer user_data);
+
+    explicit AsyncX11(GdkDisplay* gdk_display);
+    // Calls the callbacks of pending requests as failed.
+    ~AsyncX11();
+
+    AsyncX11(const AsyncX11&) = delete;
+    AsyncX11& operator=(const AsyncX11&) = delete;
+
+    bool available() const
+    {
+        return connection_ != nullptr;
+    }
+
+    // Whether grabs use XInput 2 rather than the core protocol (see grab_pointer())
+    bool xi2() const
+    {
+        return xi2_;
+    }
+
+    void query_pointer(PositionCallback on_position, gpointer user_data);
+
+    // Grabs the pointer for the given window. Like gdk_pointer_grab, but without blocking. If `cursor` is nullptr,
+    // the cursor of the window is shown. If `confine_to` isn't nullptr, the pointer can't leave that window while
+    // grabbed.
+    //
+    // The grab has the same type as the ones GDK makes (XInput 2, unless GDK_CORE_DEVICE_EVENTS is set), because the X
+    // server only reports events of that type to the grabbing client, and GDK ignores the others. Core grabs confine
+    // the pointer themselves. XInput 2 grabs can't, so pointer barriers (XFixes 5) are put along the edges of the
+    // window instead. Unlike a confining grab, they stay where they are if the window moves while grabbed, and they
+    // don't confine anything on X servers without barrier support.
+    void grab_pointer(GdkWindow* gdk_window,
+                      bool owner_events,
+                      GdkEventMask gdk_event_mask,
+                      GdkCursor* cursor,
+                      GdkWindow* confine_to,
+                      GrabCallback on_grab,
+                      gpointer user_data);
+
+    // Releases the grab and the pointer barriers made by grab_pointer().
+    void ungrab_pointer();
+
+    // Warps the pointer to the given position on screen, in logical pixels. There's no reply.
+    void warp_pointer(int x, int y);
+
+    // Drops pending requests with the given user data without calling their callbacks.
+    void cancel(gpointer user_data);
+
+private:
+    enum class RequestKind
+    {
+        kQueryPointer,
+        kGrabPointer,
+    };
+
+    struct PendingRequest
+    {
+        unsigned int sequence;
+        RequestKind kind;
+        PositionCallback on_position;
+        GrabCallback on_grab;
+        gpointer user_data;
+    };
+
+    static gboolean poll_cb(gpointer user_data);
+
+    void add_pending(const PendingRequest& request);
+    bool poll();
+    void flush_xlib();
+    int window_scale() const;
+    void add_barriers(GdkWindow* gdk_window);
+    void remove_barriers();
+
+    GdkDisplay* gdk_display_;
+    // The xcb connection underlying GDK's Xlib display, nullptr if not available
+    xcb_connection_t* connection_ = nullptr;
+    uint32_t root_ = 0;
+    // Whether GDK uses XInput 2 events, and the ID of the pointer it grabs in that case
+    bool xi2_ = false;
+    uint16_t pointer_device_id_ = 0;
+    std::vector<PendingRequest> pending_;
+    guint poll_source_ = 0;
+    // The pointer barriers confining an XInput 2 grab, and whether the XFixes version has been negotiated for them
+    std::vector<uint32_t> barriers_;
+    bool xfixes_version_sent_ = false;
+};
+
+// Returns the position of the given window on screen, in logical pixels, from the geometry GDK has cached. Unlike
+// gdk_window_get_origin(), it doesn't ask the X server. GDK updates the cached position of toplevel windows whenever
+// they are configured.
+GdkPoint cached_window_origin(GdkWindow* gdk_window);
+
+}  // namespace pointer_lock
+
+#endif  // POINTER_LOCK_X11_ASYNC_H_
@@ -0,0 +1,480 @@
+// Reports what the plug-in can do on this machine, without Flutter. Build it by configuring the Linux build with
+// -DPOINTER_LOCK_BUILD_PROBE=ON and run it on the affected seat:
+//
+//     pointer_lock_probe [--duration SECONDS] [--json]
+//
+// It opens a small window, locks the pointer the same way the plug-in does and samples the motion for a while
+// (move the mouse during that time). Afterwards, it prints a summary and the same data as JSON.
+
+#include <gtk/gtk.h>
+
+#ifdef GDK_WINDOWING_X11
+#include <gdk/gdkx.h>
+#endif
+#ifdef GDK_WINDOWING_WAYLAND
+#include <gdk/gdkwayland.h>
+#endif
+#ifdef POINTER_LOCK_HAVE_XI2
+#include <X11/extensions/XInput2.h>
+#endif
+#ifdef POINTER_LOCK_HAVE_WAYLAND_CLIENT
+#include <wayland-client.h>
+#endif
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "../pointer_lock_events.h"
+#include "../pointer_lock_session.h"
+#include "../pointer_lock_x11_async.h"
+
+namespace
+{
+
+struct Timing
+{
+    double min_us = 0;
+    double median_us = 0;
+    double max_us = 0;
+};
+
+struct ProbeResult
+{
+    std::string display_server = "unknown";
+    std::string session_type;
+    bool xi2 = false;
+    int xi2_major = 0;
+    int xi2_minor = 0;
+    bool xfixes = false;
+    bool pointer_constraints = false;
+    bool relative_pointer = false;
+    std::string lock_path;
+    std::string position_stream_path;
+    Timing get_position;
+    Timing warp;
+    Timing grab;
+    bool grab_succeeded = false;
+    double sampling_seconds = 0;
+    size_t motion_samples = 0;
+    double polling_rate_hz = 0;
+};
+
+Timing timing_from(std::vector<double> durations_us)
+{
+    Timing timing;
+    if (durations_us.empty())
+    {
+        return timing;
+    }
+    std::sort(durations_us.begin(), durations_us.end());
+    timing.min_us = durations_us.front();
+    timing.median_us = durations_us[durations_us.size() / 2];
+    timing.max_us = durations_us.back();
+    return timing;
+}
+
+void probe_display_server(GdkDisplay* gdk_display, ProbeResult& result)
+{
+    const char* session_type = g_getenv("XDG_SESSION_TYPE");
+    result.session_type = session_type ? session_type : "";
+#ifdef GDK_WINDOWING_X11
+    if (GDK_IS_X11_DISPLAY(gdk_display))
+    {
+        result.display_server = "x11";
+        Display* x_display = GDK_DISPLAY_XDISPLAY(gdk_display);
+        int opcode, event_base, error_base;
+        result.xfixes = XQueryExtension(x_display, "XFIXES", &opcode, &event_base, &error_base);
+#ifdef POINTER_LOCK_HAVE_XI2
+        if (XQueryExtension(x_display, "XInputExtension", &opcode, &event_base, &error_base))
+        {
+            int major = 2, minor = 2;
+            if (XIQueryVersion(x_display, &major, &minor) == Success)
+            {
+                result.xi2 = true;
+                result.xi2_major = major;
+                result.xi2_minor = minor;
+            }
+        }
+#endif
+    }
+#endif
+#ifdef GDK_WINDOWING_WAYLAND
+    if (GDK_IS_WAYLAND_DISPLAY(gdk_display))
+    {
+        result.display_server = "wayland";
+    }
+#endif
+}
+
+#ifdef POINTER_LOCK_HAVE_WAYLAND_CLIENT
+void registry_global_cb(void* data, wl_registry* registry, uint32_t name, const char* interface, uint32_t version)
+{
+    auto* result = static_cast<ProbeResult*>(data);
+    if (strcmp(interface, "zwp_pointer_constraints_v1") == 0)
+    {
+        result->pointer_constraints = true;
+    }
+    else if (strcmp(interface, "zwp_relative_pointer_manager_v1") == 0)
+    {
+        result->relative_pointer = true;
+    }
+}
+
+void registry_global_remove_cb(void* data, wl_registry* registry, uint32_t name)
+{
+}
+
+const wl_registry_listener registry_listener = {registry_global_cb, registry_global_remove_cb};
+#endif
+
+void probe_wayland_protocols(GdkDisplay* gdk_display, ProbeResult& result)
+{
+#if defined(GDK_WINDOWING_WAYLAND) && defined(POINTER_LOCK_HAVE_WAYLAND_CLIENT)
+    if (!GDK_IS_WAYLAND_DISPLAY(gdk_display))
+    {
+        return;
+    }
+    // A separate connection, so GDK's own registry handling isn't disturbed
+    wl_display* wl_display = wl_display_connect(nullptr);
+    if (!wl_display)
+    {
+        return;
+    }
+    wl_registry* registry = wl_display_get_registry(wl_display);
+    wl_registry_add_listener(registry, &registry_listener, &result);
+    wl_display_roundtrip(wl_display);
+    wl_registry_destroy(registry);
+    wl_display_disconnect(wl_display);
+#else
+    (void) gdk_display;
+    (void) result;
+#endif
+}
+
+// Describes the code paths the plug-in would choose, mirroring the decisions in the plug-in sources.
+void probe_input_paths(const pointer_lock::AsyncX11& x11, ProbeResult& result)
+{
+    if (result.display_server == "wayland")
+    {
+        result.lock_path = "GDK grab + warp (pointer may escape, pointer-constraints not used)";
+        result.position_stream_path = "frame-clock polling (global position not available on Wayland)";
+        return;
+    }
+    // See AsyncX11::grab_pointer
+    if (!x11.available())
+    {
+        result.lock_path = "GDK grab (not confined with XI2) + synchronous warp in captured-event handler";
+    }
+    else if (!x11.xi2())
+    {
+        result.lock_path = "core grab via XCB, confined to the window + non-blocking warp";
+    }
+    else if (result.xfixes)
+    {
+        result.lock_path = "XI2 grab via XCB, confined by pointer barriers (XFixes 5) + non-blocking warp";
+    }
+    else
+    {
+        result.lock_path = "XI2 grab via XCB (not confined, no XFixes) + non-blocking warp";
+    }
+#ifdef POINTER_LOCK_HAVE_XI2
+    result.position_stream_path = result.xi2 ? "XI2 raw motion on root window" : "frame-clock polling (no XI2)";
+#else
+    result.position_stream_path = "frame-clock polling (built without libXi)";
+#endif
+}
+
+struct PendingGrab
+{
+    bool done = false;
+    GdkGrabStatus status = GDK_GRAB_FAILED;
+};
+
+void grab_reply_cb(GdkGrabStatus status, gpointer user_data)
+{
+    auto* grab = static_cast<PendingGrab*>(user_data);
+    grab->done = true;
+    grab->status = status;
+}
+
+// Grabs the pointer the way the plug-in does, returning once the display server has answered.
+GdkGrabStatus grab_pointer_like_plugin(pointer_lock::AsyncX11& x11, GdkWindow* gdk_window, GdkEventMask mask)
+{
+    if (!x11.available())
+    {
+        return grab_pointer(gdk_window, mask);
+    }
+    PendingGrab grab;
+    x11.grab_pointer(gdk_window, true, mask, nullptr, gdk_window, grab_reply_cb, &grab);
+    while (!grab.done)
+    {
+        gtk_main_iteration();
+    }
+    return grab.status;
+}
+
+void ungrab_pointer_like_plugin(pointer_lock::AsyncX11& x11, GdkWindow* gdk_window)
+{
+    if (x11.available())
+    {
+        x11.ungrab_pointer();
+        return;
+    }
+    ungrab_pointer(gdk_window);
+}
+
+void measure_round_trips(GtkWidget* window, pointer_lock::AsyncX11& x11, ProbeResult& result)
+{
+    constexpr int kIterations = 50;
+    GdkWindow* gdk_window = gtk_widget_get_window(window);
+    GdkDisplay* gdk_display = gdk_window_get_display(gdk_window);
+    GdkDevice* gdk_pointer = gdk_seat_get_pointer(gdk_display_get_default_seat(gdk_display));
+    if (!gdk_pointer)
+    {
+        return;
+    }
+    std::vector<double> durations;
+    GdkScreen* gdk_screen = nullptr;
+    int x = 0, y = 0;
+    for (int i = 0; i < kIterations; i++)
+    {
+        const gint64 start = g_get_monotonic_time();
+        gdk_device_get_position(gdk_pointer, &gdk_screen, &x, &y);
+        durations.push_back(static_cast<double>(g_get_monotonic_time() - start));
+    }
+    result.get_position = timing_from(durations);
+    durations.clear();
+    for (int i = 0; i < kIterations; i++)
+    {
+        // Warp to where the pointer already is, so the user doesn't notice. Syncing makes the measurement include
+        // the round trip to the display server.
+        const gint64 start = g_get_monotonic_time();
+        gdk_device_warp(gdk_pointer, gdk_screen, x, y);
+        gdk_display_sync(gdk_display);
+        durations.push_back(static_cast<double>(g_get_monotonic_time() - start));
+    }
+    result.warp = timing_from(durations);
+    durations.clear();
+    const auto mask = static_cast<GdkEventMask>(GDK_POINTER_MOTION_MASK | GDK_BUTTON_PRESS_MASK |
+        GDK_BUTTON_RELEASE_MASK);
+    for (int i = 0; i < 10; i++)
+    {
+        const gint64 start = g_get_monotonic_time();
+        const GdkGrabStatus status = grab_pointer_like_plugin(x11, gdk_window, mask);
+        gdk_display_sync(gdk_display);
+        durations.push_back(static_cast<double>(g_get_monotonic_time() - start));
+        if (status != GDK_GRAB_SUCCESS)
+        {
+            return;
+        }
+        ungrab_pointer_like_plugin(x11, gdk_window);
+        gdk_display_sync(gdk_display);
+    }
+    result.grab_succeeded = true;
+    result.grab = timing_from(durations);
+}
+
+struct Sampling
+{
+    std::vector<int64_t> timestamps;
+};
+
+void sampling_batch_cb(const double* values, size_t length, gpointer user_data)
+{
+    auto* sampling = static_cast<Sampling*>(user_data);
+    const pointer_lock::BatchLayout layout(values, length);
+    if (!layout.valid())
+    {
+        return;
+    }
+    const double* kinds = layout.column(pointer_lock::kKindColumn);
+    const double* timestamps = layout.column(pointer_lock::kTimestampColumn);
+    for (size_t i = 0; i < layout.count(); i++)
+    {
+        if (pointer_lock::int_from_bits(kinds[i]) == static_cast<int64_t>(pointer_lock::EventKind::kMove))
+        {
+            sampling->timestamps.push_back(pointer_lock::int_from_bits(timestamps[i]));
+        }
+    }
+}
+
+void sampling_end_cb(gpointer user_data)
+{
+}
+
+gboolean quit_cb(gpointer user_data)
+{
+    gtk_main_quit();
+    return G_SOURCE_REMOVE;
+}
+
+// Locks the pointer with the plug-in's native session and measures how often motion arrives.
+void measure_polling_rate(GtkWidget* window, double seconds, ProbeResult& result)
+{
+    Sampling sampling;
+    pointer_lock::SessionConfig config;
+    pointer_lock::Session session(window, config, sampling_batch_cb, sampling_end_cb, &sampling);
+    session.add_subscription(0, pointer_lock::DeliveryPolicy::kEverySample);
+    if (session.start() != GDK_GRAB_SUCCESS)
+    {
+        return;
+    }
+    fprintf(stderr, "Move the mouse for %.0f seconds...\n", seconds);
+    g_timeout_add(static_cast<guint>(seconds * 1000), quit_cb, nullptr);
+    gtk_main();
+    session.stop();
+    result.sampling_seconds = seconds;
+    result.motion_samples = sampling.timestamps.size();
+    std::vector<double> intervals;
+    for (size_t i = 1; i < sampling.timestamps.size(); i++)
+    {
+        const int64_t interval = sampling.timestamps[i] - sampling.timestamps[i - 1];
+        // Longer gaps mean the mouse rested, which says nothing about the polling rate
+        if (interval > 0 && interval < 100000)
+        {
+            intervals.push_back(static_cast<double>(interval));
+        }
+    }
+    const Timing timing = timing_from(intervals);
+    if (timing.median_us > 0)
+    {
+        result.polling_rate_hz = 1e6 / timing.median_us;
+    }
+}
+
+void print_timing(const char* label, const Timing& timing)
+{
+    printf("  %-22s min %8.1f us   median %8.1f us   max %8.1f us\n", label, timing.min_us, timing.median_us,
+           timing.max_us);
+}
+
+void print_summary(const ProbeResult& result)
+{
+    printf("Display server:          %s (XDG_SESSION_TYPE=%s)\n", result.display_server.c_str(),
+           result.session_type.c_str());
+    printf("XInput 2:                %s", result.xi2 ? "yes" : "no");
+    if (result.xi2)
+    {
+        printf(" (%d.%d)", result.xi2_major, result.xi2_minor);
+    }
+    printf("\nXFixes:                  %s\n", result.xfixes ? "yes" : "no");
+    printf("Pointer constraints:     %s\n", result.pointer_constraints ? "yes" : "no");
+    printf("Relative pointer:        %s\n", result.relative_pointer ? "yes" : "no");
+    printf("Lock path:               %s\n", result.lock_path.c_str());
+    printf("Position stream path:    %s\n", result.position_stream_path.c_str());
+    printf("Latency:\n");
+    print_timing("get_position", result.get_position);
+    print_timing("warp", result.warp);
+    if (result.grab_succeeded)
+    {
+        print_timing("grab", result.grab);
+    }
+    else
+    {
+        printf("  %-22s failed\n", "grab");
+    }
+    printf("Motion samples:          %zu in %.1f s\n", result.motion_samples, result.sampling_seconds);
+    printf("Polling rate:            %.0f Hz\n", result.polling_rate_hz);
+}
+
+std::string json_string(const std::string& value)
+{
+    std::string escaped = "\"";
+    for (char c : value)
+    {
+        if (c == '"' || c == '\\')
+        {
+            escaped += '\\';
+        }
+        escaped += c;
+    }
+    return escaped + "\"";
+}
+
+std::string json_timing(const Timing& timing)
+{
+    char buffer[128];
+    snprintf(buffer, sizeof(buffer), "{\"minUs\": %.1f, \"medianUs\": %.1f, \"maxUs\": %.1f}", timing.min_us,
+             timing.median_us, timing.max_us);
+    return buffer;
+}
+
+void print_json(const ProbeResult& result)
+{
+    printf("{\n");
+    printf("  \"displayServer\": %s,\n", json_string(result.display_server).c_str());
+    printf("  \"sessionType\": %s,\n", json_string(result.session_type).c_str());
+    printf("  \"xi2\": %s,\n", result.xi2 ? "true" : "false");
+    printf("  \"xi2Version\": \"%d.%d\",\n", result.xi2_major, result.xi2_minor);
+    printf("  \"xfixes\": %s,\n", result.xfixes ? "true" : "false");
+    printf("  \"pointerConstraints\": %s,\n", result.pointer_constraints ? "true" : "false");
+    printf("  \"relativePointer\": %s,\n", result.relative_pointer ? "true" : "false");
+    printf("  \"lockPath\": %s,\n", json_string(result.lock_path).c_str());
+    printf("  \"positionStreamPath\": %s,\n", json_string(result.position_stream_path).c_str());
+    printf("  \"getPosition\": %s,\n", json_timing(result.get_position).c_str());
+    printf("  \"warp\": %s,\n", json_timing(result.warp).c_str());
+    printf("  \"grab\": %s,\n", result.grab_succeeded ? json_timing(result.grab).c_str() : "null");
+    printf("  \"samplingSeconds\": %.1f,\n", result.sampling_seconds);
+    printf("  \"motionSamples\": %zu,\n", result.motion_samples);
+    printf("  \"pollingRateHz\": %.1f\n", result.polling_rate_hz);
+    printf("}\n");
+}
+
+}  // namespace
+
+int main(int argc, char** argv)
+{
+    double seconds = 3;
+    bool json_only = false;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--duration") == 0 && i + 1 < argc)
+        {
+            seconds = std::max(atof(argv[++i]), 0.5);
+        }
+        else if (strcmp(argv[i], "--json") == 0)
+        {
+            json_only = true;
+        }
+        else
+        {
+            fprintf(stderr, "Usage: %s [--duration SECONDS] [--json]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (!gtk_init_check(&argc, &argv))
+    {
+        fprintf(stderr, "Couldn't open display\n");
+        return 1;
+    }
+    ProbeResult result;
+    GdkDisplay* gdk_display = gdk_display_get_default();
+    probe_display_server(gdk_display, result);
+    probe_wayland_protocols(gdk_display, result);
+    pointer_lock::AsyncX11 x11(gdk_display);
+    probe_input_paths(x11, result);
+
+    GtkWidget* window = gtk_window_new(GTK_WINDOW_TOPLEVEL);
+    gtk_window_set_title(GTK_WINDOW(window), "pointer_lock_probe");
+    gtk_window_set_default_size(GTK_WINDOW(window), 400, 300);
+    gtk_widget_show_all(window);
+    while (!gtk_widget_get_mapped(window))
+    {
+        gtk_main_iteration();
+    }
+    measure_round_trips(window, x11, result);
+    measure_polling_rate(window, seconds, result);
+    gtk_widget_destroy(window);
+
+    if (!json_only)
+    {
+        print_summary(result);
+        printf("\n");
+    }
+    print_json(result);
+    return 0;
+}
@@ -2,8 +2,17 @@
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
+#include <map>
+#include <utility>
+
+#include "include/pointer_lock/pointer_lock_pipeline.h"
 #include "include/pointer_lock/pointer_lock_plugin.h"
+#include "pointer_lock_clock.h"
+#include "pointer_lock_events.h"
+#include "pointer_lock_fan_out.h"
 #include "pointer_lock_plugin_private.h"
+#include "pointer_lock_session.h"
+#include "pointer_lock_stages.h"
 
 // This demonstrates a simple unit test of the C portion of this plugin's
 // implementation.
@@ -27,5 +36,461 @@ namespace test {
 //  EXPECT_THAT(fl_value_get_string(result), testing::StartsWith("Linux "));
 //}
 
+TEST(EventBatch, EncodesColumnByColumn) {
+  EventBatch batch;
+  Sample move;
+  move.dx = 3;
+  move.dy = -2;
+  move.timestamp_us = 1000;
+  batch.add(move);
+  Sample up;
+  up.kind = EventKind::kButtonUp;
+  up.button = 1;
+  up.timestamp_us = 2000;
+  batch.add(up);
+  const std::vector<double>& encoded = batch.encode(7);
+  ASSERT_EQ(encoded.size(), kBatchHeaderLength + 2 * kColumnCount);
+  EXPECT_EQ(int_from_bits(encoded[0]), 2);
+  EXPECT_EQ(int_from_bits(encoded[1]), 7);
+  const double* columns = encoded.data() + kBatchHeaderLength;
+  auto int_column = [&](Column column) {
+    return std::vector<int64_t>{int_from_bits(columns[column * 2]), int_from_bits(columns[column * 2 + 1])};
+  };
+  EXPECT_THAT(int_column(kKindColumn), testing::ElementsAre(0, 2));
+  EXPECT_THAT(std::vector<double>(columns + kDxColumn * 2, columns + kDxColumn * 2 + 2),
+              testing::ElementsAre(3, 0));
+  EXPECT_THAT(std::vector<double>(columns + kDyColumn * 2, columns + kDyColumn * 2 + 2),
+              testing::ElementsAre(-2, 0));
+  EXPECT_THAT(int_column(kTimestampColumn), testing::ElementsAre(1000, 2000));
+  EXPECT_THAT(int_column(kButtonColumn), testing::ElementsAre(0, 1));
+}
+
+TEST(EventBatch, EncodesOnlyRequestedColumns) {
+  EventBatch batch;
+  Sample move;
+  move.dx = 3;
+  move.value = 0.5;
+  move.physical_dx = 6;
+  batch.add(move);
+  const std::vector<double>& encoded = batch.encode(7, column_bit(kValueColumn));
+  const uint32_t columns = kBaseColumns | column_bit(kValueColumn);
+  EXPECT_EQ(int_from_bits(encoded[2]), columns);
+  // The 8 columns before filteredDx, then value, then the physical deltas
+  ASSERT_EQ(encoded.size(), kBatchHeaderLength + 11);
+  EXPECT_DOUBLE_EQ(encoded[kBatchHeaderLength + kDxColumn], 3);
+  EXPECT_DOUBLE_EQ(encoded[kBatchHeaderLength + 8], 0.5);
+  EXPECT_DOUBLE_EQ(encoded[kBatchHeaderLength + 9], 6);
+}
+
+TEST(BatchLayout, FindsColumnsOfPartialMask) {
+  EventBatch batch;
+  Sample move;
+  move.dx = 3;
+  move.timestamp_us = 1000;
+  move.value = 0.5;
+  move.physical_dx = 6;
+  batch.add(move);
+  Sample up;
+  up.kind = EventKind::kButtonUp;
+  up.timestamp_us = 2000;
+  up.value = 0.25;
+  batch.add(up);
+  const std::vector<double>& encoded = batch.encode(7, column_bit(kValueColumn));
+  const BatchLayout layout(encoded.data(), encoded.size());
+  ASSERT_TRUE(layout.valid());
+  EXPECT_EQ(layout.count(), 2u);
+  EXPECT_EQ(layout.column(kVelocityXColumn), nullptr);
+  const double* timestamps = layout.column(kTimestampColumn);
+  EXPECT_EQ(int_from_bits(timestamps[0]), 1000);
+  EXPECT_EQ(int_from_bits(timestamps[1]), 2000);
+  EXPECT_EQ(int_from_bits(layout.column(kKindColumn)[1]), static_cast<int64_t>(EventKind::kButtonUp));
+  EXPECT_DOUBLE_EQ(layout.column(kValueColumn)[1], 0.25);
+  EXPECT_DOUBLE_EQ(layout.column(kPhysicalDxColumn)[0], 6);
+  // Truncated
+  EXPECT_FALSE(BatchLayout(encoded.data(), encoded.size() - 1).valid());
+}
+
+Sample move_sample(double dx, double dy, int64_t timestamp_us) {
+  Sample sample;
+  sample.dx = dx;
+  sample.dy = dy;
+  sample.timestamp_us = timestamp_us;
+  return sample;
+}
+
+TEST(TransformStage, MapsAxesAndAppliesGain) {
+  TransformConfig config;
+  config.swap_axes = true;
+  config.invert_y = true;
+  config.gain_x = 2;
+  config.gain_y = 0.5;
+  TransformStage stage(config);
+  Sample sample = move_sample(3, 4, 1000);
+  stage.process(sample);
+  EXPECT_DOUBLE_EQ(sample.dx, 8);
+  EXPECT_DOUBLE_EQ(sample.dy, -1.5);
+}
+
+TEST(TransformStage, CarriesQuantizationRemainder) {
+  TransformConfig config;
+  config.gain_x = 0.3;
+  config.quantize = true;
+  TransformStage stage(config);
+  double total = 0;
+  for (int i = 1; i <= 10; i++) {
+    Sample sample = move_sample(1, 0, i * 1000);
+    stage.process(sample);
+    EXPECT_EQ(sample.dx, std::round(sample.dx));
+    total += sample.dx;
+  }
+  EXPECT_DOUBLE_EQ(total, 3);
+}
+
+TEST(AccelerationCurve, InterpolatesPiecewise) {
+  AccelerationCurve curve;
+  curve.type = AccelerationCurveType::kPiecewise;
+  curve.points = {{100, 1}, {1100, 3}};
+  EXPECT_DOUBLE_EQ(curve.factor_at(0), 1);
+  EXPECT_DOUBLE_EQ(curve.factor_at(600), 2);
+  EXPECT_DOUBLE_EQ(curve.factor_at(5000), 3);
+}
+
+TEST(FilterStage, FilteredDeltasAddUpToTotalMovement) {
+  FilterConfig config;
+  config.type = FilterType::kOneEuro;
+  config.min_cutoff = 1;
+  config.beta = 0.01;
+  FilterStage stage(config);
+  double total = 0;
+  for (int i = 1; i <= 50; i++) {
+    Sample sample = move_sample(2, 0, i * 1000);
+    stage.process(sample);
+    if (i == 2) {
+      // Lags behind at first
+      EXPECT_LT(sample.filtered_dx, 1);
+    }
+    total += sample.filtered_dx;
+  }
+  EXPECT_LT(total, 100);
+  // Rest
+  Sample rest = move_sample(0, 0, 60000);
+  EXPECT_TRUE(stage.settle(rest));
+  total += rest.filtered_dx;
+  EXPECT_DOUBLE_EQ(total, 100);
+  EXPECT_FALSE(stage.settle(rest));
+  // Starts over without lagging behind what was settled
+  Sample sample = move_sample(2, 0, 100000);
+  stage.process(sample);
+  EXPECT_DOUBLE_EQ(sample.filtered_dx, 2);
+}
+
+TEST(FilterStage, ConservesMovementWhenReconfigured) {
+  FilterConfig config;
+  config.type = FilterType::kEma;
+  config.alpha = 0.1;
+  FilterStage stage(config);
+  double total = 0;
+  for (int i = 1; i <= 20; i++) {
+    Sample sample = move_sample(2, 0, i * 1000);
+    stage.process(sample);
+    total += sample.filtered_dx;
+  }
+  EXPECT_LT(total, 40);
+  stage.reconfigure(FilterConfig());
+  Sample sample = move_sample(2, 0, 21000);
+  stage.process(sample);
+  total += sample.filtered_dx;
+  // Catches up with the lag in one go
+  EXPECT_DOUBLE_EQ(total, 42);
+}
+
+TEST(VelocityStage, EstimatesConstantAcceleration) {
+  VelocityStage stage(8);
+  // x(t) = 1000 * t^2 (t in seconds), so v(t) = 2000 * t and a = 2000
+  double previous_x = 0;
+  Sample sample;
+  for (int i = 1; i <= 20; i++) {
+    const double t = i / 1000.0;
+    const double x = 1000 * t * t;
+    sample = move_sample(x - previous_x, 0, i * 1000);
+    previous_x = x;
+    stage.process(sample);
+  }
+  EXPECT_NEAR(sample.velocity_x, 40, 1e-6);
+  EXPECT_NEAR(sample.acceleration_x, 2000, 1e-3);
+  EXPECT_DOUBLE_EQ(sample.velocity_y, 0);
+}
+
+TEST(VelocityStage, FitsShortWindowAtHighRate) {
+  VelocityStage stage(3);
+  // 8 kHz: x(t) = 100 * t + 5000 * t^2 (t in seconds), so v(t) = 100 + 10000 * t and a = 10000
+  double previous_x = 0;
+  Sample sample;
+  for (int i = 0; i <= 4; i++) {
+    const double t = i * 125e-6;
+    const double x = 100 * t + 5000 * t * t;
+    sample = move_sample(x - previous_x, 0, i * 125);
+    previous_x = x;
+    stage.process(sample);
+  }
+  EXPECT_NEAR(sample.velocity_x, 105, 1e-6);
+  EXPECT_NEAR(sample.acceleration_x, 10000, 1e-3);
+}
+
+TEST(PredictionStage, ExtrapolatesLinearlyAndConservesMovement) {
+  PredictionConfig config;
+  config.model = PredictionModel::kLinear;
+  config.window = 4;
+  config.max_horizon_us = 20000;
+  PredictionStage stage(config);
+  double total = 0;
+  Sample sample;
+  for (int i = 1; i <= 10; i++) {
+    // 1 pixel per millisecond, next frame 10 ms after the sample
+    sample = move_sample(1, 0, i * 1000);
+    stage.set_target_time(i * 1000 + 10000);
+    stage.process(sample);
+    total += sample.predicted_dx;
+  }
+  EXPECT_NEAR(total, 10 + 10, 1e-6);
+  EXPECT_DOUBLE_EQ(sample.prediction_confidence, 0.75);
+  // Rest, so the extrapolated offset goes away
+  Sample rest = move_sample(0, 0, 30000);
+  EXPECT_TRUE(stage.settle(rest));
+  total += rest.predicted_dx;
+  EXPECT_NEAR(total, 10, 1e-6);
+  EXPECT_DOUBLE_EQ(rest.prediction_confidence, 0);
+  EXPECT_FALSE(stage.settle(rest));
+}
+
+TEST(PredictionStage, ClampsDistance) {
+  PredictionConfig config;
+  config.model = PredictionModel::kLinear;
+  config.window = 2;
+  config.max_distance = 5;
+  PredictionStage stage(config);
+  Sample sample;
+  for (int i = 1; i <= 3; i++) {
+    sample = move_sample(10, 0, i * 1000);
+    stage.set_target_time(i * 1000 + 16000);
+    stage.process(sample);
+  }
+  EXPECT_DOUBLE_EQ(sample.predicted_dx, 10);
+  EXPECT_LT(sample.prediction_confidence, 0.1);
+}
+
+TEST(ValueStage, EmitsOnlyStepChanges) {
+  ValueConfig config;
+  config.enabled = true;
+  config.start = 0.5;
+  config.pixels_per_range = 100;
+  config.step = 0.1;
+  ValueStage stage(config);
+  int emitted = 0;
+  for (int i = 1; i <= 20; i++) {
+    // Up by 1 pixel = 0.01
+    Sample sample = move_sample(0, -1, i * 1000);
+    if (stage.process(sample)) {
+      emitted++;
+      EXPECT_NEAR(sample.value, 0.5 + 0.1 * emitted, 1e-9);
+    }
+  }
+  EXPECT_EQ(emitted, 2);
+  // Clamps at max and reacts immediately when going back
+  Sample up = move_sample(0, -1000, 30000);
+  ASSERT_TRUE(stage.process(up));
+  EXPECT_DOUBLE_EQ(up.value, 1);
+  Sample down = move_sample(0, 6, 31000);
+  ASSERT_TRUE(stage.process(down));
+  EXPECT_NEAR(down.value, 0.9, 1e-9);
+}
+
+TEST(ValueStage, WrapsAndAppliesFineFactor) {
+  ValueConfig config;
+  config.enabled = true;
+  config.min = 0;
+  config.max = 360;
+  config.pixels_per_range = 360;
+  config.wrap = true;
+  config.axis = ValueAxis::kHorizontal;
+  ValueStage stage(config);
+  Sample left = move_sample(-10, 0, 1000);
+  ASSERT_TRUE(stage.process(left));
+  EXPECT_DOUBLE_EQ(left.value, 350);
+  Sample fine = move_sample(10, 0, 2000);
+  fine.modifiers = kShiftModifier;
+  ASSERT_TRUE(stage.process(fine));
+  EXPECT_DOUBLE_EQ(fine.value, 351);
+}
+
+TEST(CursorStage, ClampsOrWrapsAtBounds) {
+  CursorConfig config;
+  config.enabled = true;
+  config.start_x = 50;
+  config.start_y = 50;
+  config.right = 100;
+  config.bottom = 100;
+  CursorStage clamping(config);
+  Sample sample = move_sample(80.5, -60, 1000);
+  clamping.process(sample);
+  EXPECT_DOUBLE_EQ(sample.cursor_x, 100);
+  EXPECT_DOUBLE_EQ(sample.cursor_y, 0);
+  config.wrap = true;
+  CursorStage wrapping(config);
+  sample = move_sample(80.5, -60, 1000);
+  wrapping.process(sample);
+  EXPECT_DOUBLE_EQ(sample.cursor_x, 30.5);
+  EXPECT_DOUBLE_EQ(sample.cursor_y, 90);
+}
+
+// Drops move samples shorter than one pixel
+struct DeadZoneStage {
+  bool process(Sample& sample) {
+    return sample.kind != EventKind::kMove || std::hypot(sample.dx, sample.dy) >= 1;
+  }
+};
+
+struct CountingStage {
+  int count = 0;
+  void process(const Sample&) { count++; }
+};
+
+TEST(Pipeline, RunsStagesInOrderUntilOneDropsTheSample) {
+  PipelineOf<StageList<TransformStage>, StageList<DeadZoneStage>, StageList<CountingStage>>::type pipeline;
+  TransformConfig config;
+  config.gain_x = 0.5;
+  pipeline.get<TransformStage>() = TransformStage(config);
+  Sample sample = move_sample(4, 0, 1000);
+  EXPECT_TRUE(pipeline.process(sample));
+  EXPECT_DOUBLE_EQ(sample.dx, 2);
+  // The transform halves this below the dead zone
+  sample = move_sample(1, 0, 2000);
+  EXPECT_FALSE(pipeline.process(sample));
+  sample = move_sample(0, 0, 3000);
+  sample.kind = EventKind::kButtonDown;
+  EXPECT_TRUE(pipeline.process(sample));
+  EXPECT_EQ(pipeline.get<CountingStage>().count, 2);
+  // Only the stages after the dead zone
+  sample = move_sample(0.1, 0, 4000);
+  EXPECT_TRUE(pipeline.process_after<DeadZoneStage>(sample));
+  EXPECT_DOUBLE_EQ(sample.dx, 0.1);
+  EXPECT_EQ(pipeline.get<CountingStage>().count, 3);
+}
+
+TEST(SessionPipeline, TakesPhysicalDeltasBeforeTheTransform) {
+  SessionPipeline pipeline;
+  TransformConfig config;
+  config.swap_axes = true;
+  config.gain_x = 3;
+  pipeline.get<TransformStage>() = TransformStage(config);
+  pipeline.get<PhysicalDeltaStage>().set_scale_factor(2);
+  Sample sample = move_sample(4, 1, 1000);
+  EXPECT_TRUE(pipeline.process(sample));
+  EXPECT_DOUBLE_EQ(sample.dx, 3);
+  EXPECT_DOUBLE_EQ(sample.dy, 4);
+  // Neither the gain nor the swapped axes
+  EXPECT_DOUBLE_EQ(sample.physical_dx, 8);
+  EXPECT_DOUBLE_EQ(sample.physical_dy, 2);
+}
+
+TEST(MotionHistory, EncodesRecentWindowOldestFirst) {
+  MotionHistory history(3);
+  for (int i = 1; i <= 5; i++) {
+    history.add(move_sample(i, -i, i * 1000));
+  }
+  Sample scroll = move_sample(9, 9, 5500);
+  scroll.kind = EventKind::kScroll;
+  history.add(scroll);
+  EXPECT_EQ(history.size(), 3u);
+  std::vector<double> encoded;
+  history.encode_since(4000, encoded);
+  EXPECT_THAT(encoded, testing::ElementsAre(2, 4000, 5000, 4, 5, -4, -5));
+  history.encode_since(0, encoded);
+  EXPECT_THAT(encoded, testing::ElementsAre(3, 3000, 4000, 5000, 3, 4, 5, -3, -4, -5));
+}
+
+TEST(FanOut, CoalescesPerSubscriptionPolicy) {
+  FanOut fan_out;
+  fan_out.add(1, DeliveryPolicy::kEverySample);
+  fan_out.add(2, DeliveryPolicy::kFrameSum);
+  fan_out.add(3, DeliveryPolicy::kLatestOnly);
+  // Subscription ID => (kind, dx) of each received sample
+  std::map<int64_t, std::vector<std::pair<int64_t, double>>> received;
+  // Subscription ID => predicted dx of each received sample
+  std::map<int64_t, std::vector<double>> predicted;
+  int batches = 0;
+  auto send = [&](const double* values, size_t length) {
+    batches++;
+    const auto count = static_cast<size_t>(int_from_bits(values[0]));
+    ASSERT_EQ(length, kBatchHeaderLength + count * kColumnCount);
+    const double* columns = values + kBatchHeaderLength;
+    for (size_t i = 0; i < count; i++) {
+      received[int_from_bits(values[1])].emplace_back(int_from_bits(columns[kKindColumn * count + i]),
+                                                      columns[kDxColumn * count + i]);
+      predicted[int_from_bits(values[1])].push_back(columns[kPredictedDxColumn * count + i]);
+    }
+  };
+  // Predicted offsets of 0.5 and 0.75 beyond the first and second sample
+  Sample first = move_sample(1, 0, 1000);
+  first.predicted_dx = 1.5;
+  Sample second = move_sample(2, 0, 2000);
+  second.predicted_dx = 2.25;
+  const PendingDelivery pending = fan_out.dispatch(first);
+  EXPECT_TRUE(pending.every_sample);
+  EXPECT_TRUE(pending.frame);
+  fan_out.dispatch(second);
+  Sample down = move_sample(0, 0, 3000);
+  down.kind = EventKind::kButtonDown;
+  fan_out.dispatch(down);
+  fan_out.dispatch(move_sample(4, 0, 4000));
+  EXPECT_TRUE(received.empty());
+  // All samples of the burst in one batch
+  fan_out.flush_every_sample(send);
+  EXPECT_EQ(batches, 1);
+  EXPECT_EQ(received[1].size(), 4u);
+  EXPECT_TRUE(received[2].empty());
+  fan_out.flush(send);
+  EXPECT_THAT(received[2], testing::ElementsAre(std::make_pair(0, 3), std::make_pair(1, 0), std::make_pair(0, 4)));
+  EXPECT_THAT(received[3], testing::ElementsAre(std::make_pair(0, 2), std::make_pair(1, 0), std::make_pair(0, 4)));
+  // The merged predicted delta is the merged delta plus the offset beyond the second sample.
+  EXPECT_DOUBLE_EQ(predicted[2][0], 3.75);
+  EXPECT_DOUBLE_EQ(predicted[3][0], 2.25);
+  fan_out.remove(2);
+  fan_out.remove(3);
+  EXPECT_FALSE(fan_out.dispatch(move_sample(1, 0, 5000)).frame);
+}
+
+TEST(EventClock, MapsServerTimeAcrossWraparound) {
+  EventClock clock;
+  clock.reset(EventClock::Source::kServer);
+  // The server time wraps around between the first two events. The second one arrives with less delay, which
+  // becomes the new estimate.
+  EXPECT_EQ(clock.map(0xFFFFFFFEu, 10000000), 10000000);
+  EXPECT_EQ(clock.map(3, 10004000), 10004000);
+  // This one is delayed by 3 ms. Only 1 us of that may be drift.
+  EXPECT_EQ(clock.map(5, 10009000), 10006001);
+  // A far bigger delay means the clock jumped, so it re-syncs.
+  EXPECT_EQ(clock.map(10, 20000000), 20000000);
+}
+
+TEST(EventClock, FollowsDriftSlowly) {
+  EventClock clock;
+  clock.reset(EventClock::Source::kServer);
+  EXPECT_EQ(clock.map(1000, 1000000), 1000000);
+  // 1 s later, the delay seems to be 2 ms. At most 0.5 ms of it is attributed to drift.
+  EXPECT_EQ(clock.map(2000, 2002000), 2000500);
+  // Results never go back in time
+  EXPECT_EQ(clock.map(1999, 2003000), 2000500);
+}
+
+TEST(EventClock, UsesMonotonicTimesDirectly) {
+  EventClock clock;
+  clock.reset(EventClock::Source::kMonotonic);
+  // Now is 2^32 + 500 ms, the event time has been truncated to 32 bits.
+  EXPECT_EQ(clock.map(498, 4294967796000), 4294967794000);
+  // Times which aren't monotonic after all are mapped like server times
+  EXPECT_EQ(clock.map(123456789, 4294968000000), 4294968000000);
+}
+
 }  // namespace test
 }  // namespace pointer_lock
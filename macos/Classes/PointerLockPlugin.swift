@@ -2,6 +2,8 @@ import Cocoa
 import FlutterMacOS
 
 public class PointerLockPlugin: NSObject, FlutterPlugin {
+  private var sessionHidCursor = false
+
   public static func register(with registrar: FlutterPluginRegistrar) {
     // Method channel
     let channel = FlutterMethodChannel(name: "pointer_lock", binaryMessenger: registrar.messenger)
@@ -18,6 +20,21 @@ public class PointerLockPlugin: NSObject, FlutterPlugin {
       CGAssociateMouseAndMouseCursorPosition(1)
       NSCursor.unhide()
       result(nil)
+    case "startSession":
+      let options = SessionOptions(arguments: call.arguments)
+      if options.hideCursor {
+        NSCursor.hide()
+      }
+      sessionHidCursor = options.hideCursor
+      CGAssociateMouseAndMouseCursorPosition(0)
+      result(nil)
+    case "endSession":
+      CGAssociateMouseAndMouseCursorPosition(1)
+      if sessionHidCursor {
+        NSCursor.unhide()
+      }
+      sessionHidCursor = false
+      result(nil)
     case "lockPointer":
       CGAssociateMouseAndMouseCursorPosition(0)
       result(nil)
@@ -44,15 +61,35 @@ public class PointerLockPlugin: NSObject, FlutterPlugin {
   }
 }
 
+/// Options passed by Dart when starting a session.
+///
+/// Older Dart code passes just the unlock-on-pointer-up flag, newer code passes a map with all options.
+struct SessionOptions {
+  var unlockOnPointerUp = false
+  var hideCursor = false
+
+  init(arguments: Any?) {
+    if let arguments = arguments as? Bool {
+      unlockOnPointerUp = arguments
+    } else if let arguments = arguments as? [String: Any] {
+      unlockOnPointerUp = arguments["unlockOnPointerUp"] as? Bool ?? false
+      hideCursor = arguments["cursor"] as? String == "hidden"
+    }
+  }
+}
+
 class PointerLockSessionStreamHandler: NSObject, FlutterStreamHandler {
   private var monitor: Any?
+  private var hidCursor = false
   
   public func onListen(withArguments arguments: Any?, eventSink events: @escaping FlutterEventSink) -> FlutterError? {
-    CGAssociateMouseAndMouseCursorPosition(0)
-    var unlockOnPointerUp = false
-    if let arguments = arguments as? Bool {
-        unlockOnPointerUp = arguments
+    let options = SessionOptions(arguments: arguments)
+    if options.hideCursor {
+      NSCursor.hide()
+      hidCursor = true
     }
+    CGAssociateMouseAndMouseCursorPosition(0)
+    let unlockOnPointerUp = options.unlockOnPointerUp
     monitor = NSEvent.addLocalMonitorForEvents(
       matching: [.mouseMoved, .leftMouseDragged, .rightMouseDragged, .otherMouseDragged, .leftMouseUp, .rightMouseUp, .otherMouseUp]
     ) { event in
@@ -82,7 +119,10 @@ class PointerLockSessionStreamHandler: NSObject, FlutterStreamHandler {
     }
     monitor = nil
     CGAssociateMouseAndMouseCursorPosition(1)
-    NSCursor.unhide()
+    if hidCursor {
+      NSCursor.unhide()
+      hidCursor = false
+    }
   }
 
   deinit {
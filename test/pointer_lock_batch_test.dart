@@ -0,0 +1,186 @@
+import 'dart:async';
+import 'dart:typed_data';
+import 'dart:ui';
+
+import 'package:flutter/foundation.dart';
+import 'package:flutter/services.dart';
+import 'package:flutter_test/flutter_test.dart';
+import 'package:pointer_lock/pointer_lock.dart';
+import 'package:pointer_lock/src/pointer_lock_batch.dart';
+import 'package:pointer_lock/src/pointer_lock_channel.dart';
+
+const _intColumns = {
+  NativeBatchColumn.kind,
+  NativeBatchColumn.timestamp,
+  NativeBatchColumn.button,
+  NativeBatchColumn.buttons,
+  NativeBatchColumn.modifiers,
+  NativeBatchColumn.device,
+};
+
+/// Encodes events like `EventBatch` in `pointer_lock_events.h`, with the base columns and the given ones. Values
+/// missing in an event are zero.
+Float64List encodeBatch(List<Map<NativeBatchColumn, num>> events, {Set<NativeBatchColumn> columns = const {}}) {
+  final contained = [
+    for (final column in NativeBatchColumn.values)
+      if (NativeBatchLayout.baseColumns.contains(column) || columns.contains(column)) column,
+  ];
+  final count = events.length;
+  final batch = Float64List(nativeBatchHeaderLength + contained.length * count);
+  final ints = Int64List.sublistView(batch);
+  ints[0] = count;
+  ints[2] = contained.fold(0, (mask, column) => mask | 1 << column.index);
+  for (var c = 0; c < contained.length; c++) {
+    for (var i = 0; i < count; i++) {
+      final value = events[i][contained[c]] ?? 0;
+      final index = nativeBatchHeaderLength + c * count + i;
+      if (_intColumns.contains(contained[c])) {
+        ints[index] = value.toInt();
+      } else {
+        batch[index] = value.toDouble();
+      }
+    }
+  }
+  return batch;
+}
+
+final _move = {
+  NativeBatchColumn.kind: PointerLockEventKind.move.index,
+  NativeBatchColumn.dx: 3,
+  NativeBatchColumn.buttons: 1,
+};
+final _up = {NativeBatchColumn.kind: PointerLockEventKind.buttonUp.index, NativeBatchColumn.button: 1};
+
+void main() {
+  TestWidgetsFlutterBinding.ensureInitialized();
+
+  group('batchNativeStream', () {
+    test('wraps the native columns without copying them', () async {
+      final payload = encodeBatch([_move, _up]);
+      final received = <String, List<Object>>{};
+      await batchNativeStream(Stream.value(payload)).forEach((batch) {
+        received['kinds'] = [for (var i = 0; i < batch.length; i++) batch.kindAt(i)];
+        received['button'] = batch.button.toList();
+        received['buttons'] = batch.buttons.toList();
+        // The columns are views on the payload.
+        payload[nativeBatchHeaderLength + NativeBatchColumn.dx.index * 2] = 42;
+        received['dx'] = batch.dx.toList();
+      });
+      expect(received['kinds'], [PointerLockEventKind.move, PointerLockEventKind.buttonUp]);
+      expect(received['button'], [0, 1]);
+      expect(received['buttons'], [1, 0]);
+      expect(received['dx'], [42, 0]);
+    });
+
+    test('recycles batches once the listener has returned', () async {
+      final batches = <PointerLockEventBatch>[];
+      final lengths = <int>[];
+      await batchNativeStream(Stream.fromIterable([
+        encodeBatch([_move]),
+        encodeBatch([_move, _up]),
+      ])).forEach((batch) {
+        batches.add(batch);
+        lengths.add(batch.length);
+      });
+      expect(lengths, [1, 2]);
+      expect(identical(batches[0], batches[1]), isTrue);
+    });
+
+    test('keeps the batches of a paused subscription', () async {
+      final source = StreamController<dynamic>(sync: true);
+      final lengths = <int>[];
+      final batches = <PointerLockEventBatch>[];
+      final subscription = batchNativeStream(source.stream).listen((batch) {
+        batches.add(batch);
+        lengths.add(batch.length);
+      });
+      subscription.pause();
+      source.add(encodeBatch([_move]));
+      source.add(encodeBatch([_move, _up]));
+      subscription.resume();
+      await pumpEventQueue();
+      expect(lengths, [1, 2]);
+      expect(identical(batches[0], batches[1]), isFalse);
+      await subscription.cancel();
+    });
+
+    test('drops malformed batches and batches with unknown kinds', () async {
+      final truncated = encodeBatch([_move, _up]);
+      final unknownKind = encodeBatch([
+        {NativeBatchColumn.kind: PointerLockEventKind.values.length},
+      ]);
+      final lengths = await batchNativeStream(Stream.fromIterable([
+        Float64List.sublistView(truncated, 0, truncated.length - 1),
+        unknownKind,
+        'not a batch',
+        encodeBatch([_up]),
+      ])).map((batch) => batch.length).toList();
+      expect(lengths, [1]);
+    });
+  });
+
+  group('batchEventStream', () {
+    test('groups the events of one turn of the event loop', () async {
+      final source = StreamController<PointerLockMoveEvent>(sync: true);
+      final received = <List<Object>>[];
+      final subscription = batchEventStream(source.stream).listen((batch) {
+        received.add([batch.dx.toList(), batch.button.toList(), batch.buttons.toList(), batch.deviceIds.toList()]);
+      });
+      source.add(PointerLockMoveEvent(delta: const Offset(1, 0), buttons: 1, deviceId: 7));
+      source.add(PointerLockMoveEvent(delta: Offset.zero, kind: PointerLockEventKind.buttonUp, button: 1));
+      await pumpEventQueue();
+      // Enough events to grow the storage
+      for (var i = 0; i < 20; i++) {
+        source.add(PointerLockMoveEvent(delta: Offset(i.toDouble(), 0)));
+      }
+      await pumpEventQueue();
+      expect(received, hasLength(2));
+      expect(received[0], [
+        [1, 0],
+        [0, 1],
+        [1, 0],
+        [7, 0],
+      ]);
+      expect(received[1][0], [for (var i = 0; i < 20; i++) i]);
+      await subscription.cancel();
+    });
+  });
+
+  group('batched sessions on Linux', () {
+    final platform = ChannelPointerLock();
+    const channel = EventChannel('pointer_lock_session');
+    final messenger = TestDefaultBinaryMessengerBinding.instance.defaultBinaryMessenger;
+
+    setUp(() {
+      debugDefaultTargetPlatformOverride = TargetPlatform.linux;
+    });
+
+    tearDown(() {
+      debugDefaultTargetPlatformOverride = null;
+      messenger.setMockStreamHandler(channel, null);
+    });
+
+    test('deliver the native batches', () async {
+      messenger.setMockStreamHandler(
+        channel,
+        MockStreamHandler.inline(onListen: (arguments, sink) {
+          sink.success(encodeBatch([_move, _up]));
+          sink.endOfStream();
+        }),
+      );
+      final kinds = <PointerLockEventKind>[];
+      await platform
+          .createBatchedSession(
+            windowsMode: PointerLockWindowsMode.capture,
+            cursor: PointerLockCursor.hidden,
+            unlockOnPointerUp: false,
+          )
+          .forEach((batch) {
+        for (var i = 0; i < batch.length; i++) {
+          kinds.add(batch.kindAt(i));
+        }
+      });
+      expect(kinds, [PointerLockEventKind.move, PointerLockEventKind.buttonUp]);
+    });
+  });
+}
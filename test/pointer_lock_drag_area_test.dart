@@ -0,0 +1,119 @@
+import 'dart:typed_data';
+
+import 'package:flutter/foundation.dart';
+import 'package:flutter/gestures.dart';
+import 'package:flutter/services.dart';
+import 'package:flutter/widgets.dart';
+import 'package:flutter_test/flutter_test.dart';
+import 'package:pointer_lock/pointer_lock.dart';
+import 'package:pointer_lock/src/pointer_lock_batch.dart';
+
+/// Encodes move events like the Linux session does, with the base columns only.
+Float64List moveBatch(List<Offset> deltas) {
+  const columns = NativeBatchLayout.baseColumns;
+  final count = deltas.length;
+  final batch = Float64List(nativeBatchHeaderLength + columns.length * count);
+  final ints = Int64List.sublistView(batch);
+  ints[0] = count;
+  ints[2] = columns.fold(0, (mask, column) => mask | 1 << column.index);
+  int start(NativeBatchColumn column) => nativeBatchHeaderLength + columns.indexOf(column) * count;
+  for (var i = 0; i < count; i++) {
+    // The kind (move) and the other columns stay zero.
+    batch[start(NativeBatchColumn.dx) + i] = deltas[i].dx;
+    batch[start(NativeBatchColumn.dy) + i] = deltas[i].dy;
+  }
+  return batch;
+}
+
+void main() {
+  const channel = EventChannel('pointer_lock_session');
+
+  testWidgets('delivers the movement once per frame', (tester) async {
+    debugDefaultTargetPlatformOverride = TargetPlatform.linux;
+    final messenger = tester.binding.defaultBinaryMessenger;
+    MockStreamHandlerEventSink? sink;
+    messenger.setMockStreamHandler(channel, MockStreamHandler.inline(onListen: (arguments, events) => sink = events));
+    final moves = <Offset>[];
+    final frames = <PointerLockDragFrameDetails>[];
+    var unlockCount = 0;
+    final dragOffset = ValueNotifier(const Offset(5, 5));
+    await tester.pumpWidget(Center(
+      child: PointerLockDragArea(
+        onMove: (details) => moves.add(details.move.delta),
+        onFrameMove: frames.add,
+        dragOffset: dragOffset,
+        onUnlock: (_) => unlockCount++,
+        child: const SizedBox(width: 100, height: 100),
+      ),
+    ));
+
+    final gesture = await tester.startGesture(
+      tester.getCenter(find.byType(PointerLockDragArea)),
+      kind: PointerDeviceKind.mouse,
+      buttons: kPrimaryButton,
+    );
+    await tester.idle();
+    expect(sink, isNotNull);
+    expect(dragOffset.value, Offset.zero);
+
+    sink!.success(moveBatch(const [Offset(1, 0), Offset(2, 0)]));
+    sink!.success(moveBatch(const [Offset(3, 1)]));
+    await tester.idle();
+    // Each move right away, but nothing per frame before the frame
+    expect(moves, const [Offset(1, 0), Offset(2, 0), Offset(3, 1)]);
+    expect(frames, isEmpty);
+
+    await tester.pump();
+    expect(frames, hasLength(1));
+    expect(frames.single.delta, const Offset(6, 1));
+    expect(frames.single.sampleCount, 3);
+    expect(dragOffset.value, const Offset(6, 1));
+
+    // Frames without movement don't deliver anything
+    await tester.pump();
+    expect(frames, hasLength(1));
+
+    // Unlocking delivers the movement of the last frame right away
+    sink!.success(moveBatch(const [Offset(0, 2)]));
+    await tester.idle();
+    await gesture.up();
+    expect(frames, hasLength(2));
+    expect(frames.last.delta, const Offset(0, 2));
+    expect(frames.last.sampleCount, 1);
+    expect(dragOffset.value, const Offset(6, 3));
+    expect(unlockCount, 1);
+
+    messenger.setMockStreamHandler(channel, null);
+    debugDefaultTargetPlatformOverride = null;
+  });
+
+  testWidgets('ignores events other than moves', (tester) async {
+    debugDefaultTargetPlatformOverride = TargetPlatform.linux;
+    final messenger = tester.binding.defaultBinaryMessenger;
+    MockStreamHandlerEventSink? sink;
+    messenger.setMockStreamHandler(channel, MockStreamHandler.inline(onListen: (arguments, events) => sink = events));
+    final frames = <PointerLockDragFrameDetails>[];
+    await tester.pumpWidget(Center(
+      child: PointerLockDragArea(
+        onFrameMove: frames.add,
+        child: const SizedBox(width: 100, height: 100),
+      ),
+    ));
+    final gesture = await tester.startGesture(
+      tester.getCenter(find.byType(PointerLockDragArea)),
+      kind: PointerDeviceKind.mouse,
+      buttons: kPrimaryButton,
+    );
+    await tester.idle();
+    final scroll = moveBatch(const [Offset(0, 1)]);
+    Int64List.sublistView(scroll)[nativeBatchHeaderLength] = PointerLockEventKind.scroll.index;
+    sink!.success(scroll);
+    await tester.idle();
+    await tester.pump();
+    expect(frames, isEmpty);
+
+    await gesture.up();
+    messenger.setMockStreamHandler(channel, null);
+    debugDefaultTargetPlatformOverride = null;
+  });
+}
@@ -0,0 +1,211 @@
+import 'dart:async';
+import 'dart:typed_data';
+import 'dart:ui';
+
+import 'package:flutter/foundation.dart';
+import 'package:flutter/services.dart';
+import 'package:flutter_test/flutter_test.dart';
+import 'package:pointer_lock/pointer_lock.dart';
+import 'package:pointer_lock/src/pointer_lock_channel.dart';
+import 'package:pointer_lock/src/pointer_lock_shared_session.dart';
+
+PointerLockMoveEvent move(double dx, double dy, {Offset? predictedDelta}) {
+  return PointerLockMoveEvent(delta: Offset(dx, dy), predictedDelta: predictedDelta);
+}
+
+final _down = PointerLockMoveEvent(delta: Offset.zero, kind: PointerLockEventKind.buttonDown, button: 1);
+
+List<Object> describe(PointerLockMoveEvent event) => [event.kind, event.delta];
+
+void main() {
+  group('$DartSharedSession', () {
+    testWidgets('delivers the events to each subscription according to its policy', (tester) async {
+      final source = StreamController<PointerLockMoveEvent>(sync: true);
+      var sessionCount = 0;
+      final session = DartSharedSession(() {
+        sessionCount++;
+        return source.stream;
+      });
+      final received = <PointerLockDeliveryPolicy, List<PointerLockMoveEvent>>{};
+      final subscriptions = [
+        for (final policy in PointerLockDeliveryPolicy.values)
+          session.subscribe(policy: policy).listen((received[policy] = []).add),
+      ];
+      expect(sessionCount, 1);
+
+      source.add(move(1, 0, predictedDelta: const Offset(2, 0)));
+      source.add(move(2, 0, predictedDelta: const Offset(3, 1)));
+      source.add(_down);
+      source.add(move(3, 1));
+      await tester.idle();
+      final everySample = received[PointerLockDeliveryPolicy.everySample]!;
+      expect(everySample.map(describe), [
+        [PointerLockEventKind.move, const Offset(1, 0)],
+        [PointerLockEventKind.move, const Offset(2, 0)],
+        [PointerLockEventKind.buttonDown, Offset.zero],
+        [PointerLockEventKind.move, const Offset(3, 1)],
+      ]);
+      expect(received[PointerLockDeliveryPolicy.frameSum], isEmpty);
+      expect(received[PointerLockDeliveryPolicy.latestOnly], isEmpty);
+
+      await tester.pump();
+      final frameSum = received[PointerLockDeliveryPolicy.frameSum]!;
+      // Button events aren't coalesced and keep their place between the moves
+      expect(frameSum.map(describe), [
+        [PointerLockEventKind.move, const Offset(3, 0)],
+        [PointerLockEventKind.buttonDown, Offset.zero],
+        [PointerLockEventKind.move, const Offset(3, 1)],
+      ]);
+      expect(frameSum.first.predictedDelta, const Offset(5, 1));
+      expect(received[PointerLockDeliveryPolicy.latestOnly]!.map(describe), [
+        [PointerLockEventKind.move, const Offset(2, 0)],
+        [PointerLockEventKind.buttonDown, Offset.zero],
+        [PointerLockEventKind.move, const Offset(3, 1)],
+      ]);
+      expect(everySample, hasLength(4));
+
+      // The session ends with the last subscription
+      await subscriptions[0].cancel();
+      await subscriptions[1].cancel();
+      expect(source.hasListener, isTrue);
+      await subscriptions[2].cancel();
+      expect(source.hasListener, isFalse);
+    });
+
+    testWidgets('delivers held back events first when the policy changes', (tester) async {
+      final source = StreamController<PointerLockMoveEvent>(sync: true);
+      final session = DartSharedSession(() => source.stream);
+      final stream = session.subscribe(policy: PointerLockDeliveryPolicy.frameSum);
+      final received = <PointerLockMoveEvent>[];
+      final subscription = stream.listen(received.add);
+
+      source.add(move(1, 0));
+      source.add(move(2, 0));
+      await session.updateSubscription(stream, PointerLockDeliveryPolicy.everySample);
+      source.add(move(0, 4));
+      await tester.idle();
+      expect(received.map(describe), [
+        [PointerLockEventKind.move, const Offset(3, 0)],
+        [PointerLockEventKind.move, const Offset(0, 4)],
+      ]);
+
+      // Nothing is left for the frame
+      await tester.pump();
+      expect(received, hasLength(2));
+      await subscription.cancel();
+    });
+
+    testWidgets('delivers held back events when the session ends', (tester) async {
+      final source = StreamController<PointerLockMoveEvent>(sync: true);
+      final session = DartSharedSession(() => source.stream);
+      final received = <PointerLockMoveEvent>[];
+      final done = session.subscribe(policy: PointerLockDeliveryPolicy.latestOnly).listen(received.add).asFuture();
+
+      source.add(move(1, 0));
+      source.add(move(2, 0));
+      await source.close();
+      await done;
+      expect(received.map(describe), [
+        [PointerLockEventKind.move, const Offset(2, 0)],
+      ]);
+    });
+
+    test('rejects streams of other sessions', () async {
+      final session = DartSharedSession(() => const Stream.empty());
+      final other = DartSharedSession(() => const Stream.empty());
+      await expectLater(
+        session.updateSubscription(other.subscribe(), PointerLockDeliveryPolicy.latestOnly),
+        throwsArgumentError,
+      );
+    });
+  });
+
+  group('shared sessions on platforms without native fan-out', () {
+    final platform = ChannelPointerLock();
+    const channel = EventChannel('pointer_lock_session');
+
+    testWidgets('share one native session', (tester) async {
+      debugDefaultTargetPlatformOverride = TargetPlatform.macOS;
+      final messenger = tester.binding.defaultBinaryMessenger;
+      var listenCount = 0;
+      MockStreamHandlerEventSink? sink;
+      messenger.setMockStreamHandler(
+        channel,
+        MockStreamHandler.inline(onListen: (arguments, events) {
+          listenCount++;
+          sink = events;
+        }),
+      );
+      final session = platform.createSharedSession(
+        windowsMode: PointerLockWindowsMode.capture,
+        cursor: PointerLockCursor.hidden,
+        unlockOnPointerUp: false,
+      );
+      final everySample = <Offset>[];
+      final frameSum = <Offset>[];
+      final subscriptions = [
+        session.subscribe().listen((event) => everySample.add(event.delta)),
+        session.subscribe(policy: PointerLockDeliveryPolicy.frameSum).listen((event) => frameSum.add(event.delta)),
+      ];
+      await tester.idle();
+      expect(listenCount, 1);
+
+      // macOS sends single deltas
+      sink!.success(Float64List.fromList([1, 2]));
+      sink!.success(Float64List.fromList([3, 4]));
+      await tester.idle();
+      expect(everySample, const [Offset(1, 2), Offset(3, 4)]);
+      expect(frameSum, isEmpty);
+      await tester.pump();
+      expect(frameSum, const [Offset(4, 6)]);
+
+      for (final subscription in subscriptions) {
+        await subscription.cancel();
+      }
+      messenger.setMockStreamHandler(channel, null);
+      debugDefaultTargetPlatformOverride = null;
+    });
+  });
+
+  group('native shared sessions', () {
+    final platform = ChannelPointerLock();
+    const channel = EventChannel('pointer_lock_session');
+
+    testWidgets('reject other sessions while listened to', (tester) async {
+      debugDefaultTargetPlatformOverride = TargetPlatform.linux;
+      final messenger = tester.binding.defaultBinaryMessenger;
+      var listenCount = 0;
+      messenger.setMockStreamHandler(
+        channel,
+        MockStreamHandler.inline(onListen: (arguments, events) => listenCount++),
+      );
+      final session = platform.createSharedSession(
+        windowsMode: PointerLockWindowsMode.capture,
+        cursor: PointerLockCursor.hidden,
+        unlockOnPointerUp: false,
+      );
+      final subscription = session.subscribe().listen(null);
+      await tester.idle();
+      final errors = <Object>[];
+      var done = false;
+      platform
+          .createConfinedSession(rect: Rect.largest, cursor: PointerLockCursor.normal, unlockOnPointerUp: false)
+          .listen(null, onError: errors.add, onDone: () => done = true);
+      await tester.idle();
+      expect(errors.single, isStateError);
+      expect(done, isTrue);
+      expect(listenCount, 1);
+
+      // Once the shared session ends, other sessions can start again.
+      await subscription.cancel();
+      final other = platform
+          .createConfinedSession(rect: Rect.largest, cursor: PointerLockCursor.normal, unlockOnPointerUp: false)
+          .listen(null);
+      await tester.idle();
+      expect(listenCount, 2);
+      await other.cancel();
+      messenger.setMockStreamHandler(channel, null);
+      debugDefaultTargetPlatformOverride = null;
+    });
+  });
+}
@@ -0,0 +1,93 @@
+import 'dart:typed_data';
+import 'dart:ui';
+
+import 'package:flutter/foundation.dart';
+import 'package:flutter/services.dart';
+import 'package:flutter_test/flutter_test.dart';
+import 'package:pointer_lock/pointer_lock.dart';
+import 'package:pointer_lock/src/pointer_lock_channel.dart';
+import 'package:pointer_lock/src/pointer_lock_value_mapper.dart';
+
+PointerLockMoveEvent move(double dx, double dy, {int modifiers = 0}) {
+  return PointerLockMoveEvent(delta: Offset(dx, dy), modifiers: PointerLockModifiers.fromBits(modifiers));
+}
+
+void main() {
+  TestWidgetsFlutterBinding.ensureInitialized();
+
+  group('$ValueMapper', () {
+    test('emits only step changes', () {
+      final mapper = ValueMapper(const PointerLockValueMode(start: 0.5, pixelsPerRange: 100, step: 0.1));
+      final values = [
+        // Up by 1 pixel = 0.01
+        for (var i = 0; i < 20; i++) ...mapper.map(move(0, -1)).map((event) => event.value),
+      ];
+      expect(values, [closeTo(0.6, 1e-9), closeTo(0.7, 1e-9)]);
+    });
+
+    test('clamps at the bounds and reacts immediately when going back', () {
+      final mapper = ValueMapper(const PointerLockValueMode(start: 0.5, pixelsPerRange: 100, step: 0.1));
+      expect(mapper.map(move(0, -1000)).single.value, 1);
+      expect(mapper.map(move(0, 6)).single.value, closeTo(0.9, 1e-9));
+    });
+
+    test('wraps around and applies the fine factor', () {
+      final mapper = ValueMapper(const PointerLockValueMode(
+        start: 0.9,
+        pixelsPerRange: 100,
+        wrap: true,
+        axis: PointerLockValueAxis.horizontal,
+      ));
+      expect(mapper.map(move(20, 0)).single.value, closeTo(0.1, 1e-9));
+      // Shift is the default fine modifier
+      expect(mapper.map(move(10, 0, modifiers: 1)).single.value, closeTo(0.11, 1e-9));
+    });
+
+    test('passes other events on with the current value', () {
+      final mapper = ValueMapper(const PointerLockValueMode(start: 0.25));
+      final down = PointerLockMoveEvent(delta: Offset.zero, kind: PointerLockEventKind.buttonDown, button: 1);
+      final mapped = mapper.map(down).single;
+      expect(mapped.kind, PointerLockEventKind.buttonDown);
+      expect(mapped.button, 1);
+      expect(mapped.value, 0.25);
+    });
+  });
+
+  group('value mode on platforms without native value mapping', () {
+    final platform = ChannelPointerLock();
+    const channel = EventChannel('pointer_lock_session');
+    final messenger = TestDefaultBinaryMessengerBinding.instance.defaultBinaryMessenger;
+
+    setUp(() {
+      debugDefaultTargetPlatformOverride = TargetPlatform.macOS;
+    });
+
+    tearDown(() {
+      debugDefaultTargetPlatformOverride = null;
+      messenger.setMockStreamHandler(channel, null);
+    });
+
+    test('maps the native deltas to values', () async {
+      messenger.setMockStreamHandler(
+        channel,
+        MockStreamHandler.inline(onListen: (arguments, sink) {
+          // macOS sends single deltas
+          for (final dy in [-5.0, -10.0, -80.0]) {
+            sink.success(Float64List.fromList([0, dy]));
+          }
+          sink.endOfStream();
+        }),
+      );
+      final events = await platform
+          .createSession(
+            windowsMode: PointerLockWindowsMode.capture,
+            cursor: PointerLockCursor.hidden,
+            unlockOnPointerUp: false,
+            valueMode: const PointerLockValueMode(pixelsPerRange: 100, step: 0.2),
+          )
+          .toList();
+      // The first delta doesn't get halfway to the next step
+      expect(events.map((event) => event.value), [closeTo(0.2, 1e-9), 1]);
+    });
+  });
+}
@@ -0,0 +1,93 @@
+import 'dart:typed_data';
+import 'dart:ui';
+
+import 'package:flutter/foundation.dart';
+import 'package:flutter/services.dart';
+import 'package:flutter_test/flutter_test.dart';
+import 'package:pointer_lock/pointer_lock.dart';
+import 'package:pointer_lock/src/pointer_lock_channel.dart';
+import 'package:pointer_lock/src/pointer_lock_value_mapper.dart';
+
+PointerLockMoveEvent move(double dx, double dy) {
+  return PointerLockMoveEvent(delta: Offset(dx, dy));
+}
+
+void main() {
+  TestWidgetsFlutterBinding.ensureInitialized();
+
+  group('$VirtualCursorIntegrator', () {
+    test('starts at the cursor position and clamps at the bounds', () {
+      final cursor = PointerLockVirtualCursor(bounds: const Rect.fromLTRB(0, 0, 100, 50));
+      final integrator = VirtualCursorIntegrator(cursor);
+      expect(integrator.map(move(10, -5)).cursorPosition, const Offset(60, 20));
+      expect(integrator.map(move(100, -100)).cursorPosition, const Offset(100, 0));
+      expect(cursor.position.value, const Offset(100, 0));
+      // Reacts immediately when going back
+      expect(integrator.map(move(-1, 1)).cursorPosition, const Offset(99, 1));
+    });
+
+    test('wraps around at the edges', () {
+      final cursor = PointerLockVirtualCursor(
+        bounds: const Rect.fromLTRB(0, 0, 100, 100),
+        start: const Offset(90, 10),
+        wrap: true,
+      );
+      final integrator = VirtualCursorIntegrator(cursor);
+      expect(integrator.map(move(20, -20)).cursorPosition, const Offset(10, 90));
+    });
+
+    test('keeps the position for other events', () {
+      final cursor = PointerLockVirtualCursor(bounds: const Rect.fromLTRB(0, 0, 100, 100));
+      final integrator = VirtualCursorIntegrator(cursor);
+      final scroll = PointerLockMoveEvent(delta: const Offset(0, 3), kind: PointerLockEventKind.scroll);
+      final mapped = integrator.map(scroll);
+      expect(mapped.kind, PointerLockEventKind.scroll);
+      expect(mapped.delta, const Offset(0, 3));
+      expect(mapped.cursorPosition, const Offset(50, 50));
+      expect(cursor.position.value, const Offset(50, 50));
+    });
+
+    test('consecutive sessions continue where the previous one stopped', () {
+      final cursor = PointerLockVirtualCursor(bounds: const Rect.fromLTRB(0, 0, 100, 100));
+      VirtualCursorIntegrator(cursor).map(move(5, 5));
+      expect(VirtualCursorIntegrator(cursor).map(move(5, 5)).cursorPosition, const Offset(60, 60));
+    });
+  });
+
+  group('virtual cursor on platforms without native integration', () {
+    final platform = ChannelPointerLock();
+    const channel = EventChannel('pointer_lock_session');
+    final messenger = TestDefaultBinaryMessengerBinding.instance.defaultBinaryMessenger;
+
+    setUp(() {
+      debugDefaultTargetPlatformOverride = TargetPlatform.macOS;
+    });
+
+    tearDown(() {
+      debugDefaultTargetPlatformOverride = null;
+      messenger.setMockStreamHandler(channel, null);
+    });
+
+    test('moves the cursor by the native deltas', () async {
+      messenger.setMockStreamHandler(
+        channel,
+        MockStreamHandler.inline(onListen: (arguments, sink) {
+          sink.success(Float64List.fromList([3, 4]));
+          sink.success(Float64List.fromList([-1, 2]));
+          sink.endOfStream();
+        }),
+      );
+      final cursor = PointerLockVirtualCursor(bounds: const Rect.fromLTRB(0, 0, 20, 20), start: Offset.zero);
+      final events = await platform
+          .createSession(
+            windowsMode: PointerLockWindowsMode.capture,
+            cursor: PointerLockCursor.hidden,
+            unlockOnPointerUp: false,
+            virtualCursor: cursor,
+          )
+          .toList();
+      expect(events.map((event) => event.cursorPosition), const [Offset(3, 4), Offset(2, 6)]);
+      expect(cursor.position.value, const Offset(2, 6));
+    });
+  });
+}
@@ -13,6 +13,7 @@
 
 #include <memory>
 #include <sstream>
+#include <string>
 #include <hidusage.h>
 #include <windowsx.h>
 
@@ -30,6 +31,35 @@ namespace pointer_lock {
 		return 0;
 	}
 
+	// Options passed by Dart when starting a session. Older Dart code passes just the unlock-on-pointer-up flag, newer
+	// code passes a map with all options.
+	struct SessionOptions {
+		bool unlock_on_pointer_up = false;
+		bool hide_cursor = false;
+
+		explicit SessionOptions(const flutter::EncodableValue* arguments) {
+			if (!arguments) {
+				return;
+			}
+			if (std::holds_alternative<bool>(*arguments)) {
+				unlock_on_pointer_up = std::get<bool>(*arguments);
+				return;
+			}
+			if (!std::holds_alternative<flutter::EncodableMap>(*arguments)) {
+				return;
+			}
+			const auto& map = std::get<flutter::EncodableMap>(*arguments);
+			const auto unlock = map.find(flutter::EncodableValue("unlockOnPointerUp"));
+			if (unlock != map.end() && std::holds_alternative<bool>(unlock->second)) {
+				unlock_on_pointer_up = std::get<bool>(unlock->second);
+			}
+			const auto cursor = map.find(flutter::EncodableValue("cursor"));
+			if (cursor != map.end() && std::holds_alternative<std::string>(cursor->second)) {
+				hide_cursor = std::get<std::string>(cursor->second) == "hidden";
+			}
+		}
+	};
+
 	// static
 	void PointerLockPlugin::RegisterWithRegistrar(
 		flutter::PluginRegistrarWindows* registrar) {
@@ -51,7 +81,7 @@ namespace pointer_lock {
 				plugin_pointer->HandleMethodCall(call, std::move(result));
 			}
 		);
-		event_channel->SetStreamHandler(std::make_unique<PointerLockSessionStreamHandler>(registrar));
+		event_channel->SetStreamHandler(std::make_unique<PointerLockSessionStreamHandler>(registrar, plugin.get()));
 
 		registrar->AddPlugin(std::move(plugin));
 	}
@@ -89,6 +119,35 @@ namespace pointer_lock {
 			};
 			result->Success(flutter::EncodableValue(std::move(vec)));
 		}
+		else if (method_call.method_name().compare("startSession") == 0) {
+			// Used in clip mode, in which the Flutter Engine still receives the mouse events. Does what
+			// "hidePointer", "subscribeToRawInputData" and "lockPointer" do, so the session starts with one message.
+			const SessionOptions options(method_call.arguments());
+			POINT cursor_pos;
+			if (!GetCursorPos(&cursor_pos)) {
+				result->Error("UNAVAILABLE", "Couldn't get current cursor position");
+				return;
+			}
+			if (!SubscribeToRawInputData()) {
+				result->Error("UNAVAILABLE", "Couldn't subscribe to raw input data");
+				return;
+			}
+			if (options.hide_cursor) {
+				this->SetPointerVisible(false);
+			}
+			session_hid_cursor_ = options.hide_cursor;
+			RECT rect{ cursor_pos.x, cursor_pos.y, cursor_pos.x, cursor_pos.y };
+			ClipCursor(&rect);
+			result->Success();
+		}
+		else if (method_call.method_name().compare("endSession") == 0) {
+			ClipCursor(NULL);
+			if (session_hid_cursor_) {
+				this->SetPointerVisible(true);
+			}
+			session_hid_cursor_ = false;
+			result->Success();
+		}
 		else if (method_call.method_name().compare("lockPointer") == 0) {
 			POINT cursor_pos;
 			if (!GetCursorPos(&cursor_pos)) {
@@ -189,28 +248,32 @@ namespace pointer_lock {
 		return raw_input_data_proc_id_.has_value();
 	}
 
-	PointerLockSessionStreamHandler::PointerLockSessionStreamHandler(flutter::PluginRegistrarWindows* registrar) {
+	PointerLockSessionStreamHandler::PointerLockSessionStreamHandler(flutter::PluginRegistrarWindows* registrar, PointerLockPlugin* plugin) {
 		registrar_ = registrar;
+		plugin_ = plugin;
 	}
 
 	std::unique_ptr<flutter::StreamHandlerError<flutter::EncodableValue>> PointerLockSessionStreamHandler::OnListenInternal(
 		const flutter::EncodableValue* arguments,
 		std::unique_ptr<flutter::EventSink<flutter::EncodableValue>>&& events
 	) {
-		bool unlockOnPointerUp = false;
-		if (arguments) {
-			if (std::holds_alternative<bool>(*arguments)) {
-				const auto& value = std::get<bool>(*arguments);
-				unlockOnPointerUp = value;
-			}
+		const SessionOptions options(arguments);
+		// Hiding the cursor here (instead of via "hidePointer") saves Dart a round trip before the session starts.
+		if (options.hide_cursor) {
+			plugin_->SetPointerVisible(false);
 		}
-		session_ = std::make_unique<PointerLockSession>(registrar_, std::move(events), unlockOnPointerUp);
+		hid_cursor_ = options.hide_cursor;
+		session_ = std::make_unique<PointerLockSession>(registrar_, std::move(events), options.unlock_on_pointer_up);
 		return nullptr;
 	}
 
 	std::unique_ptr<flutter::StreamHandlerError<flutter::EncodableValue>> PointerLockSessionStreamHandler::OnCancelInternal(const flutter::EncodableValue* arguments) {
 		// This clears the session object, causing its destrutor to run, which in turn releases the capture.
 		session_.reset();
+		if (hid_cursor_) {
+			plugin_->SetPointerVisible(true);
+			hid_cursor_ = false;
+		}
 		return nullptr;
 	}
 
@@ -26,11 +26,17 @@ class PointerLockPlugin : public flutter::Plugin {
       const flutter::MethodCall<flutter::EncodableValue> &method_call,
       std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result);
 
+  // Shows or hides the cursor, unless it's already in the desired state.
+  void SetPointerVisible(bool visible);
+
  private:
    flutter::PluginRegistrarWindows* registrar_;
 
    bool pointer_visible_ = true;
 
+   // Whether the session started via "startSession" hid the cursor, which "endSession" undoes.
+   bool session_hid_cursor_ = false;
+
    // ID of the WindowProcDelegate registration in case we are subscribed to raw input data.
    // For being able to unregister it at the end.
    std::optional<int> raw_input_data_proc_id_;
@@ -39,7 +45,6 @@ class PointerLockPlugin : public flutter::Plugin {
    LONG last_x_delta_ = 0;
    LONG last_y_delta_ = 0;
 
-   void SetPointerVisible(bool visible);
    bool SubscribeToRawInputData();
    void UnsubscribeFromRawInputData();
    bool SubscribedToRawInputData();
@@ -66,7 +71,7 @@ private:
 
 class PointerLockSessionStreamHandler : public flutter::StreamHandler<flutter::EncodableValue> {
 public:
-  PointerLockSessionStreamHandler(flutter::PluginRegistrarWindows* registrar);
+  PointerLockSessionStreamHandler(flutter::PluginRegistrarWindows* registrar, PointerLockPlugin* plugin);
 
 protected:
   // Called when a pointer lock session is requested.
@@ -77,6 +82,12 @@ protected:
 
 private:
   flutter::PluginRegistrarWindows* registrar_;
+
+  // For hiding and showing the cursor. Owned by the registrar, so it lives as long as messages can arrive.
+  PointerLockPlugin* plugin_;
+
+  // Whether the current session hid the cursor, which is undone when it ends.
+  bool hid_cursor_ = false;
   
   // Empty in the beginning. Set as long as a pointer lock session is active.
   std::unique_ptr<PointerLockSession> session_;